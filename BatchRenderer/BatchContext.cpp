@@ -43,10 +43,22 @@
 #include "BatchContext.h"
 
 #include "CGLContext.h"
-#include "GLXContext.h"
+#ifdef USE_OSMESA
+# include "OSMesaContext.h"
+#else
+# include "EGLContext.h"
+# include "GLXContext.h"
+#endif
 #include "WGLContext.h"
 #include "NSContext.h"
 
+#if !defined(DETECTED_OS_WINDOWS) && !defined(DETECTED_OS_APPLE) && \
+    !defined(USE_OSMESA)
+// glewInit also initializes GLX, which needs a GLX context; this only
+// loads the GL entry points.  Older GLEWs export it without declaring it.
+extern "C" GLenum GLEWAPIENTRY glewContextInit(void);
+#endif
+
 namespace tuvok
 {
 
@@ -71,14 +83,38 @@ BatchContext* BatchContext::Create(uint32_t width, uint32_t height,
 #elif defined(DETECTED_OS_APPLE)
   bctx = new NSContext(width, height, color_bits, depth_bits, stencil_bits,
                       double_buffer, visible);
+#elif defined(USE_OSMESA)
+  bctx = new OSMesaBatchContext(width, height, color_bits, depth_bits,
+                                stencil_bits, double_buffer, visible);
 #else
-  bctx = new GLXBatchContext(width, height, color_bits, depth_bits, stencil_bits,
-                             double_buffer, visible);
+  // GLX first; nodes without an X server render through EGL instead.
+  bool glx = false;
+  try {
+    bctx = new GLXBatchContext(width, height, color_bits, depth_bits,
+                               stencil_bits, double_buffer, visible);
+    glx = true;
+  } catch(const NoAvailableContext&) {
+    std::cerr << "No GLX context available; trying EGL." << std::endl;
+    try {
+      bctx = new EGLBatchContext(width, height, color_bits, depth_bits,
+                                 stencil_bits, double_buffer, visible);
+    } catch(const NoAvailableContext&) {
+      std::cerr << "No EGL context available either; nodes without a GPU "
+                << "driver need the OSMesa build (qmake CONFIG+=osmesa)."
+                << std::endl;
+      throw;
+    }
+  }
 #endif
   if (bctx->makeCurrent() == false)
     std::cerr << "Unable to make context current!" << std::endl;
 
+#if !defined(DETECTED_OS_WINDOWS) && !defined(DETECTED_OS_APPLE) && \
+    !defined(USE_OSMESA)
+  GLenum glerr = glx ? glewInit() : glewContextInit();
+#else
   GLenum glerr = glewInit();
+#endif
   if (GLEW_OK != glerr) 
   {
     std::cerr << "Error initializing GLEW: " << glewGetErrorString(glerr) << "\n";
@@ -48,7 +48,10 @@ class BatchContext : public Context // Tuvok specific
 {
 public:
   /// This virtual constructor will create the appropriate context based
-  /// on the current operating system.
+  /// on the current operating system.  On Linux that is GLX, or an
+  /// offscreen EGL context if there is no X display; the OSMesa build
+  /// (USE_OSMESA) creates offscreen OSMesa contexts instead.  Throws
+  /// NoAvailableContext if no context can be created at all.
   static BatchContext* Create(uint32_t width, uint32_t height,
                               uint8_t color_bits=32, uint8_t depth_bits=24,
                               uint8_t stencil_bits=8, bool double_buffer=true,
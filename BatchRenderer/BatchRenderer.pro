@@ -29,7 +29,22 @@ unix:QMAKE_CFLAGS   += -fno-strict-aliasing -g
 # Non-OSX Unix configuration
 ####
 # Note: Do NOT specific the GL linker flag (-lGL) on Mac!
-unix:!macx:LIBS    += -lGL -lX11 -lGLU
+# Without an X display, the renderer falls back to an offscreen EGL context.
+# libEGL is loaded at run time, and the GL calls reach the EGL context
+# through libGL, which only works with GLVND's libGL.
+# For nodes without a GPU driver, 'qmake CONFIG+=osmesa' builds a renderer
+# which only renders offscreen through OSMesa.  That build must not link
+# libGL: with GLVND, libGL dispatches to the vendor of the current GLX
+# context, and an OSMesa context is not one.  GLEW is compiled in with
+# GLEW_OSMESA, so it looks up entry points with OSMesaGetProcAddress; it
+# takes the place of the GLX build of GLEW in libTuvok.
+osmesa {
+  DEFINES          += USE_OSMESA GLEW_OSMESA
+  SOURCES          += ../Tuvok/3rdParty/GLEW/glew.c
+  unix:!macx:LIBS  += -lOSMesa -lGLU -lrt
+} else {
+  unix:!macx:LIBS  += -lGL -lX11 -lGLU -lrt -ldl
+}
 # Try to link to GLU statically.
 gludirs = /usr/lib /usr/lib/x86_64-linux-gnu
 for(d, gludirs) {
@@ -75,10 +90,15 @@ contains(QMAKE_PRL_CONFIG, shared) {
 SOURCES += \
   main.cpp \
   BatchContext.cpp \
-  TuvokLuaScriptExec.cpp
+  Compositor.cpp \
+  FrameQueue.cpp \
+  RenderServer.cpp \
+  TuvokLuaScriptExec.cpp \
+  WorkerPool.cpp
 
 
-unix:!macx  { SOURCES += GLXContext.cpp }
+unix:!macx:!osmesa { SOURCES += GLXContext.cpp EGLContext.cpp }
+osmesa      { SOURCES += OSMesaContext.cpp }
 macx        { SOURCES += CGLContext.cpp }
 macx        { OBJECTIVE_SOURCES += NSContext.mm }
 win32       { SOURCES += WGLContext.cpp }
@@ -86,7 +106,15 @@ win32       { SOURCES += WGLContext.cpp }
 HEADERS += \
   BatchContext.h \
   CGLContext.h \
+  Compositor.h \
+  EGLContext.h \
+  FrameQueue.h \
   NSContext.h \
   GLXContext.h \
+  OSMesaContext.h \
+  RenderServer.h \
   WGLContext.h \
-  TuvokLuaScriptExec.h
+  TuvokLuaScriptExec.h \
+  WorkerPool.h
+
+include(../Common/Common.pri)
@@ -0,0 +1,256 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    Compositor.cpp
+  \brief   Sort-last compositing of partial images rendered by several
+           batch renderer processes.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef DETECTED_OS_LINUX
+# include <fcntl.h>
+# include <pthread.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
+#endif
+
+#include "Compositor.h"
+#include "FrameQueue.h"
+#include "Controller/Controller.h"
+
+namespace tuvok
+{
+
+#ifdef DETECTED_OS_LINUX
+
+// Layout of the segment: the header, the sort keys of the workers, then,
+// page aligned, one image per worker and the final image.
+struct segment_header {
+  pthread_barrier_t barrier;
+  uint32_t count;
+};
+
+namespace {
+  size_t keys_offset() { return sizeof(segment_header); }
+  size_t images_offset(uint32_t count) {
+    const size_t end = keys_offset() + count * sizeof(float);
+    return (end + 4095) / 4096 * 4096;
+  }
+
+  std::runtime_error sys_error(const std::string& what) {
+    return std::runtime_error(what + ": " + strerror(errno));
+  }
+
+  // front-to-back 'over' of premultiplied BGRA pixels.
+  void blend_under(uint8_t* acc, const uint8_t* src, size_t pixels) {
+    for(size_t i=0; i < pixels; ++i, acc += 4, src += 4) {
+      const unsigned t = 255u - acc[3];
+      if(t == 0 || src[3] == 0) { continue; }
+      for(unsigned c=0; c < 4; ++c) {
+        acc[c] = static_cast<uint8_t>(std::min(255u,
+                   acc[c] + (src[c] * t + 127u) / 255u));
+      }
+    }
+  }
+}
+
+std::string Compositor::CreateSegment(uint32_t count)
+{
+  std::ostringstream name;
+  name << "/BatchRenderer-" << getpid();
+  const int fd = shm_open(name.str().c_str(), O_RDWR | O_CREAT | O_EXCL,
+                          0600);
+  if(fd == -1) { throw sys_error("could not create " + name.str()); }
+  const size_t bytes = images_offset(count);
+  void* data = MAP_FAILED;
+  if(ftruncate(fd, bytes) == 0) {
+    data = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if(data == MAP_FAILED) {
+    const std::runtime_error err = sys_error("could not map " + name.str());
+    shm_unlink(name.str().c_str());
+    throw err;
+  }
+
+  segment_header* header = static_cast<segment_header*>(data);
+  header->count = count;
+  pthread_barrierattr_t attr;
+  pthread_barrierattr_init(&attr);
+  pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  const int err = pthread_barrier_init(&header->barrier, &attr, count);
+  pthread_barrierattr_destroy(&attr);
+  munmap(data, bytes);
+  if(err != 0) {
+    shm_unlink(name.str().c_str());
+    errno = err;
+    throw sys_error("could not set up the compositing barrier");
+  }
+  return name.str();
+}
+
+void Compositor::RemoveSegment(const std::string& name)
+{
+  shm_unlink(name.c_str());
+}
+
+Compositor::Compositor(const std::string& name, uint32_t index,
+                       uint32_t count) :
+  m_fd(-1),
+  m_data(NULL),
+  m_mapped(0),
+  m_imageBytes(0),
+  m_index(index),
+  m_count(count)
+{
+  m_fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if(m_fd == -1) { throw sys_error("could not open " + name); }
+  m_mapped = images_offset(count);
+  void* data = mmap(NULL, m_mapped, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    m_fd, 0);
+  if(data == MAP_FAILED) {
+    close(m_fd);
+    throw sys_error("could not map " + name);
+  }
+  m_data = static_cast<uint8_t*>(data);
+  if(reinterpret_cast<segment_header*>(m_data)->count != count) {
+    munmap(m_data, m_mapped);
+    close(m_fd);
+    throw std::runtime_error(name + " is not set up for this many workers");
+  }
+}
+
+Compositor::~Compositor()
+{
+  munmap(m_data, m_mapped);
+  close(m_fd);
+}
+
+void Compositor::Reserve(size_t imageBytes)
+{
+  const size_t bytes = images_offset(m_count) + (m_count+1) * imageBytes;
+  // every worker grows the segment to the same size, so it does not matter
+  // which one gets there first.
+  struct stat st;
+  if(fstat(m_fd, &st) != 0) { throw sys_error("compositing segment"); }
+  if(static_cast<size_t>(st.st_size) < bytes &&
+     ftruncate(m_fd, bytes) != 0) {
+    throw sys_error("could not grow the compositing segment");
+  }
+  if(m_mapped >= bytes) { return; }
+  void* data = mremap(m_data, m_mapped, bytes, MREMAP_MAYMOVE);
+  if(data == MAP_FAILED) {
+    throw sys_error("could not map the compositing segment");
+  }
+  m_data = static_cast<uint8_t*>(data);
+  m_mapped = bytes;
+}
+
+void Compositor::Wait()
+{
+  pthread_barrier_wait(&reinterpret_cast<segment_header*>(m_data)->barrier);
+}
+
+bool Compositor::Composite(uint32_t width, uint32_t height, float order,
+                           std::vector<uint8_t>& image)
+{
+  image.clear();
+  const size_t bytes = size_t(width) * size_t(height) * 4;
+  if(bytes != m_imageBytes) {
+    // the images move with their size: nobody may still be using the
+    // previous frame's.  All workers see the same sizes, so they all wait.
+    Wait();
+    Reserve(bytes);
+    m_imageBytes = bytes;
+  }
+  uint8_t* images = m_data + images_offset(m_count);
+  float* keys = reinterpret_cast<float*>(m_data + keys_offset());
+
+  uint8_t* mine = images + m_index * bytes;
+  const bool ok = ReadFramebuffer(width, height, mine);
+  if(!ok) { std::fill(mine, mine + bytes, 0); }
+  keys[m_index] = order;
+  Wait();
+
+  // blend this worker's stripe of all images, front to back.
+  std::vector<uint32_t> sorted(m_count);
+  for(uint32_t k=0; k < m_count; ++k) { sorted[k] = k; }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+  const size_t row = size_t(width) * 4;
+  const size_t y0 = size_t(height) * m_index / m_count;
+  const size_t y1 = size_t(height) * (m_index+1) / m_count;
+  uint8_t* result = images + m_count * bytes;
+  std::fill(result + y0*row, result + y1*row, 0);
+  for(uint32_t i=0; i < m_count; ++i) {
+    blend_under(result + y0*row, images + sorted[i]*bytes + y0*row,
+                (y1-y0) * width);
+  }
+  Wait();
+
+  // the next frame's stripes are only blended after the next readback,
+  // which worker 0 only reaches once it has its copy.
+  if(m_index == 0) { image.assign(result, result + bytes); }
+  return ok;
+}
+
+#else
+
+std::string Compositor::CreateSegment(uint32_t)
+{
+  throw std::runtime_error("compositing is only available on Linux");
+}
+
+void Compositor::RemoveSegment(const std::string&) {}
+
+Compositor::Compositor(const std::string&, uint32_t, uint32_t) :
+  m_fd(-1), m_data(NULL), m_mapped(0), m_imageBytes(0), m_index(0),
+  m_count(0)
+{
+  throw std::runtime_error("compositing is only available on Linux");
+}
+
+Compositor::~Compositor() {}
+void Compositor::Reserve(size_t) {}
+void Compositor::Wait() {}
+
+bool Compositor::Composite(uint32_t, uint32_t, float, std::vector<uint8_t>&)
+{
+  return false;
+}
+
+#endif
+
+}
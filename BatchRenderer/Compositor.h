@@ -0,0 +1,94 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    Compositor.h
+  \brief   Sort-last compositing of partial images rendered by several
+           batch renderer processes.
+*/
+
+#ifndef BATCHRENDERER_COMPOSITOR_H
+#define BATCHRENDERER_COMPOSITOR_H
+
+#include <string>
+#include <vector>
+
+#include "StdTuvokDefines.h"
+
+namespace tuvok
+{
+
+/// Every worker renders one spatial part of a volume (see uvfconvert
+/// --split and LuaScripts/RenderParts.lua) into an image with a transparent
+/// background; the compositor blends these into the final frame.  The
+/// images meet in a shared memory segment which the coordinator creates
+/// before it starts the workers.  Compositing is direct-send: with N
+/// workers, worker k blends the k-th horizontal stripe of all N images, in
+/// front-to-back order, so every worker does 1/N of the work and nothing
+/// but the final stripes is copied.  A process-shared barrier in the
+/// segment separates the steps, which makes Composite a collective call:
+/// all workers must call it for every frame.  Linux only.
+class Compositor
+{
+public:
+  /// Creates a segment for 'count' workers and returns its name; throws
+  /// std::runtime_error if that is not possible.
+  static std::string CreateSegment(uint32_t count);
+  static void RemoveSegment(const std::string& name);
+
+  /// Attaches worker 'index' to the segment 'name'; throws
+  /// std::runtime_error if it does not exist or is not for 'count' workers.
+  Compositor(const std::string& name, uint32_t index, uint32_t count);
+  ~Compositor();
+
+  /// Reads the lower left width x height pixels of the current context's
+  /// framebuffer, which must hold premultiplied colors, and blends them
+  /// with the images of the other workers; the image with the smallest
+  /// 'order' is in front.  Worker 0 receives the result in 'image' (BGRA,
+  /// bottom row first, like FrameQueue); the others get an empty vector.
+  /// false if this worker's image could not be read back; it then counts
+  /// as empty.
+  bool Composite(uint32_t width, uint32_t height, float order,
+                 std::vector<uint8_t>& image);
+
+private:
+  /// grows the segment and the mapping to hold frames of 'imageBytes'.
+  void Reserve(size_t imageBytes);
+  void Wait();
+
+  int m_fd;
+  uint8_t* m_data;
+  size_t m_mapped;
+  size_t m_imageBytes;  ///< size of the images of the last frame
+  uint32_t m_index;
+  uint32_t m_count;
+};
+
+}
+
+#endif /* BATCHRENDERER_COMPOSITOR_H */
@@ -0,0 +1,312 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    EGLContext.cpp
+  \brief   Offscreen OpenGL context through EGL, for nodes without an X
+           server.
+*/
+
+#include <string>
+#include <dlfcn.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLEW/GL/glew.h>
+
+#include "EGLContext.h"
+#include "Controller/Controller.h"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+# define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace tuvok {
+
+struct egl_info {
+  void* lib;
+  EGLDisplay display;
+  EGLSurface surface;
+  EGLContext ctx;
+
+  // the functions of libEGL which are used.
+  decltype(&eglGetProcAddress) GetProcAddress;
+  decltype(&eglGetDisplay) GetDisplay;
+  decltype(&eglInitialize) Initialize;
+  decltype(&eglTerminate) Terminate;
+  decltype(&eglQueryString) QueryString;
+  decltype(&eglBindAPI) BindAPI;
+  decltype(&eglChooseConfig) ChooseConfig;
+  decltype(&eglGetConfigAttrib) GetConfigAttrib;
+  decltype(&eglCreatePbufferSurface) CreatePbufferSurface;
+  decltype(&eglDestroySurface) DestroySurface;
+  decltype(&eglCreateContext) CreateContext;
+  decltype(&eglDestroyContext) DestroyContext;
+  decltype(&eglMakeCurrent) MakeCurrent;
+  decltype(&eglGetError) GetError;
+};
+
+static bool egl_load(struct egl_info&);
+static EGLDisplay egl_display(const struct egl_info&);
+static bool find_config(const struct egl_info&, uint8_t, uint8_t, uint8_t,
+                        EGLConfig&);
+static void egl_close(struct egl_info&);
+
+EGLBatchContext::EGLBatchContext(uint32_t w, uint32_t h, uint8_t color_bits,
+                                 uint8_t depth_bits, uint8_t stencil_bits,
+                                 bool,
+                                 bool visible) :
+  ei(new struct egl_info())
+{
+  if(!egl_load(*ei)) { throw NoAvailableContext(); }
+  if(visible) {
+    WARNING("EGL contexts render offscreen; rendering invisibly.");
+  }
+
+  ei->display = egl_display(*ei);
+  EGLConfig config;
+  if(ei->display == EGL_NO_DISPLAY ||
+     !find_config(*ei, color_bits, depth_bits, stencil_bits, config) ||
+     ei->BindAPI(EGL_OPENGL_API) != EGL_TRUE) {
+    egl_close(*ei);
+    throw NoAvailableContext();
+  }
+
+  const EGLint attr[] = {
+    EGL_WIDTH,  static_cast<EGLint>(w),
+    EGL_HEIGHT, static_cast<EGLint>(h),
+    EGL_NONE
+  };
+  ei->surface = ei->CreatePbufferSurface(ei->display, config, attr);
+  if(ei->surface == EGL_NO_SURFACE) {
+    T_ERROR("Could not create a %ux%u EGL pbuffer (error %#x).", w, h,
+            static_cast<unsigned>(ei->GetError()));
+    egl_close(*ei);
+    throw NoAvailableContext();
+  }
+  ei->ctx = ei->CreateContext(ei->display, config, EGL_NO_CONTEXT, NULL);
+  if(ei->ctx == EGL_NO_CONTEXT || !this->makeCurrent()) {
+    T_ERROR("Could not create an EGL context (error %#x).",
+            static_cast<unsigned>(ei->GetError()));
+    egl_close(*ei);
+    throw NoAvailableContext();
+  }
+  MESSAGE("Offscreen %ux%u EGL context from '%s'", w, h,
+          ei->QueryString(ei->display, EGL_VENDOR));
+}
+
+EGLBatchContext::~EGLBatchContext()
+{
+  egl_close(*ei);
+  ei.reset();
+}
+
+bool EGLBatchContext::isValid() const
+{
+  return this->ei->ctx != EGL_NO_CONTEXT;
+}
+
+bool EGLBatchContext::makeCurrent()
+{
+  if(ei->MakeCurrent(ei->display, ei->surface, ei->surface,
+                     ei->ctx) != EGL_TRUE) {
+    T_ERROR("Could not make context current!");
+    return false;
+  }
+  return true;
+}
+
+bool EGLBatchContext::swapBuffers()
+{
+  glFinish();
+  return true;
+}
+
+template<typename F> static bool
+egl_sym(void* lib, const char* name, F& f)
+{
+  f = reinterpret_cast<F>(dlsym(lib, name));
+  return f != NULL;
+}
+
+static bool
+egl_load(struct egl_info& ei)
+{
+  ei.display = EGL_NO_DISPLAY;
+  ei.surface = EGL_NO_SURFACE;
+  ei.ctx = EGL_NO_CONTEXT;
+  ei.lib = dlopen("libEGL.so.1", RTLD_NOW | RTLD_LOCAL);
+  if(ei.lib == NULL) {
+    T_ERROR("Could not load libEGL: %s", dlerror());
+    return false;
+  }
+  if(!egl_sym(ei.lib, "eglGetProcAddress", ei.GetProcAddress) ||
+     !egl_sym(ei.lib, "eglGetDisplay", ei.GetDisplay) ||
+     !egl_sym(ei.lib, "eglInitialize", ei.Initialize) ||
+     !egl_sym(ei.lib, "eglTerminate", ei.Terminate) ||
+     !egl_sym(ei.lib, "eglQueryString", ei.QueryString) ||
+     !egl_sym(ei.lib, "eglBindAPI", ei.BindAPI) ||
+     !egl_sym(ei.lib, "eglChooseConfig", ei.ChooseConfig) ||
+     !egl_sym(ei.lib, "eglGetConfigAttrib", ei.GetConfigAttrib) ||
+     !egl_sym(ei.lib, "eglCreatePbufferSurface", ei.CreatePbufferSurface) ||
+     !egl_sym(ei.lib, "eglDestroySurface", ei.DestroySurface) ||
+     !egl_sym(ei.lib, "eglCreateContext", ei.CreateContext) ||
+     !egl_sym(ei.lib, "eglDestroyContext", ei.DestroyContext) ||
+     !egl_sym(ei.lib, "eglMakeCurrent", ei.MakeCurrent) ||
+     !egl_sym(ei.lib, "eglGetError", ei.GetError)) {
+    T_ERROR("libEGL lacks EGL 1.4 functions: %s", dlerror());
+    dlclose(ei.lib);
+    ei.lib = NULL;
+    return false;
+  }
+  return true;
+}
+
+// whether the space separated 'list' contains 'ext'.
+static bool
+has_extension(const char* list, const std::string& ext)
+{
+  const std::string l = std::string(" ") + (list ? list : "") + " ";
+  return l.find(" " + ext + " ") != std::string::npos;
+}
+
+static bool
+egl_initialize(const struct egl_info& ei, EGLDisplay d, const char* what)
+{
+  EGLint major = 0, minor = 0;
+  if(d == EGL_NO_DISPLAY || ei.Initialize(d, &major, &minor) != EGL_TRUE) {
+    WARNING("No EGL display from %s.", what);
+    return false;
+  }
+  MESSAGE("EGL %d.%d display from %s", major, minor, what);
+  return true;
+}
+
+static EGLDisplay
+egl_display(const struct egl_info& ei)
+{
+  // the client extensions; NULL if EGL_EXT_client_extensions is missing.
+  const char* client = ei.QueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+    reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+      ei.GetProcAddress("eglGetPlatformDisplayEXT"));
+  PFNEGLQUERYDEVICESEXTPROC queryDevices =
+    reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(
+      ei.GetProcAddress("eglQueryDevicesEXT"));
+
+  // a GPU, without any window system.
+  if(getPlatformDisplay && queryDevices &&
+     has_extension(client, "EGL_EXT_platform_device")) {
+    EGLDeviceEXT devices[16];
+    EGLint n = 0;
+    if(queryDevices(16, devices, &n) == EGL_TRUE) {
+      for(EGLint i=0; i < n; ++i) {
+        EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT,
+                                          devices[i], NULL);
+        if(egl_initialize(ei, d, "a GPU device")) { return d; }
+      }
+    }
+  }
+  // Mesa renders without a window system on its surfaceless platform.
+  if(getPlatformDisplay &&
+     has_extension(client, "EGL_MESA_platform_surfaceless")) {
+    EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                      EGL_DEFAULT_DISPLAY, NULL);
+    if(egl_initialize(ei, d, "the surfaceless platform")) { return d; }
+  }
+  EGLDisplay d = ei.GetDisplay(EGL_DEFAULT_DISPLAY);
+  if(egl_initialize(ei, d, "the default display")) { return d; }
+  T_ERROR("No EGL display is available.");
+  return EGL_NO_DISPLAY;
+}
+
+// the smallest config with at least the requested bits, as for GLX.
+static bool
+find_config(const struct egl_info& ei, uint8_t color_bits,
+            uint8_t depth_bits, uint8_t stencil_bits, EGLConfig& config)
+{
+  // 32 and 64 bits include alpha, 24 and 48 do not; 16 means RGB565.
+  const EGLint alpha = color_bits % 3 == 0 || color_bits < 24 ? 0
+                                                              : color_bits / 4;
+  const EGLint channel = (color_bits - alpha) / 3;
+  const EGLint attr[] = {
+    EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE,        channel,
+    EGL_GREEN_SIZE,      channel,
+    EGL_BLUE_SIZE,       channel,
+    EGL_ALPHA_SIZE,      alpha,
+    EGL_DEPTH_SIZE,      depth_bits,
+    EGL_STENCIL_SIZE,    stencil_bits,
+    EGL_NONE
+  };
+
+  EGLConfig configs[64];
+  EGLint n = 0;
+  if(ei.ChooseConfig(ei.display, attr, configs, 64, &n) != EGL_TRUE ||
+     n == 0) {
+    T_ERROR("No EGL pbuffer config with %u color, %u depth and %u stencil "
+            "bits.", static_cast<unsigned>(color_bits),
+            static_cast<unsigned>(depth_bits),
+            static_cast<unsigned>(stencil_bits));
+    return false;
+  }
+  EGLint best = 0, bestBits = 0;
+  for(EGLint i=0; i < n; ++i) {
+    EGLint bits = 0, depth = 0, stencil = 0;
+    ei.GetConfigAttrib(ei.display, configs[i], EGL_BUFFER_SIZE, &bits);
+    ei.GetConfigAttrib(ei.display, configs[i], EGL_DEPTH_SIZE, &depth);
+    ei.GetConfigAttrib(ei.display, configs[i], EGL_STENCIL_SIZE, &stencil);
+    bits += depth + stencil;
+    if(i == 0 || bits < bestBits) {
+      best = i;
+      bestBits = bits;
+    }
+  }
+  config = configs[best];
+  return true;
+}
+
+static void
+egl_close(struct egl_info& ei)
+{
+  if(ei.display != EGL_NO_DISPLAY) {
+    ei.MakeCurrent(ei.display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                   EGL_NO_CONTEXT);
+    if(ei.ctx != EGL_NO_CONTEXT) { ei.DestroyContext(ei.display, ei.ctx); }
+    if(ei.surface != EGL_NO_SURFACE) {
+      ei.DestroySurface(ei.display, ei.surface);
+    }
+    ei.Terminate(ei.display);
+  }
+  ei.display = EGL_NO_DISPLAY;
+  ei.surface = EGL_NO_SURFACE;
+  ei.ctx = EGL_NO_CONTEXT;
+  // libEGL stays loaded: drivers do not cope well with being unloaded.
+}
+
+} // namespace tuvok
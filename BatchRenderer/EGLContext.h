@@ -0,0 +1,73 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    EGLContext.h
+  \brief   Offscreen OpenGL context through EGL, for nodes without an X
+           server.
+*/
+
+#ifndef TUVOK_EGL_CONTEXT_H
+#define TUVOK_EGL_CONTEXT_H
+
+#include <memory>
+#include "BatchContext.h"
+
+namespace tuvok
+{
+
+struct egl_info;
+
+/// Renders into an EGL pbuffer, so 'visible' is ignored.  libEGL is loaded
+/// at run time: the renderer still starts where there is none, and with
+/// GLVND the GL entry points of libGL dispatch to an EGL context just like
+/// to a GLX one.  The display is the first GPU found through
+/// EGL_EXT_platform_device, else Mesa's surfaceless platform, else the
+/// default display.
+class EGLBatchContext: public BatchContext
+{
+public:
+  EGLBatchContext(uint32_t w, uint32_t h, uint8_t color_bits,
+                  uint8_t depth_bits, uint8_t stencil_bits,
+                  bool double_buffer,
+                  bool visible);
+  virtual ~EGLBatchContext();
+
+  bool isValid() const;
+  bool makeCurrent();
+  /// a pbuffer has only one buffer; this just waits for rendering to
+  /// finish.
+  bool swapBuffers();
+
+private:
+  std::shared_ptr<struct egl_info> ei;
+};
+
+}
+
+#endif /* TUVOK_EGL_CONTEXT_H */
@@ -0,0 +1,268 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    FrameQueue.cpp
+  \brief   Pipelined readback and encoding of rendered frames.
+*/
+
+#include <algorithm>
+
+#include "GLEW/GL/glew.h"
+#include <QtCore/QBuffer>
+#include <QtGui/QImage>
+
+#include "FrameQueue.h"
+#include "Controller/Controller.h"
+
+namespace tuvok {
+
+namespace {
+  // GL's first row is the bottom one.
+  QImage to_image(const uint8_t* pixels, uint32_t width, uint32_t height,
+                  bool keepAlpha) {
+    return QImage(pixels, int(width), int(height),
+                  keepAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32
+                 ).mirrored(false, true);
+  }
+}
+
+FrameQueue::FrameQueue(unsigned encoders) :
+  m_usePBO(true),
+  m_pending(false),
+  m_next(0),
+  m_maxFrames(0),
+  m_busy(0),
+  m_failed(0),
+  m_done(false)
+{
+  m_pbo[0] = m_pbo[1] = 0;
+  if(encoders == 0) {
+    encoders = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    encoders = std::max(1u, encoders);
+  }
+  // enough to keep every encoder busy while the renderer runs ahead, but
+  // bounded, since a frame is width*height*4 bytes.
+  m_maxFrames = 2 * encoders;
+  for(unsigned i=0; i < encoders; ++i) {
+    m_encoders.push_back(std::thread(&FrameQueue::Encode, this));
+  }
+}
+
+FrameQueue::~FrameQueue()
+{
+  if(m_pending) {
+    // mapping the buffer needs the context, which may be gone by now.
+    WARNING("Dropping frame '%s'; it was queued after the last "
+            "finishFrames.", m_reading.filename.c_str());
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_done = true;
+  }
+  m_changed.notify_all();
+  for(size_t i=0; i < m_encoders.size(); ++i) { m_encoders[i].join(); }
+}
+
+bool FrameQueue::Queue(const std::string& filename, uint32_t width,
+                       uint32_t height, bool keepAlpha)
+{
+  if(m_usePBO && m_pbo[0] == 0) {
+    m_usePBO = GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object;
+    if(m_usePBO) {
+      glGenBuffers(2, m_pbo);
+    } else {
+      WARNING("No pixel buffer objects; frames are read back synchronously.");
+    }
+  }
+
+  Frame frame;
+  frame.filename = filename;
+  frame.width = width;
+  frame.height = height;
+  frame.keepAlpha = keepAlpha;
+  const size_t bytes = size_t(width) * size_t(height) * 4;
+  bool ok;
+  if(m_usePBO) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo[m_next]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+    ok = ReadFramebuffer(width, height, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  } else {
+    frame.pixels.resize(bytes);
+    ok = ReadFramebuffer(width, height, &frame.pixels[0]);
+  }
+  if(!ok) {
+    T_ERROR("Could not read back '%s'", filename.c_str());
+    return false;
+  }
+
+  if(!m_usePBO) {
+    Push(frame);
+    return true;
+  }
+
+  // the copy into m_pbo[m_next] is in flight; the previous frame's is
+  // usually done by now.
+  Collect();
+  m_reading = frame;
+  m_pending = true;
+  m_next ^= 1;
+  return true;
+}
+
+bool ReadFramebuffer(uint32_t width, uint32_t height, void* pixels)
+{
+  // the final image is in the default framebuffer.
+  GLint readFBO = 0;
+  const bool fbo = GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object;
+  if(fbo) {
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFBO);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+  }
+  GLboolean doubleBuffered = GL_FALSE;
+  glGetBooleanv(GL_DOUBLEBUFFER, &doubleBuffered);
+  glReadBuffer(doubleBuffered ? GL_BACK : GL_FRONT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  // BGRA as packed 32bit ARGB is QImage's layout on every platform.
+  glReadPixels(0, 0, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+               pixels);
+  if(fbo) { glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO); }
+
+  const GLenum err = glGetError();
+  if(err != GL_NO_ERROR) {
+    T_ERROR("Reading back the framebuffer failed with GL error %#x",
+            static_cast<unsigned>(err));
+    return false;
+  }
+  return true;
+}
+
+bool EncodeImage(const uint8_t* pixels, uint32_t width, uint32_t height,
+                 bool keepAlpha, const std::string& format, std::string& out)
+{
+  QByteArray bytes;
+  QBuffer buffer(&bytes);
+  buffer.open(QIODevice::WriteOnly);
+  if(!to_image(pixels, width, height, keepAlpha).save(&buffer,
+                                                      format.c_str())) {
+    return false;
+  }
+  out.assign(bytes.constData(), size_t(bytes.size()));
+  return true;
+}
+
+void FrameQueue::QueueImage(const std::string& filename, uint32_t width,
+                            uint32_t height, bool keepAlpha,
+                            std::vector<uint8_t>& pixels)
+{
+  Frame frame;
+  frame.filename = filename;
+  frame.width = width;
+  frame.height = height;
+  frame.keepAlpha = keepAlpha;
+  frame.pixels.swap(pixels);
+  Push(frame);
+}
+
+void FrameQueue::Collect()
+{
+  if(!m_pending) { return; }
+  m_pending = false;
+
+  Frame frame;
+  frame.filename.swap(m_reading.filename);
+  frame.width = m_reading.width;
+  frame.height = m_reading.height;
+  frame.keepAlpha = m_reading.keepAlpha;
+  const size_t bytes = size_t(frame.width) * size_t(frame.height) * 4;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pbo[m_next ^ 1]);
+  const uint8_t* data = static_cast<const uint8_t*>(
+    glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY)
+  );
+  if(data) {
+    frame.pixels.assign(data, data + bytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if(!data) {
+    T_ERROR("Could not map the pixels of '%s'", frame.filename.c_str());
+    std::lock_guard<std::mutex> lock(m_lock);
+    ++m_failed;
+    return;
+  }
+  Push(frame);
+}
+
+void FrameQueue::Push(Frame& frame)
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_changed.wait(lock, [this]() { return m_frames.size() < m_maxFrames; });
+  m_frames.push_back(Frame());
+  std::swap(m_frames.back(), frame);
+  m_changed.notify_all();
+}
+
+uint32_t FrameQueue::Finish()
+{
+  Collect();
+  std::unique_lock<std::mutex> lock(m_lock);
+  m_changed.wait(lock, [this]() { return m_frames.empty() && m_busy == 0; });
+  const uint32_t failed = m_failed;
+  m_failed = 0;
+  return failed;
+}
+
+void FrameQueue::Encode()
+{
+  std::unique_lock<std::mutex> lock(m_lock);
+  for(;;) {
+    m_changed.wait(lock, [this]() { return !m_frames.empty() || m_done; });
+    if(m_frames.empty()) { return; }
+    Frame frame;
+    std::swap(frame, m_frames.front());
+    m_frames.pop_front();
+    ++m_busy;
+    m_changed.notify_all();
+    lock.unlock();
+
+    const bool ok = to_image(&frame.pixels[0], frame.width, frame.height,
+                             frame.keepAlpha).save(
+                               QString::fromLocal8Bit(frame.filename.c_str()));
+    if(!ok) { T_ERROR("Could not write '%s'", frame.filename.c_str()); }
+
+    lock.lock();
+    --m_busy;
+    if(!ok) { ++m_failed; }
+    m_changed.notify_all();
+  }
+}
+
+} // namespace tuvok
@@ -0,0 +1,126 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    FrameQueue.h
+  \brief   Pipelined readback and encoding of rendered frames.
+*/
+
+#ifndef BATCHRENDERER_FRAMEQUEUE_H
+#define BATCHRENDERER_FRAMEQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StdTuvokDefines.h"
+
+namespace tuvok
+{
+
+/// Writes rendered frames to image files without stalling the renderer.
+/// Frames are read back from the current context's framebuffer through two
+/// pixel buffer objects: the copy of one frame runs while the next one is
+/// rendered, and only then is it mapped and handed to a pool of threads
+/// which flip, encode and write the images.  The format follows from the
+/// file extension (png, jpg, bmp, ...).
+class FrameQueue
+{
+public:
+  /// 'encoders' threads write the images; 0 uses all cores but one.
+  explicit FrameQueue(unsigned encoders=0);
+  /// waits for all queued frames.
+  ~FrameQueue();
+
+  /// Starts reading back the lower left width x height pixels of the
+  /// framebuffer of the current context; they are written to 'filename'
+  /// once the next frame is queued, or on Finish.  Without 'keepAlpha' the
+  /// image is stored opaque.
+  bool Queue(const std::string& filename, uint32_t width, uint32_t height,
+             bool keepAlpha);
+
+  /// Writes an image which is already in memory, e.g. a composite; takes
+  /// over 'pixels' (BGRA, bottom row first).
+  void QueueImage(const std::string& filename, uint32_t width,
+                  uint32_t height, bool keepAlpha,
+                  std::vector<uint8_t>& pixels);
+
+  /// Waits until all queued frames are written and returns how many of
+  /// them could not be.  Must be called with the context still current.
+  uint32_t Finish();
+
+private:
+  struct Frame {
+    std::string filename;
+    uint32_t width;
+    uint32_t height;
+    bool keepAlpha;
+    std::vector<uint8_t> pixels;  ///< BGRA, bottom row first
+  };
+
+  /// maps the pixel buffer of the pending frame and hands it over.
+  void Collect();
+  /// hands a frame to the encoders; blocks while too many are queued.
+  void Push(Frame& frame);
+  void Encode();
+
+  // readback; the pixel buffers are created on first use, in the context
+  // which is current then.
+  unsigned m_pbo[2];
+  bool m_usePBO;
+  bool m_pending;     ///< m_pbo[m_next^1] holds a frame still to collect
+  unsigned m_next;
+  Frame m_reading;    ///< description of the pending frame
+
+  // encoding
+  std::vector<std::thread> m_encoders;
+  std::mutex m_lock;
+  std::condition_variable m_changed;
+  std::deque<Frame> m_frames;
+  size_t m_maxFrames;   ///< queued frames before Queue blocks
+  size_t m_busy;        ///< frames being encoded right now
+  uint32_t m_failed;
+  bool m_done;
+};
+
+/// Reads the lower left width x height pixels of the current context's
+/// default framebuffer as BGRA, bottom row first, to 'pixels'; with a pixel
+/// pack buffer bound, 'pixels' is the offset into that buffer.
+bool ReadFramebuffer(uint32_t width, uint32_t height, void* pixels);
+
+/// Encodes BGRA pixels, bottom row first, as an image file of 'format'
+/// ("png", "jpg", ...) in memory.
+bool EncodeImage(const uint8_t* pixels, uint32_t width, uint32_t height,
+                 bool keepAlpha, const std::string& format, std::string& out);
+
+}
+
+#endif // BATCHRENDERER_FRAMEQUEUE_H
@@ -35,18 +35,26 @@ namespace tuvok {
 
 struct xinfo {
   Display *display;
-  XVisualInfo *visual;
+  GLXFBConfig config;
   Window win;
+  GLXPbuffer pbuffer;
   GLXContext ctx;
   Colormap cmap;
+
+  /// what is rendered to: the pbuffer if there is one, else the window.
+  GLXDrawable drawable() const { return pbuffer ? pbuffer : win; }
 };
 
-static struct xinfo x_connect(uint32_t, uint32_t, bool, bool);
-static XVisualInfo* find_visual(Display*, bool);
-static void glx_init(Display*, XVisualInfo*, GLXContext&);
+static struct xinfo x_connect(uint32_t, uint32_t, uint8_t, uint8_t,
+                              uint8_t, bool, bool);
+static bool find_config(Display*, uint8_t, uint8_t, uint8_t, bool, bool,
+                        GLXFBConfig&);
+static GLXPbuffer create_pbuffer(Display*, GLXFBConfig, uint32_t, uint32_t);
+static void create_window(struct xinfo&, uint32_t, uint32_t, bool);
+static void glx_init(Display*, GLXFBConfig, GLXContext&);
 
-GLXBatchContext::GLXBatchContext(uint32_t w, uint32_t h, uint8_t,
-                             uint8_t, uint8_t,
+GLXBatchContext::GLXBatchContext(uint32_t w, uint32_t h, uint8_t color_bits,
+                             uint8_t depth_bits, uint8_t stencil_bits,
                              bool double_buffer,
                              bool visible) :
   xi(new struct xinfo())
@@ -55,13 +63,9 @@ GLXBatchContext::GLXBatchContext(uint32_t w, uint32_t h, uint8_t,
   // Enable X debugging.
   _Xdebug = 1;
 #endif
-  // if you *really* require a specific value... just hack this class
-  // to your liking.  You probably want to add those parameters to x_connect
-  // and use them there.
-  WARNING("Ignoring color, depth, stencil bits.  For many applications, it "
-          "is better to let the GLX library choose the \"best\" visual.");
-  *this->xi = x_connect(w, h, double_buffer, visible);
-  glx_init(xi->display, xi->visual, xi->ctx);
+  *this->xi = x_connect(w, h, color_bits, depth_bits, stencil_bits,
+                        double_buffer, visible);
+  glx_init(xi->display, xi->config, xi->ctx);
   this->makeCurrent();
   MESSAGE("Current context: %p", glXGetCurrentContext());
 }
@@ -69,8 +73,12 @@ GLXBatchContext::GLXBatchContext(uint32_t w, uint32_t h, uint8_t,
 GLXBatchContext::~GLXBatchContext()
 {
   glXDestroyContext(xi->display, xi->ctx);
-  XDestroyWindow(xi->display, xi->win);
-  XFree(xi->visual);
+  if(xi->pbuffer) {
+    glXDestroyPbuffer(xi->display, xi->pbuffer);
+  } else {
+    XDestroyWindow(xi->display, xi->win);
+    XFreeColormap(xi->display, xi->cmap);
+  }
   XCloseDisplay(xi->display);
   xi.reset();
 }
@@ -82,7 +90,8 @@ bool GLXBatchContext::isValid() const
 
 bool GLXBatchContext::makeCurrent()
 {
-  if(glXMakeCurrent(this->xi->display, this->xi->win, this->xi->ctx) != True) {
+  if(glXMakeContextCurrent(this->xi->display, this->xi->drawable(),
+                           this->xi->drawable(), this->xi->ctx) != True) {
     T_ERROR("Could not make context current!");
     return false;
   }
@@ -91,95 +100,200 @@ bool GLXBatchContext::makeCurrent()
 
 bool GLXBatchContext::swapBuffers()
 {
-  glXSwapBuffers(this->xi->display, this->xi->win);
+  glXSwapBuffers(this->xi->display, this->xi->drawable());
   // SwapBuffers generates an X error if it fails.
   return true;
 }
 
 static struct xinfo
-x_connect(uint32_t width, uint32_t height, bool dbl_buffer, bool visible)
+x_connect(uint32_t width, uint32_t height, uint8_t color_bits,
+          uint8_t depth_bits, uint8_t stencil_bits, bool dbl_buffer,
+          bool visible)
 {
-  struct xinfo rv;
+  struct xinfo rv = xinfo();
 
   rv.display = XOpenDisplay(NULL);
   if(rv.display == NULL) {
     T_ERROR("Could not connect to display: '%s'!", XDisplayName(NULL));
     throw NoAvailableContext();
   }
+#ifndef NDEBUG
+  // every call is a round trip, but errors show up where they happen.
   XSynchronize(rv.display, True);
+#endif
 
-  rv.visual = find_visual(rv.display, dbl_buffer);
+  // X will create BadValue exceptions if these aren't true... much easier to
+  // debug via asserts.
+  assert(width > 0);
+  assert(height > 0);
 
-  Window parent = RootWindow(rv.display, rv.visual->screen);
+  // Invisible contexts render to a pbuffer; an unmapped window is the
+  // fallback for servers which offer no pbuffer configs.
+  if(!visible &&
+     find_config(rv.display, color_bits, depth_bits, stencil_bits,
+                 dbl_buffer, true, rv.config)) {
+    rv.pbuffer = create_pbuffer(rv.display, rv.config, width, height);
+  }
+  if(!rv.pbuffer) {
+    if(!find_config(rv.display, color_bits, depth_bits, stencil_bits,
+                    dbl_buffer, false, rv.config)) {
+      XCloseDisplay(rv.display);
+      throw NoAvailableContext();
+    }
+    create_window(rv, width, height, visible);
+  }
+  XSync(rv.display, False);
+
+  return rv;
+}
+
+// the smallest config with at least the requested bits; glXChooseFBConfig
+// sorts larger color buffers first, which would only cost bandwidth.
+static bool
+find_config(Display *d, uint8_t color_bits, uint8_t depth_bits,
+            uint8_t stencil_bits, bool double_buffered, bool pbuffer,
+            GLXFBConfig& config)
+{
+  // 32 and 64 bits include alpha, 24 and 48 do not; 16 means RGB565.
+  const int alpha = color_bits % 3 == 0 || color_bits < 24 ? 0
+                                                           : color_bits / 4;
+  const int channel = (color_bits - alpha) / 3;
+  const int attr[] = {
+    GLX_X_RENDERABLE,   True,
+    GLX_RENDER_TYPE,    GLX_RGBA_BIT,
+    GLX_DRAWABLE_TYPE,  pbuffer ? GLX_PBUFFER_BIT : GLX_WINDOW_BIT,
+    GLX_DOUBLEBUFFER,   double_buffered ? True : False,
+    GLX_RED_SIZE,       channel,
+    GLX_GREEN_SIZE,     channel,
+    GLX_BLUE_SIZE,      channel,
+    GLX_ALPHA_SIZE,     alpha,
+    GLX_DEPTH_SIZE,     depth_bits,
+    GLX_STENCIL_SIZE,   stencil_bits,
+    None
+  };
+
+  int n = 0;
+  GLXFBConfig* configs = glXChooseFBConfig(d, DefaultScreen(d), attr, &n);
+  if(configs == NULL || n == 0) {
+    T_ERROR("No %s config with %u color, %u depth and %u stencil bits.",
+            pbuffer ? "pbuffer" : "window", static_cast<unsigned>(color_bits),
+            static_cast<unsigned>(depth_bits),
+            static_cast<unsigned>(stencil_bits));
+    if(configs) { XFree(configs); }
+    return false;
+  }
+  // configs the server ranks lower for other reasons (slow, multisampled)
+  // are not considered.
+  int caveat = 0, samples = 0;
+  glXGetFBConfigAttrib(d, configs[0], GLX_CONFIG_CAVEAT, &caveat);
+  glXGetFBConfigAttrib(d, configs[0], GLX_SAMPLES, &samples);
+  int best = 0, bestBits = 0;
+  for(int i=0; i < n; ++i) {
+    int c = 0, s = 0, bits = 0, depth = 0, stencil = 0;
+    glXGetFBConfigAttrib(d, configs[i], GLX_CONFIG_CAVEAT, &c);
+    glXGetFBConfigAttrib(d, configs[i], GLX_SAMPLES, &s);
+    if(c != caveat || s != samples) { continue; }
+    glXGetFBConfigAttrib(d, configs[i], GLX_BUFFER_SIZE, &bits);
+    glXGetFBConfigAttrib(d, configs[i], GLX_DEPTH_SIZE, &depth);
+    glXGetFBConfigAttrib(d, configs[i], GLX_STENCIL_SIZE, &stencil);
+    bits += depth + stencil;
+    if(i == 0 || bits < bestBits) {
+      best = i;
+      bestBits = bits;
+    }
+  }
+  config = configs[best];
+  XFree(configs);
+
+  int color = 0, depth = 0, stencil = 0;
+  glXGetFBConfigAttrib(d, config, GLX_BUFFER_SIZE, &color);
+  glXGetFBConfigAttrib(d, config, GLX_DEPTH_SIZE, &depth);
+  glXGetFBConfigAttrib(d, config, GLX_STENCIL_SIZE, &stencil);
+  MESSAGE("Using a %s config with %d color, %d depth and %d stencil bits",
+          pbuffer ? "pbuffer" : "window", color, depth, stencil);
+  return true;
+}
+
+static bool pbuffer_failed = false;
+static int
+pbuffer_error(Display*, XErrorEvent*)
+{
+  pbuffer_failed = true;
+  return 0;
+}
+
+static GLXPbuffer
+create_pbuffer(Display *d, GLXFBConfig config, uint32_t width,
+               uint32_t height)
+{
+  const int attr[] = {
+    GLX_PBUFFER_WIDTH,      static_cast<int>(width),
+    GLX_PBUFFER_HEIGHT,     static_cast<int>(height),
+    GLX_PRESERVED_CONTENTS, True,
+    GLX_LARGEST_PBUFFER,    False,
+    None
+  };
+  // a server which is out of pbuffer memory answers with an X error, which
+  // would otherwise terminate the program.
+  XSync(d, False);
+  pbuffer_failed = false;
+  int (*old_handler)(Display*, XErrorEvent*) = XSetErrorHandler(pbuffer_error);
+  GLXPbuffer pbuffer = glXCreatePbuffer(d, config, attr);
+  XSync(d, False);
+  XSetErrorHandler(old_handler);
+  if(pbuffer_failed || !pbuffer) {
+    WARNING("Could not create a %ux%u pbuffer; using a window instead.",
+            width, height);
+    return 0;
+  }
+  return pbuffer;
+}
+
+static void
+create_window(struct xinfo& xi, uint32_t width, uint32_t height,
+              bool visible)
+{
+  XVisualInfo* visual = glXGetVisualFromFBConfig(xi.display, xi.config);
+  assert(visual->depth > 0);
+  Window parent = RootWindow(xi.display, visual->screen);
 
   XSetWindowAttributes xw_attr;
   xw_attr.override_redirect = False;
   xw_attr.background_pixel = 0;
-  xw_attr.colormap = XCreateColormap(rv.display, parent, rv.visual->visual,
+  xw_attr.border_pixel = 0;
+  xw_attr.colormap = XCreateColormap(xi.display, parent, visual->visual,
                                      AllocNone);
   xw_attr.event_mask = StructureNotifyMask | ExposureMask;
+  xi.cmap = xw_attr.colormap;
 
-  // X will create BadValue exceptions if these aren't true... much easier to
-  // debug via asserts.
-  assert(rv.visual->depth > 0);
-  assert(width > 0);
-  assert(height > 0);
-  rv.win = XCreateWindow(rv.display, parent, 0,0, width,height, 0,
-                         rv.visual->depth,
-                         InputOutput, rv.visual->visual,
+  xi.win = XCreateWindow(xi.display, parent, 0,0, width,height, 0,
+                         visual->depth,
+                         InputOutput, visual->visual,
                          CWBackPixel | CWBorderPixel | CWColormap |
                          CWOverrideRedirect | CWEventMask,
                          &xw_attr);
-  XStoreName(rv.display, rv.win, "Tuvok");
+  XFree(visual);
+  XStoreName(xi.display, xi.win, "Tuvok");
   if(visible) {
-    if(XMapRaised(rv.display, rv.win) != 0) {
+    if(XMapRaised(xi.display, xi.win) != 0) {
       T_ERROR("Could not map window!");
       throw std::runtime_error("could not map window");
     }
   }
-  XSync(rv.display, False);
-
-  return rv;
 }
 
 static void
-glx_init(Display *disp, XVisualInfo *visual, GLXContext& ctx)
+glx_init(Display *disp, GLXFBConfig config, GLXContext& ctx)
 {
   if(!glXQueryExtension(disp, NULL, NULL)) {
     T_ERROR("Display does not support glX.");
     return;
   }
 
-  ctx = glXCreateContext(disp, visual, 0, GL_TRUE);
+  ctx = glXCreateNewContext(disp, config, GLX_RGBA_TYPE, 0, GL_TRUE);
   if(!ctx) {
     T_ERROR("glX Context creation failed.");
   }
 }
 
-static XVisualInfo *
-find_visual(Display *d, bool double_buffered)
-{
-    XVisualInfo *ret_v;
-    // GLX_USE_GL is basically a no-op, so this provides a convenient
-    // way of specifying double buffering or not.
-    int att_buf = double_buffered ? GLX_DOUBLEBUFFER : GLX_USE_GL;
-    int attr[] = {
-      GLX_RGBA,
-      att_buf,
-      GLX_RED_SIZE,         5,
-      GLX_GREEN_SIZE,       6,
-      GLX_BLUE_SIZE,        5,
-      GLX_ALPHA_SIZE,       8,
-      GLX_DEPTH_SIZE,       8,
-      GLX_ACCUM_RED_SIZE,   0,
-      GLX_ACCUM_GREEN_SIZE, 0,
-      GLX_ACCUM_BLUE_SIZE,  0,
-      None
-    };
-
-    ret_v = glXChooseVisual(d, DefaultScreen(d), attr);
-    MESSAGE("ChooseVisual got us %p", (const void*)ret_v);
-    return ret_v;
-}
-
 } // namespace tuvok
@@ -0,0 +1,114 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    OSMesaContext.cpp
+  \brief   Offscreen OpenGL context rendered by Mesa on the CPU, for nodes
+           without an X server.
+*/
+
+#include <vector>
+
+#include <GLEW/GL/glew.h>
+#include <GL/osmesa.h>
+
+#include "OSMesaContext.h"
+#include "Controller/Controller.h"
+
+namespace tuvok {
+
+struct osmesa_info {
+  OSMesaContext ctx;
+  std::vector<uint8_t> buffer;
+  uint32_t width;
+  uint32_t height;
+};
+
+OSMesaBatchContext::OSMesaBatchContext(uint32_t w, uint32_t h,
+                                       uint8_t color_bits,
+                                       uint8_t depth_bits,
+                                       uint8_t stencil_bits,
+                                       bool,
+                                       bool visible) :
+  oi(new struct osmesa_info())
+{
+  if(visible) {
+    WARNING("Offscreen contexts cannot be shown; rendering invisibly.");
+  }
+  if(color_bits > 32) {
+    WARNING("Offscreen contexts have 8 bits per channel; %u color bits "
+            "requested.", static_cast<unsigned>(color_bits));
+  }
+  // OSMesa renders through the requested depth and stencil sizes directly;
+  // the color buffer is the RGBA array handed to OSMesaMakeCurrent.
+  oi->ctx = OSMesaCreateContextExt(OSMESA_RGBA, depth_bits, stencil_bits, 0,
+                                   NULL);
+  if(oi->ctx == NULL) {
+    T_ERROR("Could not create an OSMesa context.");
+    throw NoAvailableContext();
+  }
+  oi->width = w;
+  oi->height = h;
+  oi->buffer.resize(size_t(w) * size_t(h) * 4);
+  if(!this->makeCurrent()) {
+    OSMesaDestroyContext(oi->ctx);
+    throw NoAvailableContext();
+  }
+  MESSAGE("Offscreen %ux%u context, %u depth and %u stencil bits",
+          w, h, static_cast<unsigned>(depth_bits),
+          static_cast<unsigned>(stencil_bits));
+}
+
+OSMesaBatchContext::~OSMesaBatchContext()
+{
+  OSMesaDestroyContext(oi->ctx);
+  oi.reset();
+}
+
+bool OSMesaBatchContext::isValid() const
+{
+  return this->oi->ctx != NULL;
+}
+
+bool OSMesaBatchContext::makeCurrent()
+{
+  if(OSMesaMakeCurrent(oi->ctx, oi->buffer.data(), GL_UNSIGNED_BYTE,
+                       GLsizei(oi->width), GLsizei(oi->height)) != GL_TRUE) {
+    T_ERROR("Could not make context current!");
+    return false;
+  }
+  return true;
+}
+
+bool OSMesaBatchContext::swapBuffers()
+{
+  glFinish();
+  return true;
+}
+
+} // namespace tuvok
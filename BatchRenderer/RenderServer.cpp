@@ -0,0 +1,328 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    RenderServer.cpp
+  \brief   Serves render requests on a local socket, so data sets, shaders
+           and caches stay loaded between them.
+*/
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#ifndef DETECTED_OS_WINDOWS
+# include <cerrno>
+# include <fcntl.h>
+# include <poll.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/un.h>
+# include <unistd.h>
+#endif
+
+#include "RenderServer.h"
+#include "Controller/Controller.h"
+
+namespace tuvok
+{
+
+#ifndef DETECTED_OS_WINDOWS
+
+namespace {
+  // requests are Lua snippets or small descriptors; anything this large is
+  // a client gone wrong.
+  const size_t MAX_REQUEST = 16 * 1024 * 1024;
+  // a client which never finishes its request is dropped after this long.
+  const std::chrono::seconds REQUEST_TIMEOUT(10);
+
+  volatile sig_atomic_t signalled = 0;
+  void on_signal(int) { signalled = 1; }
+
+  sockaddr_un socket_address(const std::string& path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("socket path '" + path + "' is too long");
+    }
+    strcpy(addr.sun_path, path.c_str());
+    return addr;
+  }
+
+  bool write_all(int fd, const char* data, size_t bytes) {
+    while(bytes > 0) {
+      const ssize_t n = write(fd, data, bytes);
+      if(n < 0 && errno == EINTR) { continue; }
+      if(n <= 0) { return false; }
+      data += n;
+      bytes -= size_t(n);
+    }
+    return true;
+  }
+
+  enum ReadState { READ_MORE, READ_DONE, READ_FAILED };
+
+  // appends what the client has sent so far, without waiting for more.
+  ReadState read_some(int fd, std::string& data) {
+    char buffer[65536];
+    for(;;) {
+      const ssize_t n = read(fd, buffer, sizeof(buffer));
+      if(n < 0 && errno == EINTR) { continue; }
+      if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return READ_MORE;
+      }
+      if(n < 0) { return READ_FAILED; }
+      if(n == 0) { return READ_DONE; }
+      if(data.size() + size_t(n) > MAX_REQUEST) { return READ_FAILED; }
+      data.append(buffer, size_t(n));
+    }
+  }
+
+  void set_blocking(int fd, bool blocking) {
+    const int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK);
+  }
+
+  // a request which is still coming in.
+  struct Incoming {
+    int fd;
+    std::string data;
+    std::chrono::steady_clock::time_point deadline;
+  };
+}
+
+RenderServer::RenderServer(const std::string& path, size_t maxQueued) :
+  m_path(path),
+  m_listen(-1),
+  m_maxQueued(maxQueued),
+  m_stop(false)
+{
+  const sockaddr_un addr = socket_address(path);
+  m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(m_listen == -1) {
+    throw std::runtime_error(std::string("could not create a socket: ") +
+                             strerror(errno));
+  }
+  // a socket file nobody listens on is left over from a server which died.
+  if(connect(m_listen, reinterpret_cast<const sockaddr*>(&addr),
+             sizeof(addr)) == 0) {
+    close(m_listen);
+    throw std::runtime_error("another server is listening on '" + path + "'");
+  }
+  if(errno == ECONNREFUSED) { unlink(path.c_str()); }
+  close(m_listen);
+
+  m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(m_listen == -1 ||
+     bind(m_listen, reinterpret_cast<const sockaddr*>(&addr),
+          sizeof(addr)) != 0 ||
+     chmod(path.c_str(), S_IRUSR | S_IWUSR) != 0 ||
+     listen(m_listen, 64) != 0) {
+    const std::string why = strerror(errno);
+    if(m_listen != -1) {
+      close(m_listen);
+      unlink(path.c_str());
+    }
+    throw std::runtime_error("could not listen on '" + path + "': " + why);
+  }
+  // a client which hangs up early must not take the server down.
+  signal(SIGPIPE, SIG_IGN);
+  m_receiver = std::thread(&RenderServer::Receive, this);
+}
+
+RenderServer::~RenderServer()
+{
+  Stop();
+  m_receiver.join();
+  close(m_listen);
+  unlink(m_path.c_str());
+  for(size_t i=0; i < m_queue.size(); ++i) { close(m_queue[i].fd); }
+}
+
+void RenderServer::Stop()
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_stop = true;
+  m_changed.notify_all();
+}
+
+void RenderServer::Reply(int fd, bool ok, const std::string& data)
+{
+  std::ostringstream header;
+  header << (ok ? "OK " : "ERROR ") << data.size() << "\n";
+  const std::string h = header.str();
+  // nothing to do if the client is gone.
+  if(write_all(fd, h.data(), h.size())) {
+    write_all(fd, data.data(), data.size());
+  }
+}
+
+void RenderServer::Receive()
+{
+  // all clients are read at once, so a slow one only holds up itself.
+  std::vector<Incoming> incoming;
+  std::vector<pollfd> fds;
+  for(;;) {
+    {
+      std::lock_guard<std::mutex> lock(m_lock);
+      if(m_stop) { break; }
+    }
+    fds.resize(1 + incoming.size());
+    for(size_t i=0; i < fds.size(); ++i) {
+      fds[i].fd = i == 0 ? m_listen : incoming[i-1].fd;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    // wake up now and then to notice Stop and clients which take too long.
+    poll(&fds[0], nfds_t(fds.size()), 200);
+
+    const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+    std::vector<Incoming> waiting;
+    for(size_t i=0; i < incoming.size(); ++i) {
+      Incoming& in = incoming[i];
+      ReadState state = READ_MORE;
+      if(fds[i+1].revents != 0) { state = read_some(in.fd, in.data); }
+      if(state == READ_MORE && now < in.deadline) {
+        waiting.push_back(in);
+        continue;
+      }
+      if(state != READ_DONE) {
+        Reply(in.fd, false, "could not read the request");
+        close(in.fd);
+        continue;
+      }
+      // replies are written in one go.
+      set_blocking(in.fd, true);
+      Request r;
+      r.fd = in.fd;
+      r.data.swap(in.data);
+      std::unique_lock<std::mutex> lock(m_lock);
+      if(m_stop || m_queue.size() >= m_maxQueued) {
+        lock.unlock();
+        Reply(r.fd, false, "the server is busy");
+        close(r.fd);
+        continue;
+      }
+      m_queue.push_back(r);
+      m_changed.notify_all();
+    }
+    incoming.swap(waiting);
+
+    if(fds[0].revents & POLLIN) {
+      const int fd = accept(m_listen, NULL, NULL);
+      if(fd != -1) {
+        set_blocking(fd, false);
+        Incoming in;
+        in.fd = fd;
+        in.deadline = now + REQUEST_TIMEOUT;
+        incoming.push_back(in);
+      }
+    }
+  }
+  for(size_t i=0; i < incoming.size(); ++i) {
+    Reply(incoming[i].fd, false, "the server is shutting down");
+    close(incoming[i].fd);
+  }
+}
+
+void RenderServer::Run(const Handler& handler)
+{
+  signalled = 0;
+  struct sigaction action, oldInt, oldTerm;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = on_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, &oldInt);
+  sigaction(SIGTERM, &action, &oldTerm);
+  MESSAGE("Serving requests on '%s'", m_path.c_str());
+
+  uint32_t served = 0;
+  std::unique_lock<std::mutex> lock(m_lock);
+  for(;;) {
+    m_changed.wait_for(lock, std::chrono::milliseconds(200), [this]() {
+      return !m_queue.empty() || m_stop || signalled;
+    });
+    if(signalled) { m_stop = true; }
+    if(m_stop) { break; }
+    if(m_queue.empty()) { continue; }
+    Request r = m_queue.front();
+    m_queue.pop_front();
+    lock.unlock();
+
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    std::string reply;
+    bool ok = false;
+    try {
+      ok = handler(r.data, reply);
+    } catch(const std::exception& e) {
+      reply = e.what();
+    }
+    Reply(r.fd, ok, reply);
+    close(r.fd);
+    MESSAGE("Request %u %s after %.1f ms", ++served,
+            ok ? "served" : "failed",
+            std::chrono::duration<double, std::milli>(
+              std::chrono::steady_clock::now() - start).count());
+    lock.lock();
+  }
+  m_changed.notify_all();
+
+  while(!m_queue.empty()) {
+    Reply(m_queue.front().fd, false, "the server is shutting down");
+    close(m_queue.front().fd);
+    m_queue.pop_front();
+  }
+  lock.unlock();
+  sigaction(SIGINT, &oldInt, NULL);
+  sigaction(SIGTERM, &oldTerm, NULL);
+  MESSAGE("Stopped serving after %u requests", served);
+}
+
+#else
+
+RenderServer::RenderServer(const std::string&, size_t) :
+  m_listen(-1), m_maxQueued(0), m_stop(true)
+{
+  throw std::runtime_error("the render server needs Unix domain sockets");
+}
+
+RenderServer::~RenderServer() {}
+void RenderServer::Run(const Handler&) {}
+void RenderServer::Stop() {}
+void RenderServer::Receive() {}
+void RenderServer::Reply(int, bool, const std::string&) {}
+
+#endif
+
+}
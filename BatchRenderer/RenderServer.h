@@ -0,0 +1,98 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    RenderServer.h
+  \brief   Serves render requests on a local socket, so data sets, shaders
+           and caches stay loaded between them.
+*/
+
+#ifndef BATCHRENDERER_RENDERSERVER_H
+#define BATCHRENDERER_RENDERSERVER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "StdTuvokDefines.h"
+
+namespace tuvok
+{
+
+/// Accepts requests on a Unix domain socket.  A client connects, sends the
+/// request and shuts down its side of the connection; the reply is
+///   OK <bytes>\n<bytes of data>     or     ERROR <bytes>\n<message>
+/// after which the server closes the connection.  A thread receives the
+/// requests of all clients at once and queues the complete ones, while Run
+/// executes them one after another on the calling thread, which owns the GL
+/// context.  Only the user who started the server may connect.  Unix only.
+class RenderServer
+{
+public:
+  /// false and an error message in 'reply' if the request failed.
+  typedef std::function<bool (const std::string& request,
+                              std::string& reply)> Handler;
+
+  /// Listens on 'path', replacing a stale socket there; throws
+  /// std::runtime_error if that is not possible.  Requests beyond
+  /// 'maxQueued' are turned away with an error.
+  explicit RenderServer(const std::string& path, size_t maxQueued=64);
+  /// stops receiving and removes the socket.
+  ~RenderServer();
+
+  /// Executes requests until Stop is called or the process gets SIGINT or
+  /// SIGTERM; requests which are queued by then are turned away.
+  void Run(const Handler& handler);
+  /// may be called from a handler.
+  void Stop();
+
+private:
+  struct Request {
+    int fd;
+    std::string data;
+  };
+
+  void Receive();
+  static void Reply(int fd, bool ok, const std::string& data);
+
+  std::string m_path;
+  int m_listen;
+  size_t m_maxQueued;
+  std::thread m_receiver;
+  std::mutex m_lock;
+  std::condition_variable m_changed;
+  std::deque<Request> m_queue;
+  bool m_stop;
+};
+
+}
+
+#endif /* BATCHRENDERER_RENDERSERVER_H */
@@ -88,5 +88,27 @@ void TuvokLuaScriptExec::execFile(const std::string& filename)
   }
 }
 
+//------------------------------------------------------------------------------
+bool TuvokLuaScriptExec::execString(const std::string& code,
+                                    const std::string& name,
+                                    std::string& result)
+{
+  std::shared_ptr<LuaScripting> ss = Controller::Instance().LuaScript();
+  lua_State* L = ss->getLuaState();
+  const int top = lua_gettop(L);
+  int err = luaL_loadbuffer(L, code.data(), code.size(), name.c_str());
+  if(err == 0) { err = lua_pcall(L, 0, 1, 0); }
+
+  result.clear();
+  if(lua_gettop(L) > top && lua_isstring(L, -1)) {
+    size_t len = 0;
+    const char* s = lua_tolstring(L, -1, &len);
+    result.assign(s, len);
+  } else if(err != 0) {
+    result = "Unknown Lua error";
+  }
+  lua_settop(L, top);
+  return err == 0;
+}
 
 } // end of namespace tuvok
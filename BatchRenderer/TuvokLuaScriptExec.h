@@ -50,6 +50,12 @@ public:
   /// Executes the file given by the parameter 'filename'.
   void execFile(const std::string& filename);
 
+  /// Executes the chunk 'code' in the same Lua state as the scripts.  On
+  /// success 'result' holds what the chunk returned if that was a string or
+  /// number; otherwise false is returned and 'result' is the error.
+  bool execString(const std::string& code, const std::string& name,
+                  std::string& result);
+
 private:
 
 };
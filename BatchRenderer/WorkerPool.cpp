@@ -0,0 +1,238 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    WorkerPool.cpp
+  \brief   Runs copies of the batch renderer which split a frame list.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef DETECTED_OS_WINDOWS
+# include <process.h>
+# include <windows.h>
+#else
+# include <signal.h>
+# include <spawn.h>
+# include <sys/wait.h>
+# include <unistd.h>
+extern char** environ;
+#endif
+
+#include "WorkerPool.h"
+#include "Controller/Controller.h"
+
+namespace tuvok
+{
+
+namespace {
+  // The workers share the machine: limit the threads each of them starts
+  // (OpenMP in Tuvok, llvmpipe when rendering through OSMesa) to its part of
+  // the cores, unless the user chose a value.
+  void share_cores(const char* variable, uint32_t count) {
+    if(getenv(variable) != NULL) { return; }
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::ostringstream value;
+    value << std::max(1u, cores / count);
+#ifdef DETECTED_OS_WINDOWS
+    _putenv_s(variable, value.str().c_str());
+#else
+    setenv(variable, value.str().c_str(), 0);
+#endif
+  }
+
+  std::string executable(const std::string& argv0) {
+#ifdef DETECTED_OS_LINUX
+    char path[4096];
+    const ssize_t len = readlink("/proc/self/exe", path, sizeof(path)-1);
+    if(len > 0) { return std::string(path, static_cast<size_t>(len)); }
+#endif
+    return argv0;
+  }
+
+#ifdef DETECTED_OS_WINDOWS
+  // the arguments are joined into one command line by _spawnv.
+  std::string quote(const std::string& arg) {
+    if(!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+      return arg;
+    }
+    std::string q = "\"";
+    for(size_t i=0; i < arg.size(); ++i) {
+      if(arg[i] == '"') { q += '\\'; }
+      q += arg[i];
+    }
+    return q + "\"";
+  }
+#endif
+}
+
+WorkerPool::WorkerPool(const std::string& argv0,
+                       const std::vector<std::string>& args, uint32_t count)
+{
+  share_cores("OMP_NUM_THREADS", count);
+  share_cores("LP_NUM_THREADS", count);
+
+  const std::string exe = executable(argv0);
+  for(uint32_t k=0; k < count; ++k) {
+    std::vector<std::string> wargs(1, exe);
+    wargs.insert(wargs.end(), args.begin(), args.end());
+    std::ostringstream index, total;
+    index << k;
+    total << count;
+    wargs.push_back("--worker");  wargs.push_back(index.str());
+    wargs.push_back("--workers"); wargs.push_back(total.str());
+
+    std::vector<char*> wargv;
+    for(size_t i=0; i < wargs.size(); ++i) {
+#ifdef DETECTED_OS_WINDOWS
+      wargs[i] = quote(wargs[i]);
+#endif
+      wargv.push_back(&wargs[i][0]);
+    }
+    wargv.push_back(NULL);
+
+    Worker w;
+    w.start = std::chrono::steady_clock::now();
+    w.running = true;
+#ifdef DETECTED_OS_WINDOWS
+    w.pid = _spawnvp(_P_NOWAIT, exe.c_str(), &wargv[0]);
+    if(w.pid == -1) {
+#else
+    pid_t pid;
+    const int err = posix_spawnp(&pid, exe.c_str(), NULL, NULL, &wargv[0],
+                                 environ);
+    w.pid = pid;
+    if(err != 0) {
+      errno = err;
+#endif
+      const std::string why = strerror(errno);
+      // the others could not do without this one.
+      Stop();
+      Wait();
+      throw std::runtime_error("could not start worker " + index.str() +
+                               " (" + exe + "): " + why);
+    }
+    m_workers.push_back(w);
+  }
+  MESSAGE("Started %u workers", count);
+}
+
+WorkerPool::~WorkerPool()
+{
+  Wait();
+}
+
+void WorkerPool::Stop()
+{
+  for(size_t i=0; i < m_workers.size(); ++i) {
+    if(!m_workers[i].running) { continue; }
+#ifdef DETECTED_OS_WINDOWS
+    TerminateProcess(reinterpret_cast<HANDLE>(m_workers[i].pid), 1);
+#else
+    kill(static_cast<pid_t>(m_workers[i].pid), SIGTERM);
+#endif
+  }
+}
+
+uint32_t WorkerPool::Wait(bool stopOnFailure)
+{
+  uint32_t failed = 0;
+  size_t running = 0;
+  for(size_t i=0; i < m_workers.size(); ++i) {
+    if(m_workers[i].running) { ++running; }
+  }
+
+  while(running > 0) {
+    int status = 0;
+#ifdef DETECTED_OS_WINDOWS
+    // no wait-for-any; the workers get similar shares, so waiting in order
+    // delays the report of an early one only a little.
+    size_t k = 0;
+    while(!m_workers[k].running) { ++k; }
+    if(_cwait(&status, m_workers[k].pid, _WAIT_CHILD) == -1) {
+      status = -1;
+    }
+    const bool exited = status >= 0;
+    const int code = status;
+#else
+    // reap in the order the workers finish, so the times are accurate.
+    const pid_t pid = waitpid(-1, &status, 0);
+    if(pid == -1) {
+      if(errno == EINTR) { continue; }
+      T_ERROR("Lost track of %u workers: %s", static_cast<unsigned>(running),
+              strerror(errno));
+      failed += static_cast<uint32_t>(running);
+      for(size_t i=0; i < m_workers.size(); ++i) {
+        m_workers[i].running = false;
+      }
+      break;
+    }
+    size_t k = 0;
+    while(k < m_workers.size() &&
+          !(m_workers[k].running && m_workers[k].pid == pid)) { ++k; }
+    if(k == m_workers.size()) { continue; } // not one of ours
+    const bool exited = WIFEXITED(status);
+    const int code = exited ? WEXITSTATUS(status) : WTERMSIG(status);
+#endif
+    m_workers[k].running = false;
+    --running;
+
+    const double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - m_workers[k].start).count();
+    if(exited && code == 0) {
+      MESSAGE("Worker %u finished after %.1f s", static_cast<unsigned>(k),
+              seconds);
+      continue;
+    }
+    ++failed;
+    if(!exited) {
+#ifdef DETECTED_OS_WINDOWS
+      WARNING("Worker %u could not be waited for", static_cast<unsigned>(k));
+#else
+      WARNING("Worker %u was killed by signal %d after %.1f s",
+              static_cast<unsigned>(k), code, seconds);
+#endif
+    } else {
+      WARNING("Worker %u failed after %.1f s (exit status %d)",
+              static_cast<unsigned>(k), seconds, code);
+    }
+    if(stopOnFailure) {
+      Stop();
+      stopOnFailure = false;
+    }
+  }
+  return failed;
+}
+
+}
@@ -0,0 +1,82 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    WorkerPool.h
+  \brief   Runs copies of the batch renderer which split a frame list.
+*/
+
+#ifndef BATCHRENDERER_WORKERPOOL_H
+#define BATCHRENDERER_WORKERPOOL_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "StdTuvokDefines.h"
+
+namespace tuvok
+{
+
+/// Starts 'count' copies of the running executable with the given arguments
+/// plus "--worker k --workers count".  Every worker creates its own context
+/// and loads the data set itself; scripts use tuvok.workerIndex() and
+/// tuvok.workerCount() to pick their share of the frames (renderFrames in
+/// RenderFrames.lua does so), and all workers write into the same output
+/// directory.  A worker reports back through its exit status, which is the
+/// number of frames it could not write.
+class WorkerPool
+{
+public:
+  /// 'argv0' is only used where the executable cannot be found otherwise.
+  WorkerPool(const std::string& argv0, const std::vector<std::string>& args,
+             uint32_t count);
+  /// waits for workers which are still running.
+  ~WorkerPool();
+
+  /// Waits for all workers, logs how each one finished and returns the
+  /// number of workers which did not succeed.  With 'stopOnFailure' the
+  /// others are terminated as soon as one fails, for workers which depend
+  /// on each other.
+  uint32_t Wait(bool stopOnFailure=false);
+
+private:
+  /// terminates the workers which are still running.
+  void Stop();
+
+  struct Worker {
+    intptr_t pid;
+    std::chrono::steady_clock::time_point start;
+    bool running;
+  };
+  std::vector<Worker> m_workers;
+};
+
+}
+
+#endif /* BATCHRENDERER_WORKERPOOL_H */
@@ -29,8 +29,12 @@
 /// Simple batch renderer using Tuvok.
 /// This file is dead simple as most of the logic resides in Lua files.
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
 
 #include "GLEW/GL/glew.h"
 #include "tclap/CmdLine.h"
@@ -41,11 +45,19 @@
 #include "Controller/MasterController.h"
 
 #include "BatchContext.h"
+#include "Compositor.h"
+#include "FrameQueue.h"
+#include "RenderServer.h"
+#include "../Common/ShaderBinaryCache.h"
 #include "TuvokLuaScriptExec.h"
+#include "WorkerPool.h"
 
 using namespace std;
 using namespace tuvok;
 
+// Where linked shader programs are kept between runs; empty to disable.
+static std::string shaderCache;
+
 std::shared_ptr<BatchContext> createContext(uint32_t width, uint32_t height,
                                             int32_t color_bits,
                                             int32_t depth_bits,
@@ -60,27 +72,180 @@ std::shared_ptr<BatchContext> createContext(uint32_t width, uint32_t height,
     std::cerr << "Could not utilize context.";
     return std::shared_ptr<BatchContext>();
   }
+  if(!shaderCache.empty()) { ShaderBinaryCache::Install(shaderCache); }
 
   return ctx;
 }
 
+// Frames queued from Lua; created with the first one, so the encoder threads
+// only exist for scripts which use them.
+static std::unique_ptr<FrameQueue> frameQueue;
+static uint32_t failedFrames = 0;
+
+// Which share of the frames this process renders; see WorkerPool.
+static uint32_t workerIndex = 0;
+static uint32_t workerCount = 1;
+// Threads which write queued frames; 0 picks them from the cores.
+static uint32_t encoderCount = 0;
+
+static FrameQueue& frames()
+{
+  if(!frameQueue) {
+    // workers split the cores between them, and each renders, too.
+    unsigned encoders = encoderCount;
+    if(encoders == 0 && workerCount > 1) {
+      const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+      encoders = std::max(2u, cores / workerCount) - 1;
+    }
+    frameQueue.reset(new FrameQueue(encoders));
+  }
+  return *frameQueue;
+}
+
+bool queueFrame(std::string filename, uint32_t width, uint32_t height,
+                bool keepAlpha)
+{
+  const bool ok = frames().Queue(filename, width, height, keepAlpha);
+  if(!ok) { ++failedFrames; }
+  return ok;
+}
+
+// Set in workers which render parts of a volume instead of whole frames.
+static std::unique_ptr<Compositor> compositor;
+
+bool compositeFrame(std::string filename, uint32_t width, uint32_t height,
+                    bool keepAlpha, float order)
+{
+  if(!compositor) { return queueFrame(filename, width, height, keepAlpha); }
+  std::vector<uint8_t> image;
+  const bool ok = compositor->Composite(width, height, order, image);
+  if(!ok) { ++failedFrames; }
+  if(workerIndex == 0) {
+    frames().QueueImage(filename, width, height, keepAlpha, image);
+  }
+  return ok;
+}
+
+uint32_t finishFrames()
+{
+  const uint32_t failed = frameQueue ? frameQueue->Finish() : 0;
+  failedFrames += failed;
+  return failed;
+}
+
+// Server mode: requests are Lua chunks, and their reply is what they return
+// unless they set one with tuvok.reply or tuvok.replyFrame.
+static RenderServer* server = NULL;
+static std::string serverReply;
+static bool hasServerReply = false;
+
+void reply(std::string data)
+{
+  serverReply = data;
+  hasServerReply = true;
+}
+
+bool replyFrame(uint32_t width, uint32_t height, std::string format,
+                bool keepAlpha)
+{
+  std::vector<uint8_t> pixels(size_t(width) * size_t(height) * 4);
+  if(pixels.empty() || !ReadFramebuffer(width, height, &pixels[0]) ||
+     !EncodeImage(&pixels[0], width, height, keepAlpha, format,
+                  serverReply)) {
+    return false;
+  }
+  hasServerReply = true;
+  return true;
+}
+
+void stopServer()
+{
+  if(server) { server->Stop(); }
+}
+
+uint32_t getWorkerIndex() { return workerIndex; }
+uint32_t getWorkerCount() { return workerCount; }
+
 int main(int argc, const char* argv[])
 {
   // Read Lua filename from the first program argument
   std::string filename;
   bool debug = false;
+  bool worker = false;
+  bool composite = false;
+  std::string segment;
+  std::string socketPath;
   try
   {
     TCLAP::CmdLine cmd("Lua batch renderer");
     TCLAP::ValueArg<string> luaFile("f", "script", "Script to execute.", true,
                                     "", "filename");
     TCLAP::SwitchArg dbg("g", "debug", "Enable debugging mode", false);
+    TCLAP::ValueArg<uint32_t> workers("w", "workers", "Split the frames "
+                                      "rendered with renderFrames between "
+                                      "this many processes.", false, 1,
+                                      "count");
+    TCLAP::SwitchArg compositeArg("c", "composite", "Let the workers "
+                                  "render parts of a volume and composite "
+                                  "them (see RenderParts.lua), instead of "
+                                  "splitting the frames.", false);
+    TCLAP::ValueArg<string> serve("s", "serve", "After running the script, "
+                                  "keep its data sets and context and "
+                                  "execute Lua requests from this socket "
+                                  "(see RenderServer.lua).", false, "",
+                                  "socket");
+    TCLAP::ValueArg<string> cacheArg("", "shader-cache", "Directory for "
+                                     "linked shader programs, which are "
+                                     "reused by later runs on the same "
+                                     "driver.", false,
+                                     ShaderBinaryCache::DefaultDirectory(),
+                                     "directory");
+    TCLAP::SwitchArg noCache("", "no-shader-cache", "Link all shader "
+                             "programs, without reading or writing the "
+                             "cache.", false);
+    TCLAP::ValueArg<uint32_t> encodersArg("", "encoders", "Threads which "
+                                          "write the frames of each "
+                                          "process; by default its share "
+                                          "of the cores, less one.", false,
+                                          0, "count");
+    TCLAP::ValueArg<uint32_t> workerArg("", "worker", "Used internally: "
+                                        "index of this worker process.",
+                                        false, 0, "index");
+    TCLAP::ValueArg<string> segmentArg("", "segment", "Used internally: "
+                                       "shared memory for compositing.",
+                                       false, "", "name");
     cmd.add(luaFile);
     cmd.add(dbg);
+    cmd.add(workers);
+    cmd.add(compositeArg);
+    cmd.add(serve);
+    cmd.add(cacheArg);
+    cmd.add(noCache);
+    cmd.add(encodersArg);
+    cmd.add(workerArg);
+    cmd.add(segmentArg);
     cmd.parse(argc, argv);
 
     filename = luaFile.getValue();
     debug = dbg.getValue();
+    worker = workerArg.isSet();
+    workerIndex = workerArg.getValue();
+    workerCount = std::max(1u, workers.getValue());
+    encoderCount = encodersArg.getValue();
+    composite = compositeArg.getValue();
+    segment = segmentArg.getValue();
+    socketPath = serve.getValue();
+    shaderCache = noCache.getValue() ? std::string() : cacheArg.getValue();
+    if(!socketPath.empty() && workerCount > 1) {
+      std::cerr << "Error: --serve and --workers cannot be combined"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    if(worker && workerIndex >= workerCount) {
+      std::cerr << "Error: worker " << workerIndex << " of " << workerCount
+                << std::endl;
+      return EXIT_FAILURE;
+    }
   }
   catch (const TCLAP::ArgException& e)
   {
@@ -93,6 +258,56 @@ int main(int argc, const char* argv[])
     Controller::Instance().DebugOut()->SetOutput(true, true, false, false);
   }
 
+  if(workerCount > 1 && !worker)
+  {
+    // Coordinator: the workers run the script, each with its own context.
+    try
+    {
+      std::vector<std::string> args;
+      args.push_back("-f");
+      args.push_back(filename);
+      if(debug) { args.push_back("-g"); }
+      if(encoderCount > 0) {
+        std::ostringstream encoders;
+        encoders << encoderCount;
+        args.push_back("--encoders");
+        args.push_back(encoders.str());
+      }
+      if(shaderCache.empty()) {
+        args.push_back("--no-shader-cache");
+      } else {
+        args.push_back("--shader-cache");
+        args.push_back(shaderCache);
+      }
+      if(composite) {
+        segment = Compositor::CreateSegment(workerCount);
+        args.push_back("--segment");
+        args.push_back(segment);
+      }
+      uint32_t failed = 0;
+      try {
+        WorkerPool pool(argv[0], args, workerCount);
+        // compositing workers wait for each other; if one is gone, the
+        // others would wait forever.
+        failed = pool.Wait(composite);
+      } catch(...) {
+        if(composite) { Compositor::RemoveSegment(segment); }
+        throw;
+      }
+      if(composite) { Compositor::RemoveSegment(segment); }
+      if(failed > 0) {
+        std::cerr << failed << " of " << workerCount << " workers failed\n";
+        return EXIT_FAILURE;
+      }
+      return EXIT_SUCCESS;
+    }
+    catch(const std::exception& e)
+    {
+      std::cerr << "Exception: " << e.what() << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
   try
   {
     // Register context creation function
@@ -100,14 +315,72 @@ int main(int argc, const char* argv[])
     /// \todo Investigate why we can't use lambdas in function regisrtation.
     ss->registerFunction(createContext, "tuvok.createContext",
                          "Creates a rendering context and returns it.", false);
+    ss->registerFunction(queueFrame, "tuvok.queueFrame",
+                         "Reads back the current frame (filename, width, "
+                         "height, keep alpha) and writes it in the "
+                         "background.", false);
+    ss->registerFunction(finishFrames, "tuvok.finishFrames",
+                         "Waits for all queued frames to be written and "
+                         "returns the number of failures.", false);
+    ss->registerFunction(getWorkerIndex, "tuvok.workerIndex",
+                         "Index of this process when the frames are split "
+                         "between workers (0 otherwise).", false);
+    ss->registerFunction(getWorkerCount, "tuvok.workerCount",
+                         "Number of processes the frames are split "
+                         "between.", false);
+
+    ss->registerFunction(compositeFrame, "tuvok.compositeFrame",
+                         "Like queueFrame, but blends the images of all "
+                         "workers (filename, width, height, keep alpha, "
+                         "order; smaller orders are in front).", false);
+    if(worker && !segment.empty()) {
+      compositor.reset(new Compositor(segment, workerIndex, workerCount));
+    }
+
+    ss->registerFunction(reply, "tuvok.reply",
+                         "Sets the reply to the current server request.",
+                         false);
+    ss->registerFunction(replyFrame, "tuvok.replyFrame",
+                         "Replies to the current server request with the "
+                         "current frame (width, height, image format, keep "
+                         "alpha).", false);
+    ss->registerFunction(stopServer, "tuvok.stopServer",
+                         "Stops the server after the current request.",
+                         false);
 
     TuvokLuaScriptExec luaExec;
     luaExec.execFile(filename);
+    // frames still queued must be read back while the context exists.
+    finishFrames();
+
+    if(!socketPath.empty()) {
+      RenderServer rs(socketPath);
+      server = &rs;
+      rs.Run([&luaExec](const std::string& request, std::string& out) {
+        serverReply.clear();
+        hasServerReply = false;
+        std::string result;
+        const bool ok = luaExec.execString(request, "request", result);
+        if(!ok) {
+          out = result;
+        } else {
+          out = hasServerReply ? serverReply : result;
+        }
+        serverReply.clear();
+        return ok;
+      });
+      server = NULL;
+      finishFrames();
+    }
+    ShaderBinaryCache::LogStatistics();
   } 
   catch(const std::exception& e)
   {
     std::cerr << "Exception: " << e.what() << "\n";
     return EXIT_FAILURE;
   }
+  // a worker tells the coordinator how many of its frames were lost.
+  if(worker) { return static_cast<int>(std::min(failedFrames, 125u)); }
+  return EXIT_SUCCESS;
 }
 
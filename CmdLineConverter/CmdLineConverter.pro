@@ -27,6 +27,7 @@ macx:QMAKE_CFLAGS   += -mmacosx-version-min=10.7
 macx:LIBS           += -stdlib=libc++ -framework CoreFoundation
 macx:LIBS           += -mmacosx-version-min=10.7
 QMAKE_CXXFLAGS_WARN_ON += -Wno-unknown-pragmas
+!macx:unix:QMAKE_CXXFLAGS += -fopenmp
 !macx:unix:QMAKE_LFLAGS += -fopenmp
 # Try to link to GLU statically.
 gludirs = /usr/lib /usr/lib/x86_64-linux-gnu
@@ -70,8 +71,36 @@ unix:QMAKE_CXXFLAGS += -fno-strict-aliasing
 unix:QMAKE_CFLAGS += -fno-strict-aliasing
 
 # Input
-HEADERS += DebugOut/HRConsoleOut.h
+HEADERS += DebugOut/HRConsoleOut.h \
+           DebugOut/ProgressOut.h \
+           IO/CodecSelector.h \
+           IO/ConversionJournal.h \
+           IO/MemoryAccountant.h \
+           IO/MeshPipeline.h \
+           IO/NRRDSource.h \
+           IO/SplitVolume.h \
+           IO/StackIngest.h \
+           IO/StencilExpression.h \
+           IO/StreamingExport.h \
+           IO/TempSpacePlanner.h \
+           IO/UVFBrickSource.h \
+           IO/VolumeSource.h
 
 
 SOURCES += DebugOut/HRConsoleOut.cpp \
+           DebugOut/ProgressOut.cpp \
+           IO/CodecSelector.cpp \
+           IO/ConversionJournal.cpp \
+           IO/MemoryAccountant.cpp \
+           IO/MeshPipeline.cpp \
+           IO/NRRDSource.cpp \
+           IO/SplitVolume.cpp \
+           IO/StackIngest.cpp \
+           IO/StencilExpression.cpp \
+           IO/StreamingExport.cpp \
+           IO/TempSpacePlanner.cpp \
+           IO/UVFBrickSource.cpp \
+           IO/VolumeSource.cpp \
            main.cpp
+
+include(../Common/Common.pri)
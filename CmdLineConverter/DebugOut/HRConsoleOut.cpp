@@ -37,55 +37,79 @@
 
 #include <algorithm>
 #include <cstdarg>
-#include <cstring>
 #include <iostream>
+#include <string>
 
 #include "HRConsoleOut.h"
 #include "../../Tuvok/Basics/Console.h"
 
 HRConsoleOut::HRConsoleOut() :
   m_iLengthLastMessage(0),
-  m_bClearOldMessage(false)
+  m_bClearOldMessage(false),
+  m_bPending(false)
 {
 }
 
 HRConsoleOut::~HRConsoleOut() {
+  Flush();
 }
 
 void HRConsoleOut::printf(enum DebugChannel channel, const char*,
                           const char* msg)
 {
-  char buff[16384];
-#ifdef WIN32
-  strncpy_s(buff, 16384, msg, 16384);
-#else
-  strncpy(buff, msg, 16384);
-#endif
-
+  const bool transient = m_bClearOldMessage && channel == CHANNEL_MESSAGE;
+  std::string line(msg);
   if (m_bClearOldMessage) {
     // Remove any newlines from the string.
-    for (size_t i=0;i<strlen(buff);i++) {
-      if (buff[i] == '\n') {
-        buff[i] = ' ';
-      }
+    std::replace(line.begin(), line.end(), '\n', ' ');
+  }
+
+  if (transient) {
+    // the line is overwritten by the next message anyway; the bricking
+    // loops log far faster than anyone can read, so redraw at most 10
+    // times a second.  A skipped message is kept, it may be the last one
+    // before a long step.
+    const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+    if (now - m_lastRedraw < std::chrono::milliseconds(100)) {
+      m_pending.swap(line);
+      m_bPending = true;
+      return;
     }
+    m_lastRedraw = now;
+    m_bPending = false;
+  } else {
+    Flush();
+  }
+  Draw(line, transient);
+}
+
+void HRConsoleOut::Flush()
+{
+  if (!m_bPending) {
+    return;
   }
+  m_bPending = false;
+  m_lastRedraw = std::chrono::steady_clock::now();
+  Draw(m_pending, true);
+}
 
-  std::cout << "\r" << buff;
+void HRConsoleOut::Draw(const std::string& line, bool transient)
+{
+  std::cout << "\r" << line;
 
-  if (m_bClearOldMessage && channel == CHANNEL_MESSAGE) {
-    size_t len = strlen(buff);
+  if (transient) {
     // Clear the rest of the line, in case this message is shorter than the
     // last one was.
-    for (size_t i=len;i<m_iLengthLastMessage;i++) {
-      std::cout << " ";
+    if (line.size() < m_iLengthLastMessage) {
+      std::cout << std::string(m_iLengthLastMessage - line.size(), ' ');
     }
-    m_iLengthLastMessage = len;
+    m_iLengthLastMessage = line.size();
+    std::cout.flush();
   } else {
     std::cout << std::endl;
     m_iLengthLastMessage = 0;
   }
-  std::cout.flush();
 }
 
 void HRConsoleOut::printf(const char *s) const
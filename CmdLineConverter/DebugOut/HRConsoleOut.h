@@ -41,6 +41,8 @@
 #ifndef HRCONSOLEOUT_H
 #define HRCONSOLEOUT_H
 
+#include <chrono>
+#include <string>
 #include "../../Tuvok/DebugOut/AbstrDebugOut.h"
 
 class HRConsoleOut : public AbstrDebugOut{
@@ -55,9 +57,18 @@ class HRConsoleOut : public AbstrDebugOut{
                         const char* msg);
     virtual void printf(const char *s) const;
 
+    /// Shows the last status message if it was skipped by the redraw limit.
+    void Flush();
+
   private:
+    void Draw(const std::string& line, bool transient);
+
     size_t m_iLengthLastMessage;
     bool   m_bClearOldMessage;
+    std::chrono::steady_clock::time_point m_lastRedraw;
+    /// latest status message which was not drawn yet
+    std::string m_pending;
+    bool   m_bPending;
 };
 
 #endif // HRCONSOLEOUT_H
@@ -0,0 +1,231 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    ProgressOut.cpp
+  \brief   Machine readable progress: newline-delimited JSON records on a
+           file descriptor or file, for schedulers running headless
+           conversions.
+*/
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include "ProgressOut.h"
+
+namespace {
+  std::string quote(const std::string& s) {
+    std::string out("\"");
+    for(std::string::const_iterator c = s.begin(); c != s.end(); ++c) {
+      switch(*c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+          if(static_cast<unsigned char>(*c) < 0x20) {
+            char esc[8];
+            std::snprintf(esc, sizeof(esc), "\\u%04x", unsigned(*c));
+            out += esc;
+          } else {
+            out += *c;
+          }
+      }
+    }
+    return out + "\"";
+  }
+
+  std::string number(double v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f", v);
+    return buf;
+  }
+
+  FILE* open_target(const std::string& target, bool& owned) {
+    owned = true;
+    if(!target.empty() &&
+       target.find_first_not_of("0123456789") == std::string::npos) {
+      const int fd = std::atoi(target.c_str());
+      // closing the standard streams would break later output
+      owned = fd > 2;
+#ifdef _WIN32
+      return _fdopen(fd, "w");
+#else
+      return fdopen(fd, "w");
+#endif
+    }
+    return std::fopen(target.c_str(), "w");
+  }
+}
+
+ProgressOut::ProgressOut(const std::string& target, double interval) :
+  m_file(NULL),
+  m_bOwnsFile(false),
+  m_start(Clock::now()),
+  m_interval(std::chrono::duration_cast<Clock::duration>(
+               std::chrono::duration<double>(interval))),
+  m_nextProgress(0),
+  m_phaseBytes(0),
+  m_phaseStart(m_start)
+{
+  m_file = open_target(target, m_bOwnsFile);
+}
+
+ProgressOut::~ProgressOut() {
+  if(!m_file) { return; }
+  if(m_bOwnsFile) {
+    std::fclose(m_file);
+  } else {
+    std::fflush(m_file);
+  }
+}
+
+double ProgressOut::Seconds(Clock::time_point since) const
+{
+  return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+void ProgressOut::Emit(const std::string& fields) const
+{
+  if(!m_file) { return; }
+  const std::string record = "{" + fields + ",\"time\":" +
+                             number(Seconds(m_start)) + "}\n";
+  std::fputs(record.c_str(), m_file);
+  std::fflush(m_file);
+}
+
+void ProgressOut::SetPhase(const std::string& phase, uint64_t bytes)
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  m_phase = phase;
+  m_phaseBytes = bytes;
+  m_phaseStart = Clock::now();
+  // the first message of the new phase is always reported.
+  m_nextProgress = 0;
+  std::ostringstream fields;
+  fields << "\"event\":\"phase\",\"phase\":" << quote(phase);
+  if(bytes > 0) { fields << ",\"bytes_total\":" << bytes; }
+  Emit(fields.str());
+}
+
+void ProgressOut::Done(int status)
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  std::ostringstream fields;
+  fields << "\"event\":\"done\",\"status\":" << status;
+  Emit(fields.str());
+}
+
+void ProgressOut::printf(enum DebugChannel channel, const char* source,
+                         const char* msg)
+{
+  if(channel == CHANNEL_ERROR || channel == CHANNEL_WARNING) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    Emit(std::string("\"event\":\"") +
+         (channel == CHANNEL_ERROR ? "error" : "warning") +
+         "\",\"phase\":" + quote(m_phase) + ",\"message\":" + quote(msg));
+    return;
+  }
+  if(channel != CHANNEL_MESSAGE) { return; }
+
+  // the bricking loops log thousands of messages; all but one per interval
+  // are dropped before doing any work.
+  const Clock::rep now = Clock::now().time_since_epoch().count();
+  Clock::rep next = m_nextProgress.load(std::memory_order_relaxed);
+  if(now < next ||
+     !m_nextProgress.compare_exchange_strong(next,
+                                             now + m_interval.count())) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  std::ostringstream fields;
+  fields << "\"event\":\"progress\",\"phase\":" << quote(m_phase)
+         << ",\"step\":" << quote(source ? source : "")
+         << ",\"message\":" << quote(msg);
+  double percent = 0.0;
+  if(ParsePercent(msg, percent)) {
+    fields << ",\"percent\":" << number(percent);
+    if(m_phaseBytes > 0) {
+      fields << ",\"bytes\":" << uint64_t(double(m_phaseBytes) * percent/100.0)
+             << ",\"bytes_total\":" << m_phaseBytes;
+    }
+    if(percent > 0.0) {
+      const double elapsed = Seconds(m_phaseStart);
+      fields << ",\"eta\":" << number(elapsed * (100.0 - percent) / percent);
+    }
+  }
+  Emit(fields.str());
+}
+
+void ProgressOut::printf(const char *s) const
+{
+  std::lock_guard<std::mutex> lock(m_lock);
+  Emit("\"event\":\"message\",\"message\":" + quote(s));
+}
+
+bool ProgressOut::ParsePercent(const char* msg, double& percent)
+{
+  // "... 42.5% ..."
+  for(const char* p = std::strchr(msg, '%'); p; p = std::strchr(p+1, '%')) {
+    const char* b = p;
+    while(b > msg && b[-1] == ' ') { --b; }
+    const char* e = b;
+    while(b > msg && (std::isdigit(static_cast<unsigned char>(b[-1])) ||
+                      b[-1] == '.')) {
+      --b;
+    }
+    if(b < e) {
+      percent = std::atof(b);
+      if(percent >= 0.0 && percent <= 100.0) { return true; }
+    }
+  }
+  // "... brick 3 of 8 ..." or "... 3/8 ..."
+  for(const char* p = msg; *p; ++p) {
+    if(!std::isdigit(static_cast<unsigned char>(*p)) ||
+       (p > msg && std::isdigit(static_cast<unsigned char>(p[-1])))) {
+      continue;
+    }
+    char* end;
+    const double done = double(std::strtoull(p, &end, 10));
+    const char* q = end;
+    if(std::strncmp(q, " of ", 4) == 0) { q += 4; }
+    else if(*q == '/') { ++q; }
+    else { continue; }
+    if(!std::isdigit(static_cast<unsigned char>(*q))) { continue; }
+    const double total = double(std::strtoull(q, &end, 10));
+    if(total > 0.0 && done <= total) {
+      percent = 100.0 * done / total;
+      return true;
+    }
+  }
+  return false;
+}
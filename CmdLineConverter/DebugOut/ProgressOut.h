@@ -0,0 +1,99 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    ProgressOut.h
+  \brief   Machine readable progress: newline-delimited JSON records on a
+           file descriptor or file, for schedulers running headless
+           conversions.
+*/
+
+#pragma once
+
+#ifndef PROGRESSOUT_H
+#define PROGRESSOUT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/DebugOut/AbstrDebugOut.h"
+
+/// Writes one JSON object per line:
+///   {"event":"phase","phase":"uvf","bytes_total":N,"time":T}
+///   {"event":"progress","phase":"uvf","step":"<function>","message":"...",
+///    "percent":P,"bytes":B,"bytes_total":N,"eta":S,"time":T}
+///   {"event":"warning"|"error","phase":"uvf","message":"...","time":T}
+///   {"event":"done","status":0,"time":T}
+/// 'time' and 'eta' are in seconds.  Percentages are taken from the
+/// messages ("42%", "brick 3 of 8"); 'bytes' and 'eta' are extrapolated
+/// from them and only present when known.  Progress records are written at
+/// most once per interval: a message arriving sooner costs one clock read.
+class ProgressOut : public AbstrDebugOut {
+  public:
+    /// 'target' is a file descriptor number (e.g. "3") or a filename.
+    explicit ProgressOut(const std::string& target, double interval=0.5);
+    virtual ~ProgressOut();
+
+    bool IsOpen() const { return m_file != NULL; }
+
+    /// starts a new phase; 'bytes' is the amount of data it processes, or 0
+    /// if unknown.
+    void SetPhase(const std::string& phase, uint64_t bytes=0);
+    /// the conversion finished with the given exit status.
+    void Done(int status);
+
+    virtual void printf(enum DebugChannel, const char* source,
+                        const char* msg);
+    virtual void printf(const char *s) const;
+
+    /// extracts a completion percentage from a progress message.
+    static bool ParsePercent(const char* msg, double& percent);
+
+  private:
+    typedef std::chrono::steady_clock Clock;
+
+    /// writes 'fields' plus the time as one record; m_lock must be held.
+    void Emit(const std::string& fields) const;
+    double Seconds(Clock::time_point since) const;
+
+    FILE*             m_file;
+    bool              m_bOwnsFile;
+    Clock::time_point m_start;
+    Clock::duration   m_interval;
+    std::atomic<Clock::rep> m_nextProgress;
+    std::string       m_phase;
+    uint64_t          m_phaseBytes;
+    Clock::time_point m_phaseStart;
+    mutable std::mutex m_lock;
+};
+
+#endif // PROGRESSOUT_H
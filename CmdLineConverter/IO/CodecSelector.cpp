@@ -0,0 +1,391 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    CodecSelector.cpp
+  \brief   Picks the brick compression codec which best fits an objective
+           by trial-compressing a sample of a volume's bricks.
+*/
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "CodecSelector.h"
+#include "MemoryAccountant.h"
+#include "UVFBrickSource.h"
+#include "VolumeSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/IO/ExtendedOctree/ZlibCompression.h"
+#include "../../Tuvok/IO/ExtendedOctree/LzmaCompression.h"
+#include "../../Tuvok/IO/ExtendedOctree/LZ4Compression.h"
+#include "../../Tuvok/IO/ExtendedOctree/BZlibCompression.h"
+
+// LZHAM is not in the list: it is optional in Tuvok builds.
+static const COMPRESSION_TYPE CANDIDATES[] = {
+  CT_NONE, CT_LZ4, CT_ZLIB, CT_LZMA, CT_BZLIB
+};
+static const size_t N_CANDIDATES = sizeof(CANDIDATES)/sizeof(CANDIDATES[0]);
+/// bricks read before they are compressed in parallel; fewer if the memory
+/// budget does not have room for them.
+static const size_t BATCH_SIZE = 32;
+
+namespace {
+  std::shared_ptr<uint8_t> alloc(size_t bytes) {
+    return std::shared_ptr<uint8_t>(new uint8_t[bytes],
+                                    std::default_delete<uint8_t[]>());
+  }
+
+  struct Trial {
+    uint64_t bytes;
+    double decodeTime;
+    bool ok;
+  };
+
+  // compresses 'src' with 'codec', decodes it again and checks the result.
+  Trial trial(COMPRESSION_TYPE codec, const std::vector<uint8_t>& src,
+              uint32_t level)
+  {
+    Trial t = { src.size(), 0.0, true };
+    if(codec == CT_NONE) { return t; }
+
+    std::shared_ptr<uint8_t> in = alloc(src.size());
+    std::memcpy(in.get(), src.data(), src.size());
+    std::shared_ptr<uint8_t> packed;
+    std::array<uint8_t, 5> lzmaProps;
+    switch(codec) {
+      case CT_ZLIB:  t.bytes = zCompress(in, src.size(), packed, level); break;
+      case CT_LZMA:  t.bytes = lzmaCompress(in, src.size(), packed,
+                                            lzmaProps, level); break;
+      case CT_LZ4:   t.bytes = lz4Compress(in, src.size(), packed, level);
+                     break;
+      case CT_BZLIB: t.bytes = bzCompress(in, src.size(), packed, level);
+                     break;
+      default: t.ok = false; return t;
+    }
+
+    std::shared_ptr<uint8_t> out = alloc(src.size());
+    const std::chrono::high_resolution_clock::time_point start =
+      std::chrono::high_resolution_clock::now();
+    switch(codec) {
+      case CT_ZLIB:  zDecompress(packed, out, src.size()); break;
+      case CT_LZMA:  lzmaDecompress(packed, out, src.size(), lzmaProps); break;
+      case CT_LZ4:   lz4Decompress(packed, out, src.size()); break;
+      case CT_BZLIB: bzDecompress(packed, out, src.size()); break;
+      default: break;
+    }
+    t.decodeTime = std::chrono::duration<double>(
+      std::chrono::high_resolution_clock::now() - start
+    ).count();
+    t.ok = std::memcmp(out.get(), src.data(), src.size()) == 0;
+    return t;
+  }
+
+  // true if every voxel of the brick has the same value.
+  bool constant(const std::vector<uint8_t>& data, size_t voxelSize) {
+    // the data equals itself shifted by one voxel iff it is constant.
+    return data.size() <= voxelSize ||
+           std::memcmp(data.data(), data.data()+voxelSize,
+                       data.size()-voxelSize) == 0;
+  }
+}
+
+CodecSelector::CodecSelector(Objective objective, uint32_t level) :
+  m_level(level),
+  m_weight(objective == OBJ_SIZE ? 1.0 : objective == OBJ_SPEED ? 0.0 : 0.5),
+  m_bandwidth(200.0*1024*1024),
+  m_rawBytes(0),
+  m_constantBricks(0),
+  m_sampledBricks(0)
+{
+  for(size_t c=0; c < N_CANDIDATES; ++c) {
+    const Stats s = { CANDIDATES[c], 0, 0.0, 0 };
+    m_stats.push_back(s);
+  }
+}
+
+bool CodecSelector::ParseObjective(const std::string& s,
+                                   Objective& objective, double& weight)
+{
+  if(s == "size")     { objective = OBJ_SIZE;     weight = 1.0; return true; }
+  if(s == "speed")    { objective = OBJ_SPEED;    weight = 0.0; return true; }
+  if(s == "balanced") { objective = OBJ_WEIGHTED; weight = 0.5; return true; }
+  char* end = NULL;
+  weight = std::strtod(s.c_str(), &end);
+  objective = OBJ_WEIGHTED;
+  return !s.empty() && *end == '\0' && weight >= 0.0 && weight <= 1.0;
+}
+
+const char* CodecSelector::Name(COMPRESSION_TYPE codec)
+{
+  switch(codec) {
+    case CT_NONE:  return "none";
+    case CT_ZLIB:  return "zlib";
+    case CT_LZMA:  return "lzma";
+    case CT_LZ4:   return "lz4";
+    case CT_BZLIB: return "bzlib";
+    case CT_LZHAM: return "lzham";
+  }
+  return "unknown";
+}
+
+double CodecSelector::LoadTime(uint64_t bytes, double time) const
+{
+  return double(bytes) / m_bandwidth + time;
+}
+
+double CodecSelector::Score(double bytes, double minBytes, double load,
+                            double minLoad) const
+{
+  const double eps = 1e-12;
+  return m_weight * (bytes / std::max(minBytes, eps)) +
+         (1.0 - m_weight) * (load / std::max(minLoad, eps));
+}
+
+// the indices of up to 'maxBricks' of 'total' bricks, spread evenly.
+static std::vector<uint64_t> spread(uint64_t total, uint64_t maxBricks)
+{
+  const uint64_t step = std::max<uint64_t>(1, total / std::max<uint64_t>(1,
+                                                                maxBricks));
+  std::vector<uint64_t> indices;
+  for(uint64_t i=0; i < total && indices.size() < maxBricks; i += step) {
+    indices.push_back(i);
+  }
+  MESSAGE("Trying %u codecs on %u of %llu bricks",
+          static_cast<unsigned>(N_CANDIDATES),
+          static_cast<unsigned>(indices.size()),
+          static_cast<unsigned long long>(total));
+  return indices;
+}
+
+static uint64_t worker_count()
+{
+#ifdef _OPENMP
+  return uint64_t(std::max(1, omp_get_max_threads()));
+#else
+  return 1;
+#endif
+}
+
+void CodecSelector::Add(std::vector<uint8_t>& data, size_t voxelSize,
+                        std::vector<std::vector<uint8_t>>& bricks)
+{
+  ++m_sampledBricks;
+  if(constant(data, voxelSize)) {
+    ++m_constantBricks;
+    return;
+  }
+  m_rawBytes += data.size();
+  bricks.push_back(std::vector<uint8_t>());
+  bricks.back().swap(data);
+}
+
+void CodecSelector::Try(const std::vector<std::vector<uint8_t>>& bricks)
+{
+  const int64_t tasks = int64_t(bricks.size() * N_CANDIDATES);
+  std::vector<Trial> trials(static_cast<size_t>(tasks));
+  #pragma omp parallel for schedule(dynamic)
+  for(int64_t t=0; t < tasks; ++t) {
+    trials[size_t(t)] = trial(CANDIDATES[size_t(t) % N_CANDIDATES],
+                              bricks[size_t(t) / N_CANDIDATES], m_level);
+  }
+
+  for(size_t b=0; b < bricks.size(); ++b) {
+    const Trial* bt = &trials[b*N_CANDIDATES];
+    double minBytes = double(bricks[b].size()), minLoad = 1e30;
+    for(size_t c=0; c < N_CANDIDATES; ++c) {
+      if(!bt[c].ok) { continue; }
+      minBytes = std::min(minBytes, double(bt[c].bytes));
+      minLoad = std::min(minLoad, LoadTime(bt[c].bytes, bt[c].decodeTime));
+    }
+    size_t best = 0;
+    double bestScore = 1e30;
+    for(size_t c=0; c < N_CANDIDATES; ++c) {
+      if(!bt[c].ok) {
+        // a codec which cannot round-trip the data is never chosen.
+        m_stats[c].bytes = std::numeric_limits<uint64_t>::max();
+        continue;
+      }
+      if(m_stats[c].bytes != std::numeric_limits<uint64_t>::max()) {
+        m_stats[c].bytes += bt[c].bytes;
+        m_stats[c].decodeTime += bt[c].decodeTime;
+      }
+      const double score = Score(double(bt[c].bytes), minBytes,
+                                 LoadTime(bt[c].bytes, bt[c].decodeTime),
+                                 minLoad);
+      if(score < bestScore) { bestScore = score; best = c; }
+    }
+    ++m_stats[best].wins;
+  }
+}
+
+void CodecSelector::Sample(const UVFBrickSource& src, uint64_t maxBricks)
+{
+  const UINT64VECTOR3 count = src.GetBrickCount(0);
+  const size_t voxelSize = size_t(src.GetComponentSize() *
+                                  src.GetComponentCount());
+  const std::vector<uint64_t> indices = spread(count.volume(), maxBricks);
+
+  // a trial holds a copy of the brick, the compressed and the decoded data.
+  const uint64_t brickBytes = src.GetMaxBrickSize().volume() * voxelSize;
+  const MemoryAccountant::Reservation scratch(worker_count() * 3 *
+                                              brickBytes);
+  MemoryAccountant::Reservation held;
+
+  std::vector<std::vector<uint8_t>> bricks;
+  for(size_t first=0, n=0; first < indices.size(); first += n) {
+    n = MemoryAccountant::Instance().Fit(
+      brickBytes, std::min(BATCH_SIZE, indices.size()-first), held.Bytes()
+    );
+    held.Resize(n * brickBytes);
+    // reading is serialized in the source anyway; only the codecs run in
+    // parallel.
+    bricks.clear();
+    for(size_t i=first; i < first+n; ++i) {
+      const uint64_t b = indices[i];
+      const UINT64VECTOR4 key(b % count.x, (b / count.x) % count.y,
+                              b / (count.x*count.y), 0);
+      std::vector<uint8_t> data;
+      src.ReadBrick(key, data);
+      Add(data, voxelSize, bricks);
+    }
+    Try(bricks);
+  }
+}
+
+void CodecSelector::Sample(VolumeSource& src, uint64_t brickSize,
+                           uint64_t maxBricks)
+{
+  const VolumeSourceInfo info = src.GetInfo();
+  const size_t voxelSize = size_t(ComponentTypeSize(info.type) *
+                                  info.components);
+  const uint64_t slice = info.size.x * info.size.y * voxelSize;
+  const UINT64VECTOR3 count((info.size.x + brickSize-1) / brickSize,
+                            (info.size.y + brickSize-1) / brickSize,
+                            (info.size.z + brickSize-1) / brickSize);
+  const uint64_t layerBricks = count.x * count.y;
+  const std::vector<uint64_t> indices = spread(count.volume(), maxBricks);
+
+  const uint64_t brickBytes = brickSize*brickSize*brickSize * voxelSize;
+  const MemoryAccountant::Reservation scratch(worker_count() * 3 *
+                                              brickBytes);
+  MemoryAccountant::Reservation held;
+
+  // the indices grow with z, so the layers of bricks are read front to
+  // back, each as one slab of slices; layers without a sampled brick are
+  // skipped.  If the budget has no room for a whole layer, its bricks are
+  // cut thinner.
+  std::vector<uint8_t> slab;
+  std::vector<std::vector<uint8_t>> bricks;
+  for(size_t i=0; i < indices.size();) {
+    const uint64_t layer = indices[i] / layerBricks;
+    const uint64_t z0 = layer * brickSize;
+    const uint64_t depth = MemoryAccountant::Instance().Fit(
+      2*slice, size_t(std::min(brickSize, info.size.z - z0)), held.Bytes()
+    );
+    // the slab and the bricks cut from it.
+    held.Resize(2 * depth * slice);
+    slab.resize(size_t(depth * slice));
+    if(!src.ReadSlab(z0, depth, slab.data())) {
+      throw std::runtime_error("Could not read the slices to sample");
+    }
+
+    bricks.clear();
+    for(; i < indices.size() && indices[i] / layerBricks == layer; ++i) {
+      const uint64_t bx = indices[i] % count.x;
+      const uint64_t by = (indices[i] / count.x) % count.y;
+      const uint64_t x0 = bx * brickSize, y0 = by * brickSize;
+      const uint64_t w = std::min(brickSize, info.size.x - x0);
+      const uint64_t h = std::min(brickSize, info.size.y - y0);
+      std::vector<uint8_t> data(size_t(w * h * depth * voxelSize));
+      uint8_t* out = data.data();
+      for(uint64_t z=0; z < depth; ++z) {
+        for(uint64_t y=0; y < h; ++y) {
+          const uint8_t* row = slab.data() +
+            size_t(z*slice + ((y0+y)*info.size.x + x0) * voxelSize);
+          std::memcpy(out, row, size_t(w * voxelSize));
+          out += w * voxelSize;
+        }
+      }
+      Add(data, voxelSize, bricks);
+    }
+    Try(bricks);
+  }
+}
+
+COMPRESSION_TYPE CodecSelector::GetBest() const
+{
+  if(m_sampledBricks == m_constantBricks) { return CT_ZLIB; }
+
+  double minBytes = 1e30, minLoad = 1e30;
+  for(size_t c=0; c < m_stats.size(); ++c) {
+    if(m_stats[c].bytes == std::numeric_limits<uint64_t>::max()) { continue; }
+    minBytes = std::min(minBytes, double(m_stats[c].bytes));
+    minLoad = std::min(minLoad, LoadTime(m_stats[c].bytes,
+                                         m_stats[c].decodeTime));
+  }
+  COMPRESSION_TYPE best = CT_ZLIB;
+  double bestScore = 1e30;
+  for(size_t c=0; c < m_stats.size(); ++c) {
+    if(m_stats[c].bytes == std::numeric_limits<uint64_t>::max()) { continue; }
+    const double score = Score(double(m_stats[c].bytes), minBytes,
+                               LoadTime(m_stats[c].bytes,
+                                        m_stats[c].decodeTime), minLoad);
+    if(score < bestScore) { bestScore = score; best = m_stats[c].codec; }
+  }
+  return best;
+}
+
+void CodecSelector::Report() const
+{
+  const uint64_t scored = m_sampledBricks - m_constantBricks;
+  MESSAGE("%llu of %llu sampled bricks are constant",
+          static_cast<unsigned long long>(m_constantBricks),
+          static_cast<unsigned long long>(m_sampledBricks));
+  if(scored == 0) { return; }
+  const double raw = double(m_rawBytes);
+  for(size_t c=0; c < m_stats.size(); ++c) {
+    const Stats& s = m_stats[c];
+    if(s.bytes == std::numeric_limits<uint64_t>::max()) {
+      WARNING("%s: failed to round-trip the data, not considered",
+              Name(s.codec));
+      continue;
+    }
+    MESSAGE("%-6s ratio %6.2f, load %8.3f ms/brick, best for %5.1f%% of "
+            "the bricks", Name(s.codec), raw / std::max<double>(1, s.bytes),
+            1000.0 * LoadTime(s.bytes, s.decodeTime) / scored,
+            100.0 * s.wins / scored);
+  }
+}
@@ -0,0 +1,117 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    CodecSelector.h
+  \brief   Picks the brick compression codec which best fits an objective
+           by trial-compressing a sample of a volume's bricks.
+*/
+
+#pragma once
+
+#ifndef CODECSELECTOR_H
+#define CODECSELECTOR_H
+
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/IO/UVF/TOCBlock.h"
+
+class UVFBrickSource;
+class VolumeSource;
+
+/// Compresses sampled bricks with every candidate codec in parallel and
+/// records, per codec, the compressed size and the time it takes to load a
+/// brick back (reading the compressed bytes plus decoding them).  Constant
+/// bricks are counted but not scored: they compress to almost nothing with
+/// any codec and would only dilute the comparison.
+class CodecSelector {
+public:
+  enum Objective {
+    OBJ_SIZE,     ///< smallest file, e.g. for archival copies
+    OBJ_SPEED,    ///< fastest brick loads, e.g. for interactive sessions
+    OBJ_WEIGHTED  ///< mix of both, see SetWeight
+  };
+
+  CodecSelector(Objective objective, uint32_t level);
+
+  /// parses "size", "speed", "balanced" or a size weight in [0,1].
+  static bool ParseObjective(const std::string& s, Objective& objective,
+                             double& weight);
+  /// importance of size vs. load time for OBJ_WEIGHTED; 0.5 is balanced.
+  void SetWeight(double sizeWeight) { m_weight = sizeWeight; }
+  /// disk throughput assumed when estimating load times, in bytes/second.
+  void SetReadBandwidth(double bytesPerSecond) { m_bandwidth = bytesPerSecond; }
+
+  /// trial-compresses up to 'maxBricks' bricks of the finest level, spread
+  /// evenly over the volume.
+  void Sample(const UVFBrickSource& src, uint64_t maxBricks);
+  /// the same for a volume which is not bricked yet: the bricks of
+  /// 'brickSize'^3 voxels are cut from slabs of 'src', which therefore must
+  /// not be the source the volume is then converted from.  Throws if the
+  /// source cannot be read.
+  void Sample(VolumeSource& src, uint64_t brickSize, uint64_t maxBricks);
+
+  /// the codec which best meets the objective over all sampled bricks;
+  /// CT_ZLIB if nothing was sampled.
+  COMPRESSION_TYPE GetBest() const;
+  /// logs the per-codec statistics.
+  void Report() const;
+
+  static const char* Name(COMPRESSION_TYPE codec);
+
+private:
+  struct Stats {
+    COMPRESSION_TYPE codec;
+    uint64_t bytes;     ///< total compressed size
+    double decodeTime;  ///< total decode time in seconds
+    uint64_t wins;      ///< bricks for which this codec scored best
+  };
+  /// counts a sampled brick; unless it is constant, it is moved to
+  /// 'bricks' to be tried.
+  void Add(std::vector<uint8_t>& data, size_t voxelSize,
+           std::vector<std::vector<uint8_t>>& bricks);
+  /// tries every codec on 'bricks' and adds up the results.
+  void Try(const std::vector<std::vector<uint8_t>>& bricks);
+  /// estimated time to load 'bytes' compressed bytes which decode in 'time'.
+  double LoadTime(uint64_t bytes, double time) const;
+  /// lower is better; all values are relative to the best candidate.
+  double Score(double bytes, double minBytes, double load,
+               double minLoad) const;
+
+  uint32_t m_level;
+  double m_weight;
+  double m_bandwidth;
+  uint64_t m_rawBytes;        ///< uncompressed size of the scored bricks
+  uint64_t m_constantBricks;
+  uint64_t m_sampledBricks;
+  std::vector<Stats> m_stats;
+};
+
+#endif // CODECSELECTOR_H
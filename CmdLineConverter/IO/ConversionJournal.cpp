@@ -0,0 +1,294 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    ConversionJournal.cpp
+  \brief   Sidecar journal which allows interrupted conversions to resume.
+*/
+
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+#include "ConversionJournal.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/SysTools.h"
+
+// Journal records, one per line:
+//   uvfconvert-journal 1
+//   input <bytes> <filename>
+//   begin <stage>
+//   tmp <stage> <filename>        temp file present when <stage> began
+//   brick <stage> <index> <checksum>
+//   done <stage>
+static const char* JOURNAL_MAGIC = "uvfconvert-journal 1";
+
+static uint64_t file_size(const std::string& filename)
+{
+  std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary |
+                                    std::ios::ate);
+  return f.is_open() ? uint64_t(f.tellg()) : 0;
+}
+
+static std::string rest_of_line(std::istringstream& is)
+{
+  std::string s;
+  std::getline(is >> std::ws, s);
+  return s;
+}
+
+ConversionJournal::ConversionJournal(const std::string& output,
+                                     const std::vector<std::string>& inputs,
+                                     const std::vector<std::string>& tempDirs,
+                                     bool resume) :
+  m_filename(JournalFilename(output)),
+  m_tempDirs(tempDirs),
+  m_bResuming(false)
+{
+  if(resume && SysTools::FileExists(m_filename)) {
+    Load(inputs);
+  }
+  if(m_bResuming) {
+    MESSAGE("Resuming conversion: %u stage(s) already completed.",
+            static_cast<unsigned>(m_done.size()));
+    m_out.open(m_filename.c_str(), std::ios::out | std::ios::app);
+    return;
+  }
+
+  // the journal is only created once the first stage begins, so modes which
+  // have nothing to resume do not leave one behind.
+  std::remove(m_filename.c_str());
+  m_pending.push_back(JOURNAL_MAGIC);
+  for(std::vector<std::string>::const_iterator i = inputs.begin();
+      i != inputs.end(); ++i) {
+    std::ostringstream rec;
+    rec << "input " << file_size(*i) << " " << *i;
+    m_pending.push_back(rec.str());
+  }
+}
+
+ConversionJournal::~ConversionJournal() {}
+
+std::string ConversionJournal::JournalFilename(const std::string& output)
+{
+  return output + ".journal";
+}
+
+std::string ConversionJournal::ScratchName(const std::string& output)
+{
+  // the hash tells apart outputs of the same name in different directories
+  // which share a --tempdir.
+  std::ostringstream name;
+  name << SysTools::GetFilename(output) << "." << std::hex
+       << std::setw(8) << std::setfill('0')
+       << uint32_t(Checksum(output.data(), output.size())) << ".scratch";
+  return name.str();
+}
+
+void ConversionJournal::Load(const std::vector<std::string>& inputs)
+{
+  std::ifstream in(m_filename.c_str());
+  std::string line;
+  if(!std::getline(in, line) || line != JOURNAL_MAGIC) {
+    WARNING("'%s' is not a conversion journal; starting over.",
+            m_filename.c_str());
+    return;
+  }
+
+  size_t nInputs = 0;
+  bool changed = false;
+  while(!changed && std::getline(in, line)) {
+    std::istringstream is(line);
+    std::string type;
+    is >> type;
+    if(type == "input") {
+      uint64_t bytes = 0;
+      is >> bytes;
+      const std::string name = rest_of_line(is);
+      if(nInputs >= inputs.size() || inputs[nInputs] != name ||
+         file_size(name) != bytes) {
+        WARNING("Input '%s' changed since the interrupted conversion; "
+                "starting over.", name.c_str());
+        changed = true;
+        continue;
+      }
+      ++nInputs;
+    } else if(type == "begin") {
+      m_tempBefore[rest_of_line(is)];
+    } else if(type == "tmp") {
+      std::string stage;
+      is >> stage;
+      m_tempBefore[stage].insert(rest_of_line(is));
+    } else if(type == "brick") {
+      std::string stage;
+      uint64_t brick = 0, checksum = 0;
+      // a record torn by the crash fails to parse and is simply dropped.
+      if(is >> stage >> brick >> checksum) {
+        m_bricks[stage][brick] = checksum;
+      }
+    } else if(type == "done") {
+      m_done.insert(rest_of_line(is));
+    }
+  }
+  if(!changed && nInputs != inputs.size()) {
+    WARNING("The inputs changed since the interrupted conversion; "
+            "starting over.");
+    changed = true;
+  }
+  m_bResuming = !changed;
+  if(!m_bResuming) {
+    // nothing of the old run may leak into the fresh journal.
+    m_done.clear();
+    m_tempBefore.clear();
+    m_bricks.clear();
+  }
+}
+
+void ConversionJournal::Write(const std::string& record)
+{
+  if(!m_pending.empty()) {
+    m_out.open(m_filename.c_str(), std::ios::out | std::ios::trunc);
+    if(!m_out.is_open()) {
+      WARNING("Could not create conversion journal '%s'; this conversion "
+              "cannot be resumed.", m_filename.c_str());
+    }
+    for(size_t i=0; i < m_pending.size() && m_out.is_open(); ++i) {
+      m_out << m_pending[i] << "\n";
+    }
+    m_pending.clear();
+  }
+  if(!m_out.is_open()) { return; }
+  m_out << record << "\n";
+  m_out.flush();
+}
+
+std::set<std::string> ConversionJournal::ListTempFiles() const
+{
+  std::set<std::string> files;
+  for(std::vector<std::string>::const_iterator d = m_tempDirs.begin();
+      d != m_tempDirs.end(); ++d) {
+    const std::vector<std::string> entries =
+      SysTools::GetDirContents(d->empty() ? "./" : *d, "*", "tmp");
+    files.insert(entries.begin(), entries.end());
+  }
+  return files;
+}
+
+void ConversionJournal::RemoveNewTempFiles(const std::string& stage)
+{
+  const std::set<std::string>& before = m_tempBefore[stage];
+  const std::set<std::string> now = ListTempFiles();
+  for(std::set<std::string>::const_iterator f = now.begin(); f != now.end();
+      ++f) {
+    if(before.find(*f) != before.end()) { continue; }
+    MESSAGE("Removing leftover temporary file '%s'", f->c_str());
+    if(std::remove(f->c_str()) != 0) {
+      WARNING("Could not remove '%s'", f->c_str());
+    }
+  }
+}
+
+void ConversionJournal::BeginStage(const std::string& stage)
+{
+  if(m_tempBefore.find(stage) != m_tempBefore.end()) {
+    // the stage was started by the interrupted run: whatever temporary
+    // files it created are garbage now.
+    RemoveNewTempFiles(stage);
+    return;
+  }
+  Write("begin " + stage);
+  const std::set<std::string> files = ListTempFiles();
+  m_tempBefore[stage] = files;
+  for(std::set<std::string>::const_iterator f = files.begin();
+      f != files.end(); ++f) {
+    Write("tmp " + stage + " " + *f);
+  }
+}
+
+void ConversionJournal::EndStage(const std::string& stage)
+{
+  m_done.insert(stage);
+  Write("done " + stage);
+}
+
+void ConversionJournal::AbortStage(const std::string& stage)
+{
+  RemoveNewTempFiles(stage);
+}
+
+bool ConversionJournal::IsStageDone(const std::string& stage) const
+{
+  return m_done.find(stage) != m_done.end();
+}
+
+void ConversionJournal::MarkBrickDone(const std::string& stage,
+                                      uint64_t brick, uint64_t checksum)
+{
+  m_bricks[stage][brick] = checksum;
+  std::ostringstream rec;
+  rec << "brick " << stage << " " << brick << " " << checksum;
+  Write(rec.str());
+}
+
+bool ConversionJournal::GetBrickChecksum(const std::string& stage,
+                                         uint64_t brick,
+                                         uint64_t& checksum) const
+{
+  std::map<std::string, std::map<uint64_t,uint64_t>>::const_iterator s =
+    m_bricks.find(stage);
+  if(s == m_bricks.end()) { return false; }
+  std::map<uint64_t,uint64_t>::const_iterator b = s->second.find(brick);
+  if(b == s->second.end()) { return false; }
+  checksum = b->second;
+  return true;
+}
+
+size_t ConversionJournal::GetBrickDoneCount(const std::string& stage) const
+{
+  std::map<std::string, std::map<uint64_t,uint64_t>>::const_iterator s =
+    m_bricks.find(stage);
+  return s == m_bricks.end() ? 0 : s->second.size();
+}
+
+void ConversionJournal::Finish()
+{
+  m_pending.clear();
+  m_out.close();
+  std::remove(m_filename.c_str());
+}
+
+uint64_t ConversionJournal::Checksum(const void* data, size_t bytes)
+{
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  uint64_t h = 14695981039346656037ULL;
+  for(size_t i=0; i < bytes; ++i) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
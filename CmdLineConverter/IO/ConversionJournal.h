@@ -0,0 +1,118 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    ConversionJournal.h
+  \brief   Sidecar journal which allows interrupted conversions to resume.
+*/
+
+#pragma once
+
+#ifndef CONVERSIONJOURNAL_H
+#define CONVERSIONJOURNAL_H
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+
+/// Records the progress of a conversion in "<output>.journal".  The journal
+/// is append-only and flushed after every record, so it survives a crash or
+/// kill at any point.  A conversion consists of named stages (a whole
+/// ConvertDataset call, one stack of a directory, ...); stages which write
+/// bricks themselves can additionally record every finished brick together
+/// with a checksum of its data, so a resumed run only has to verify, not
+/// recompute, them.
+///
+/// Temporary files are only ever removed from the conversion's own scratch
+/// directories (see ScratchName), so conversions sharing a scratch or
+/// output directory do not delete each other's files.
+class ConversionJournal {
+public:
+  /// If 'resume' is set and a journal for the same inputs exists, its state
+  /// is picked up; otherwise any previous journal is discarded.
+  /// Temporary files are tracked in all of 'tempDirs', which must be
+  /// private to this conversion.
+  ConversionJournal(const std::string& output,
+                    const std::vector<std::string>& inputs,
+                    const std::vector<std::string>& tempDirs, bool resume);
+  ~ConversionJournal();
+
+  static std::string JournalFilename(const std::string& output);
+  /// Name of the subdirectory of each scratch directory which holds the
+  /// intermediates of the conversion to 'output'.  It depends on the full
+  /// output path only, so a resumed run finds the same directories.
+  static std::string ScratchName(const std::string& output);
+
+  /// Starts a stage.  When resuming a stage which was interrupted, the
+  /// temporary files left behind by it are removed first.
+  void BeginStage(const std::string& stage);
+  void EndStage(const std::string& stage);
+  /// Removes the temporary files created since the stage began; for stages
+  /// which failed in this run.
+  void AbortStage(const std::string& stage);
+  bool IsStageDone(const std::string& stage) const;
+  /// whether the state of an interrupted run with the same inputs was
+  /// picked up.
+  bool IsResuming() const { return m_bResuming; }
+
+  void MarkBrickDone(const std::string& stage, uint64_t brick,
+                     uint64_t checksum);
+  /// false if the brick was not recorded as finished.
+  bool GetBrickChecksum(const std::string& stage, uint64_t brick,
+                        uint64_t& checksum) const;
+  size_t GetBrickDoneCount(const std::string& stage) const;
+
+  /// The conversion succeeded; the journal is removed.
+  void Finish();
+
+  /// 64bit FNV-1a hash; used for the per-brick checksums.
+  static uint64_t Checksum(const void* data, size_t bytes);
+
+private:
+  void Load(const std::vector<std::string>& inputs);
+  void Write(const std::string& record);
+  std::set<std::string> ListTempFiles() const;
+  void RemoveNewTempFiles(const std::string& stage);
+
+  std::string m_filename;
+  std::vector<std::string> m_tempDirs;
+  bool m_bResuming;
+  std::ofstream m_out;
+  /// records to write once the journal file is actually needed.
+  std::vector<std::string> m_pending;
+  std::set<std::string> m_done;
+  /// temp files which already existed when a stage began.
+  std::map<std::string, std::set<std::string>> m_tempBefore;
+  std::map<std::string, std::map<uint64_t, uint64_t>> m_bricks;
+};
+
+#endif // CONVERSIONJOURNAL_H
@@ -0,0 +1,182 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    MemoryAccountant.cpp
+  \brief   Tracks the converter's in-flight brick buffers and the measured
+           resident set size against the user's memory budget.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#ifdef _WIN32
+# include <windows.h>
+# include <psapi.h>
+# pragma comment(lib, "psapi.lib")
+#elif defined(__APPLE__)
+# include <mach/mach.h>
+# include <sys/resource.h>
+#else
+# include <sys/resource.h>
+# include <unistd.h>
+#endif
+
+#include "MemoryAccountant.h"
+#include "../../Tuvok/Controller/Controller.h"
+
+MemoryAccountant& MemoryAccountant::Instance()
+{
+  static MemoryAccountant accountant;
+  return accountant;
+}
+
+MemoryAccountant::MemoryAccountant() :
+  m_budget(0),
+  m_baseline(0),
+  m_reserved(0),
+  m_peakReserved(0)
+{
+}
+
+void MemoryAccountant::SetBudget(uint64_t bytes)
+{
+  m_budget = bytes;
+  m_baseline = CurrentRSS();
+}
+
+void MemoryAccountant::Acquire(uint64_t bytes)
+{
+  const uint64_t now = (m_reserved += bytes);
+  uint64_t peak = m_peakReserved.load();
+  while(now > peak && !m_peakReserved.compare_exchange_weak(peak, now)) {}
+}
+
+void MemoryAccountant::Release(uint64_t bytes)
+{
+  m_reserved -= bytes;
+}
+
+uint64_t MemoryAccountant::Available()
+{
+  if(m_budget == 0) { return std::numeric_limits<uint64_t>::max(); }
+  const uint64_t used = std::max(CurrentRSS(), m_baseline + m_reserved);
+  return used < m_budget ? m_budget - used : 0;
+}
+
+size_t MemoryAccountant::Fit(uint64_t itemBytes, size_t wanted, uint64_t held)
+{
+  wanted = std::max<size_t>(1, wanted);
+  if(m_budget == 0 || itemBytes == 0) { return wanted; }
+  const uint64_t avail = Available();
+  const uint64_t n = (avail == std::numeric_limits<uint64_t>::max())
+                     ? wanted : (avail + held) / itemBytes;
+  // at least one item, or nothing would ever make progress.
+  return size_t(std::max<uint64_t>(1, std::min<uint64_t>(n, wanted)));
+}
+
+uint64_t MemoryAccountant::CurrentRSS()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if(!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return 0;
+  }
+  return uint64_t(pmc.WorkingSetSize);
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+               reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return uint64_t(info.resident_size);
+#else
+  // the second field of statm is the resident size in pages.
+  FILE* f = std::fopen("/proc/self/statm", "r");
+  if(!f) { return 0; }
+  unsigned long long pages = 0, resident = 0;
+  const int fields = std::fscanf(f, "%llu %llu", &pages, &resident);
+  std::fclose(f);
+  if(fields != 2) { return 0; }
+  return uint64_t(resident) * uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+uint64_t MemoryAccountant::PeakRSS()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if(!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return 0;
+  }
+  return uint64_t(pmc.PeakWorkingSetSize);
+#else
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+# ifdef __APPLE__
+  return uint64_t(usage.ru_maxrss);       // bytes
+# else
+  return uint64_t(usage.ru_maxrss) * 1024; // kilobytes
+# endif
+#endif
+}
+
+void MemoryAccountant::Report() const
+{
+  const uint64_t mb = 1024*1024;
+  const uint64_t peak = PeakRSS();
+  MESSAGE("Peak memory use: %llu MB resident, %llu MB in brick buffers",
+          static_cast<unsigned long long>(peak / mb),
+          static_cast<unsigned long long>(m_peakReserved / mb));
+  if(m_budget != 0 && peak > m_budget) {
+    WARNING("The peak resident size exceeded the memory budget of %llu MB",
+            static_cast<unsigned long long>(m_budget / mb));
+  }
+}
+
+MemoryAccountant::Reservation::Reservation(uint64_t bytes) : m_bytes(bytes)
+{
+  MemoryAccountant::Instance().Acquire(m_bytes);
+}
+
+MemoryAccountant::Reservation::~Reservation()
+{
+  MemoryAccountant::Instance().Release(m_bytes);
+}
+
+void MemoryAccountant::Reservation::Resize(uint64_t bytes)
+{
+  MemoryAccountant& accountant = MemoryAccountant::Instance();
+  if(bytes > m_bytes) {
+    accountant.Acquire(bytes - m_bytes);
+  } else {
+    accountant.Release(m_bytes - bytes);
+  }
+  m_bytes = bytes;
+}
@@ -0,0 +1,110 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    MemoryAccountant.h
+  \brief   Tracks the converter's in-flight brick buffers and the measured
+           resident set size against the user's memory budget.
+*/
+
+#pragma once
+
+#ifndef MEMORYACCOUNTANT_H
+#define MEMORYACCOUNTANT_H
+
+#include <atomic>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+
+/// The memory budget of the converter's own pipelines.  Streaming export,
+/// codec selection, the directory stack reader and volume sources ask how
+/// many more brick rows, trial bricks, slices or slabs fit before
+/// allocating them, and so stay within the budget.  Stencil evaluation only
+/// reserves its fixed per-brick buffers, which the others then leave room
+/// for.  "Used" is the larger of what was reserved and what the operating
+/// system reports as resident, so memory held by Tuvok, the allocator or a
+/// previous stage is accounted for even though nobody reserved it.
+///
+/// The bricking and LOD generation in ConvertDataset (Tuvok's
+/// FlatDataToBrickedLOD) does not consult this budget; it is only bounded
+/// by the in-core limit given to the Controller.
+class MemoryAccountant {
+public:
+  static MemoryAccountant& Instance();
+
+  /// the budget in bytes; 0 disables the limit.  The resident size at this
+  /// point is taken as the baseline the reservations add to.
+  void SetBudget(uint64_t bytes);
+  uint64_t GetBudget() const { return m_budget; }
+
+  void Acquire(uint64_t bytes);
+  void Release(uint64_t bytes);
+
+  /// bytes of the budget which are neither reserved nor resident;
+  /// UINT64_MAX without a budget.
+  uint64_t Available();
+  /// How many items of 'itemBytes' each fit in the budget, at least 1 and
+  /// at most 'wanted'.  'held' are bytes the caller has reserved already
+  /// and will reuse for the items.
+  size_t Fit(uint64_t itemBytes, size_t wanted, uint64_t held=0);
+
+  /// resident set size of the process; 0 where it cannot be determined.
+  static uint64_t CurrentRSS();
+  /// high-water mark of the resident set size, from the operating system.
+  static uint64_t PeakRSS();
+
+  uint64_t GetPeakReserved() const { return m_peakReserved; }
+  /// logs the peak reserved and resident sizes, and warns if they exceeded
+  /// the budget.
+  void Report() const;
+
+  /// Reserves memory for as long as it lives; Resize follows a buffer
+  /// which grows or shrinks.  This is bookkeeping only: it never waits or
+  /// fails, it makes Available and Fit report less to everybody else.
+  class Reservation {
+  public:
+    explicit Reservation(uint64_t bytes=0);
+    ~Reservation();
+    void Resize(uint64_t bytes);
+    uint64_t Bytes() const { return m_bytes; }
+  private:
+    Reservation(const Reservation&);
+    Reservation& operator=(const Reservation&);
+    uint64_t m_bytes;
+  };
+
+private:
+  MemoryAccountant();
+
+  uint64_t m_budget;
+  uint64_t m_baseline;
+  std::atomic<uint64_t> m_reserved;
+  std::atomic<uint64_t> m_peakReserved;
+};
+
+#endif // MEMORYACCOUNTANT_H
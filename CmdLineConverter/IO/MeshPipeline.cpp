@@ -0,0 +1,925 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    MeshPipeline.cpp
+  \brief   Fast paths for converting large triangle meshes: a chunked,
+           parallel parser for ASCII OBJ and PLY, vertex welding and
+           streaming writers for binary STL and PLY.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <sstream>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "MeshPipeline.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/EndianConvert.h"
+#include "../../Tuvok/Basics/SysTools.h"
+
+using namespace tuvok;
+
+bool MeshData::IsUnified() const
+{
+  return (nIndices.empty() || nIndices == vIndices) &&
+         (tIndices.empty() || tIndices == vIndices) &&
+         (cIndices.empty() || cIndices == vIndices);
+}
+
+namespace {
+  const size_t BLOCK_SIZE = 64*1024*1024;
+
+  int worker_count() {
+#ifdef _OPENMP
+    return std::max(1, omp_get_max_threads());
+#else
+    return 1;
+#endif
+  }
+
+  inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+  inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+  inline void skip_space(const char*& p, const char* end) {
+    while(p < end && is_space(*p)) { ++p; }
+  }
+
+  double power_of_ten(int e) {
+    static const double exact[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    return e <= 22 ? exact[e] : std::pow(10.0, e);
+  }
+
+  // Parses a decimal number which ends at whitespace or the end of the
+  // line.  Unlike strtof this is independent of the locale, and several
+  // times faster, which is what limits ASCII mesh parsing; the result is
+  // exact to float precision.
+  bool parse_float(const char*& p, const char* end, float& out) {
+    skip_space(p, end);
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); ++p; }
+    // 15 digits are exactly representable as a double
+    const uint64_t limit = 100000000000000ULL;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool digits = false;
+    for(; p < end && is_digit(*p); ++p) {
+      digits = true;
+      if(mantissa < limit) { mantissa = mantissa*10 + uint64_t(*p - '0'); }
+      else { ++exponent; }
+    }
+    if(p < end && *p == '.') {
+      for(++p; p < end && is_digit(*p); ++p) {
+        digits = true;
+        if(mantissa < limit) {
+          mantissa = mantissa*10 + uint64_t(*p - '0');
+          --exponent;
+        }
+      }
+    }
+    if(!digits) { return false; }
+    if(p < end && (*p == 'e' || *p == 'E')) {
+      ++p;
+      bool negExp = false;
+      if(p < end && (*p == '-' || *p == '+')) { negExp = (*p == '-'); ++p; }
+      if(p == end || !is_digit(*p)) { return false; }
+      int e = 0;
+      for(; p < end && is_digit(*p); ++p) {
+        if(e < 1000) { e = e*10 + (*p - '0'); }
+      }
+      exponent += negExp ? -e : e;
+    }
+    double v = double(mantissa);
+    v = exponent < 0 ? v / power_of_ten(-exponent)
+                     : v * power_of_ten(exponent);
+    out = static_cast<float>(negative ? -v : v);
+    return p == end || is_space(*p);
+  }
+
+  bool parse_int(const char*& p, const char* end, int64_t& out) {
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); ++p; }
+    if(p == end || !is_digit(*p)) { return false; }
+    int64_t v = 0;
+    for(; p < end && is_digit(*p); ++p) {
+      if(v > (std::numeric_limits<int64_t>::max() - 9) / 10) { return false; }
+      v = v*10 + (*p - '0');
+    }
+    out = negative ? -v : v;
+    return true;
+  }
+
+  // Splits [begin, end) into up to 'parts' ranges which all end at the end
+  // of a line; some ranges may be empty.
+  std::vector<const char*> split_lines(const char* begin, const char* end,
+                                       size_t parts) {
+    std::vector<const char*> cuts(1, begin);
+    for(size_t i=1; i < parts; ++i) {
+      const char* c = std::max(cuts.back(),
+                               begin + size_t(end-begin) * i / parts);
+      const void* nl = std::memchr(c, '\n', size_t(end-c));
+      cuts.push_back(nl ? static_cast<const char*>(nl) + 1 : end);
+    }
+    cuts.push_back(end);
+    return cuts;
+  }
+
+  // Calls f(lineBegin, lineEnd) for every line, without the '\n'; stops and
+  // returns false as soon as f does.
+  template<typename F>
+  bool for_each_line(const char* p, const char* end, F f) {
+    while(p < end) {
+      const void* nl = std::memchr(p, '\n', size_t(end-p));
+      const char* e = nl ? static_cast<const char*>(nl) : end;
+      if(!f(p, e)) { return false; }
+      p = e + 1;
+    }
+    return true;
+  }
+
+  // Reads 'f' from the current position in blocks of whole lines and calls
+  // parse(begin, end) for each; the next block is read while the previous
+  // one is parsed.
+  template<typename F>
+  bool read_blocks(FILE* f, F parse) {
+    std::vector<char> buf[2];
+    buf[0].resize(BLOCK_SIZE);
+    std::future<size_t> reading = std::async(std::launch::async, [&buf, f]() {
+      return std::fread(buf[0].data(), 1, BLOCK_SIZE, f);
+    });
+    size_t carry = 0;
+    for(int cur=0; ; cur = 1-cur) {
+      const size_t got = reading.get();
+      const bool eof = got < BLOCK_SIZE;
+      if(eof && std::ferror(f)) {
+        T_ERROR("Read error");
+        return false;
+      }
+      std::vector<char>& block = buf[cur];
+      const size_t len = carry + got;
+      size_t end = len;
+      if(!eof) {
+        while(end > 0 && block[end-1] != '\n') { --end; }
+        if(end == 0) {
+          T_ERROR("Line longer than %llu bytes",
+                  static_cast<unsigned long long>(BLOCK_SIZE));
+          return false;
+        }
+        // the partial last line starts the next block.
+        std::vector<char>& next = buf[1-cur];
+        carry = len - end;
+        next.resize(carry + BLOCK_SIZE);
+        std::memcpy(next.data(), block.data() + end, carry);
+        char* dst = next.data() + carry;
+        reading = std::async(std::launch::async, [dst, f]() {
+          return std::fread(dst, 1, BLOCK_SIZE, f);
+        });
+      }
+      if(!parse(block.data(), block.data() + end)) {
+        if(reading.valid()) { reading.wait(); }
+        return false;
+      }
+      if(eof) { return true; }
+    }
+  }
+
+  // indices which can only be resolved once the number of elements before
+  // a part is known: (position in the index list, offset from that number)
+  typedef std::vector<std::pair<size_t, int64_t>> Fixups;
+
+  struct ObjCorner { int64_t v, t, n; };
+
+  struct ObjPart {
+    VertVec vertices;
+    NormVec normals;
+    TexCoordVec texcoords;
+    IndexVec v, t, n;
+    Fixups vFix, tFix, nFix;
+    std::vector<ObjCorner> face;
+
+    void Clear() {
+      vertices.clear(); normals.clear(); texcoords.clear();
+      v.clear(); t.clear(); n.clear();
+      vFix.clear(); tFix.clear(); nFix.clear();
+    }
+  };
+
+  // OBJ indices start at 1; negative ones count back from the last element
+  // read so far.
+  bool push_obj_index(int64_t i, size_t count, IndexVec& out, Fixups& fix) {
+    if(i > 0 && i <= int64_t(std::numeric_limits<uint32_t>::max())) {
+      out.push_back(uint32_t(i-1));
+      return true;
+    }
+    if(i < 0) {
+      fix.push_back(std::make_pair(out.size(), int64_t(count) + i));
+      out.push_back(0);
+      return true;
+    }
+    return false;
+  }
+
+  bool parse_obj_face(const char* p, const char* end, ObjPart& part) {
+    part.face.clear();
+    for(;;) {
+      skip_space(p, end);
+      if(p == end) { break; }
+      ObjCorner c = {0, 0, 0};
+      if(!parse_int(p, end, c.v)) { return false; }
+      if(p < end && *p == '/') {
+        ++p;
+        if(p < end && *p != '/' && !parse_int(p, end, c.t)) { return false; }
+        if(p < end && *p == '/') {
+          ++p;
+          if(!parse_int(p, end, c.n)) { return false; }
+        }
+      }
+      if(p < end && !is_space(*p)) { return false; }
+      part.face.push_back(c);
+    }
+    if(part.face.size() < 3) { return false; }
+    const bool hasT = part.face[0].t != 0;
+    const bool hasN = part.face[0].n != 0;
+    for(size_t i=1; i < part.face.size(); ++i) {
+      if((part.face[i].t != 0) != hasT || (part.face[i].n != 0) != hasN) {
+        return false;
+      }
+    }
+    // polygons are triangulated as fans
+    for(size_t i=1; i+1 < part.face.size(); ++i) {
+      const ObjCorner* tri[3] = { &part.face[0], &part.face[i],
+                                  &part.face[i+1] };
+      for(size_t k=0; k < 3; ++k) {
+        if(!push_obj_index(tri[k]->v, part.vertices.size(), part.v,
+                           part.vFix) ||
+           (hasT && !push_obj_index(tri[k]->t, part.texcoords.size(),
+                                    part.t, part.tFix)) ||
+           (hasN && !push_obj_index(tri[k]->n, part.normals.size(), part.n,
+                                    part.nFix))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool parse_obj_line(const char* p, const char* end, ObjPart& part) {
+    skip_space(p, end);
+    if(p == end || *p == '#') { return true; }
+    const char* keyword = p;
+    while(p < end && !is_space(*p)) { ++p; }
+    const size_t len = size_t(p - keyword);
+
+    if(len == 1 && keyword[0] == 'v') {
+      FLOATVECTOR3 v;
+      if(!parse_float(p, end, v.x) || !parse_float(p, end, v.y) ||
+         !parse_float(p, end, v.z)) {
+        return false;
+      }
+      // an optional w is ignored; vertex colors are left to Tuvok
+      float w;
+      if(parse_float(p, end, w) && parse_float(p, end, w)) { return false; }
+      part.vertices.push_back(v);
+    } else if(len == 2 && keyword[0] == 'v' && keyword[1] == 'n') {
+      FLOATVECTOR3 n;
+      if(!parse_float(p, end, n.x) || !parse_float(p, end, n.y) ||
+         !parse_float(p, end, n.z)) {
+        return false;
+      }
+      part.normals.push_back(n);
+    } else if(len == 2 && keyword[0] == 'v' && keyword[1] == 't') {
+      FLOATVECTOR2 t(0.0f, 0.0f);
+      if(!parse_float(p, end, t.x)) { return false; }
+      parse_float(p, end, t.y);
+      part.texcoords.push_back(t);
+    } else if(len == 1 && keyword[0] == 'f') {
+      return parse_obj_face(p, end, part);
+    } else if(len == 1 && (keyword[0] == 'l' || keyword[0] == 'p')) {
+      // lines and points need a different mesh type
+      return false;
+    }
+    // groups, objects, materials and smoothing groups are ignored
+    return true;
+  }
+
+  bool resolve(IndexVec& indices, const Fixups& fix, size_t base) {
+    for(Fixups::const_iterator f = fix.begin(); f != fix.end(); ++f) {
+      const int64_t i = int64_t(base) + f->second;
+      if(i < 0) { return false; }
+      indices[f->first] = uint32_t(i);
+    }
+    return true;
+  }
+
+  template<typename T>
+  void append(std::vector<T>& to, const std::vector<T>& from) {
+    to.insert(to.end(), from.begin(), from.end());
+  }
+
+  bool parse_obj(FILE* f, MeshData& mesh) {
+    std::vector<ObjPart> parts(size_t(worker_count()) * 4);
+    return read_blocks(f, [&](const char* begin, const char* end) {
+      const std::vector<const char*> cuts = split_lines(begin, end,
+                                                        parts.size());
+      bool ok = true;
+      #pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+      for(int64_t i=0; i < int64_t(parts.size()); ++i) {
+        ObjPart& part = parts[size_t(i)];
+        part.Clear();
+        if(!for_each_line(cuts[size_t(i)], cuts[size_t(i)+1],
+                          [&part](const char* b, const char* e) {
+                            return parse_obj_line(b, e, part);
+                          })) {
+          ok = false;
+        }
+      }
+      if(!ok) { return false; }
+
+      for(size_t i=0; i < parts.size(); ++i) {
+        ObjPart& part = parts[i];
+        if(!resolve(part.v, part.vFix, mesh.vertices.size()) ||
+           !resolve(part.t, part.tFix, mesh.texcoords.size()) ||
+           !resolve(part.n, part.nFix, mesh.normals.size())) {
+          return false;
+        }
+        append(mesh.vertices, part.vertices);
+        append(mesh.normals, part.normals);
+        append(mesh.texcoords, part.texcoords);
+        append(mesh.vIndices, part.v);
+        append(mesh.tIndices, part.t);
+        append(mesh.nIndices, part.n);
+      }
+      return true;
+    });
+  }
+
+  enum PlyAttribute {
+    PLY_X, PLY_Y, PLY_Z, PLY_NX, PLY_NY, PLY_NZ, PLY_U, PLY_V,
+    PLY_RED, PLY_GREEN, PLY_BLUE, PLY_ALPHA, PLY_COUNT, PLY_IGNORE
+  };
+
+  struct PlyHeader {
+    uint64_t vertices;
+    uint64_t faces;
+    /// attribute of every vertex property, in file order
+    std::vector<int> properties;
+    bool has[PLY_COUNT];
+    bool byteColors;
+  };
+
+  int ply_attribute(const std::string& name) {
+    static const char* names[] = {
+      "x", "y", "z", "nx", "ny", "nz", "u", "v",
+      "red", "green", "blue", "alpha"
+    };
+    for(int i=0; i < PLY_COUNT; ++i) {
+      if(name == names[i]) { return i; }
+    }
+    if(name == "s" || name == "texture_u") { return PLY_U; }
+    if(name == "t" || name == "texture_v") { return PLY_V; }
+    return PLY_IGNORE;
+  }
+
+  // Reads the header of an ASCII PLY with a vertex and a face element; the
+  // file is left at the first line of data.
+  bool read_ply_header(FILE* f, PlyHeader& hdr) {
+    hdr.vertices = hdr.faces = 0;
+    std::fill(hdr.has, hdr.has + PLY_COUNT, false);
+    hdr.byteColors = false;
+    std::string element;
+    char buf[1024];
+    for(size_t line=0; std::fgets(buf, sizeof(buf), f); ++line) {
+      std::istringstream is(buf);
+      std::string word;
+      is >> word;
+      if(line == 0) {
+        if(word != "ply") { return false; }
+      } else if(word == "format") {
+        std::string format;
+        is >> format;
+        if(format != "ascii") { return false; }
+      } else if(word == "element") {
+        uint64_t count = 0;
+        is >> element >> count;
+        if(element == "vertex" && hdr.faces == 0) { hdr.vertices = count; }
+        else if(element == "face" && hdr.vertices > 0) { hdr.faces = count; }
+        else { return false; }
+      } else if(word == "property") {
+        std::string type, name;
+        is >> type;
+        if(type == "list") {
+          std::string countType, indexType;
+          is >> countType >> indexType >> name;
+          if(element != "face" ||
+             (name != "vertex_indices" && name != "vertex_index")) {
+            return false;
+          }
+        } else {
+          is >> name;
+          if(element != "vertex") { return false; }
+          const int a = ply_attribute(name);
+          hdr.properties.push_back(a);
+          if(a != PLY_IGNORE) { hdr.has[a] = true; }
+          if(a == PLY_RED) {
+            hdr.byteColors = (type == "uchar" || type == "uint8");
+          }
+        }
+      } else if(word == "end_header") {
+        return hdr.has[PLY_X] && hdr.has[PLY_Y] && hdr.has[PLY_Z];
+      } else if(word != "comment" && word != "obj_info") {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  struct PlyPart {
+    uint64_t firstLine;
+    VertVec vertices;
+    NormVec normals;
+    TexCoordVec texcoords;
+    ColorVec colors;
+    IndexVec v;
+    std::vector<uint32_t> face;
+
+    void Clear() {
+      vertices.clear(); normals.clear(); texcoords.clear(); colors.clear();
+      v.clear();
+    }
+  };
+
+  bool parse_ply_line(const char* p, const char* end, uint64_t line,
+                      const PlyHeader& hdr, PlyPart& part) {
+    if(line < hdr.vertices) {
+      float a[PLY_COUNT] = { 0,0,0, 0,0,0, 0,0, 1,1,1,1 };
+      if(hdr.byteColors) { a[PLY_ALPHA] = 255.0f; }
+      for(size_t i=0; i < hdr.properties.size(); ++i) {
+        float value;
+        if(!parse_float(p, end, value)) { return false; }
+        if(hdr.properties[i] != PLY_IGNORE) { a[hdr.properties[i]] = value; }
+      }
+      part.vertices.push_back(FLOATVECTOR3(a[PLY_X], a[PLY_Y], a[PLY_Z]));
+      if(hdr.has[PLY_NX]) {
+        part.normals.push_back(FLOATVECTOR3(a[PLY_NX], a[PLY_NY], a[PLY_NZ]));
+      }
+      if(hdr.has[PLY_U]) {
+        part.texcoords.push_back(FLOATVECTOR2(a[PLY_U], a[PLY_V]));
+      }
+      if(hdr.has[PLY_RED]) {
+        const float s = hdr.byteColors ? 1.0f/255.0f : 1.0f;
+        part.colors.push_back(FLOATVECTOR4(a[PLY_RED]*s, a[PLY_GREEN]*s,
+                                           a[PLY_BLUE]*s, a[PLY_ALPHA]*s));
+      }
+    } else if(line < hdr.vertices + hdr.faces) {
+      int64_t count = 0;
+      skip_space(p, end);
+      if(!parse_int(p, end, count) || count < 3) { return false; }
+      part.face.clear();
+      for(int64_t i=0; i < count; ++i) {
+        int64_t index = 0;
+        skip_space(p, end);
+        if(!parse_int(p, end, index) || index < 0 ||
+           uint64_t(index) >= hdr.vertices) {
+          return false;
+        }
+        part.face.push_back(uint32_t(index));
+      }
+      for(size_t i=1; i+1 < part.face.size(); ++i) {
+        part.v.push_back(part.face[0]);
+        part.v.push_back(part.face[i]);
+        part.v.push_back(part.face[i+1]);
+      }
+    }
+    return true;
+  }
+
+  bool parse_ply(FILE* f, MeshData& mesh) {
+    PlyHeader hdr;
+    if(!read_ply_header(f, hdr) || hdr.vertices >
+       uint64_t(std::numeric_limits<uint32_t>::max())) {
+      return false;
+    }
+    std::vector<PlyPart> parts(size_t(worker_count()) * 4);
+    uint64_t line = 0;
+    const bool parsed = read_blocks(f, [&](const char* begin,
+                                           const char* end) {
+      const std::vector<const char*> cuts = split_lines(begin, end,
+                                                        parts.size());
+      // the element a line belongs to follows from its number
+      std::vector<uint64_t> lines(parts.size());
+      #pragma omp parallel for
+      for(int64_t i=0; i < int64_t(parts.size()); ++i) {
+        lines[size_t(i)] = uint64_t(std::count(cuts[size_t(i)],
+                                               cuts[size_t(i)+1], '\n'));
+      }
+      for(size_t i=0; i < parts.size(); ++i) {
+        parts[i].firstLine = line;
+        line += lines[i];
+      }
+      bool ok = true;
+      #pragma omp parallel for schedule(dynamic) reduction(&&:ok)
+      for(int64_t i=0; i < int64_t(parts.size()); ++i) {
+        PlyPart& part = parts[size_t(i)];
+        part.Clear();
+        uint64_t l = part.firstLine;
+        if(!for_each_line(cuts[size_t(i)], cuts[size_t(i)+1],
+                          [&](const char* b, const char* e) {
+                            return parse_ply_line(b, e, l++, hdr, part);
+                          })) {
+          ok = false;
+        }
+      }
+      if(!ok) { return false; }
+      for(size_t i=0; i < parts.size(); ++i) {
+        append(mesh.vertices, parts[i].vertices);
+        append(mesh.normals, parts[i].normals);
+        append(mesh.texcoords, parts[i].texcoords);
+        append(mesh.colors, parts[i].colors);
+        append(mesh.vIndices, parts[i].v);
+      }
+      return true;
+    });
+    if(!parsed || mesh.vertices.size() != hdr.vertices) { return false; }
+    // PLY attributes are per vertex
+    if(!mesh.normals.empty())   { mesh.nIndices = mesh.vIndices; }
+    if(!mesh.texcoords.empty()) { mesh.tIndices = mesh.vIndices; }
+    if(!mesh.colors.empty())    { mesh.cIndices = mesh.vIndices; }
+    return true;
+  }
+
+  bool indices_valid(const IndexVec& indices, size_t count) {
+    bool valid = true;
+    #pragma omp parallel for reduction(&&:valid)
+    for(int64_t i=0; i < int64_t(indices.size()); ++i) {
+      valid = valid && indices[size_t(i)] < count;
+    }
+    return valid;
+  }
+}
+
+bool CanParseMesh(const std::string& filename)
+{
+  const std::string ext = SysTools::ToLowerCase(SysTools::GetExt(filename));
+  return ext == "obj" || ext == "ply";
+}
+
+bool ParseMesh(const std::string& filename, MeshData& mesh)
+{
+  mesh = MeshData();
+  FILE* f = std::fopen(filename.c_str(), "rb");
+  if(!f) { return false; }
+  const std::string ext = SysTools::ToLowerCase(SysTools::GetExt(filename));
+  bool ok = ext == "ply" ? parse_ply(f, mesh) : parse_obj(f, mesh);
+  std::fclose(f);
+
+  const size_t corners = mesh.vIndices.size();
+  ok = ok && corners > 0 &&
+       (mesh.nIndices.empty() || mesh.nIndices.size() == corners) &&
+       (mesh.tIndices.empty() || mesh.tIndices.size() == corners) &&
+       (mesh.cIndices.empty() || mesh.cIndices.size() == corners) &&
+       indices_valid(mesh.vIndices, mesh.vertices.size()) &&
+       indices_valid(mesh.nIndices, mesh.normals.size()) &&
+       indices_valid(mesh.tIndices, mesh.texcoords.size()) &&
+       indices_valid(mesh.cIndices, mesh.colors.size());
+  if(!ok) {
+    mesh = MeshData();
+    MESSAGE("'%s' is not handled by the parallel parser.", filename.c_str());
+    return false;
+  }
+  MESSAGE("Parsed %llu vertices and %llu triangles from '%s'",
+          static_cast<unsigned long long>(mesh.vertices.size()),
+          static_cast<unsigned long long>(corners / 3), filename.c_str());
+  return true;
+}
+
+bool FromTuvokMesh(const Mesh& m, MeshData& mesh)
+{
+  if(m.GetMeshType() != Mesh::MT_TRIANGLES) { return false; }
+  mesh.vertices = m.GetVertices();
+  mesh.normals = m.GetNormals();
+  mesh.texcoords = m.GetTexCoords();
+  mesh.colors = m.GetColors();
+  mesh.vIndices = m.GetVertexIndices();
+  mesh.nIndices = m.GetNormalIndices();
+  mesh.tIndices = m.GetTexCoordIndices();
+  mesh.cIndices = m.GetColorIndices();
+  return true;
+}
+
+std::shared_ptr<Mesh> ToTuvokMesh(MeshData& mesh, const std::string& desc)
+{
+  std::shared_ptr<Mesh> m(new Mesh(mesh.vertices, mesh.normals,
+                                   mesh.texcoords, mesh.colors,
+                                   mesh.vIndices, mesh.nIndices,
+                                   mesh.tIndices, mesh.cIndices,
+                                   false, false, desc, Mesh::MT_TRIANGLES));
+  mesh = MeshData();
+  return m;
+}
+
+namespace {
+  inline void hash_bytes(uint64_t& h, const void* data, size_t bytes) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for(size_t i=0; i < bytes; ++i) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+  }
+
+  uint64_t hash_corner(const MeshData& m, size_t c) {
+    uint64_t h = 14695981039346656037ULL;
+    hash_bytes(h, &m.vertices[m.vIndices[c]], sizeof(FLOATVECTOR3));
+    if(!m.nIndices.empty()) {
+      hash_bytes(h, &m.normals[m.nIndices[c]], sizeof(FLOATVECTOR3));
+    }
+    if(!m.tIndices.empty()) {
+      hash_bytes(h, &m.texcoords[m.tIndices[c]], sizeof(FLOATVECTOR2));
+    }
+    if(!m.cIndices.empty()) {
+      hash_bytes(h, &m.colors[m.cIndices[c]], sizeof(FLOATVECTOR4));
+    }
+    return h;
+  }
+
+  template<typename T>
+  bool same(const std::vector<T>& data, const IndexVec& indices,
+            size_t a, size_t b) {
+    return indices.empty() ||
+           std::memcmp(&data[indices[a]], &data[indices[b]], sizeof(T)) == 0;
+  }
+
+  bool same_corner(const MeshData& m, size_t a, size_t b) {
+    return same(m.vertices, m.vIndices, a, b) &&
+           same(m.normals, m.nIndices, a, b) &&
+           same(m.texcoords, m.tIndices, a, b) &&
+           same(m.colors, m.cIndices, a, b);
+  }
+
+  template<typename T>
+  void gather(std::vector<T>& data, const IndexVec& indices,
+              const std::vector<uint32_t>& corners) {
+    if(indices.empty()) { return; }
+    std::vector<T> out(corners.size());
+    #pragma omp parallel for
+    for(int64_t i=0; i < int64_t(corners.size()); ++i) {
+      out[size_t(i)] = data[indices[corners[size_t(i)]]];
+    }
+    data.swap(out);
+  }
+}
+
+void WeldVertices(MeshData& mesh)
+{
+  const size_t corners = mesh.vIndices.size();
+  if(corners == 0) { return; }
+  if(corners > size_t(std::numeric_limits<uint32_t>::max())) {
+    WARNING("Mesh too large to weld.");
+    return;
+  }
+  std::vector<uint64_t> hashes(corners);
+  #pragma omp parallel for
+  for(int64_t i=0; i < int64_t(corners); ++i) {
+    hashes[size_t(i)] = hash_corner(mesh, size_t(i));
+  }
+
+  // open addressing, linear probing; slots hold a vertex number + 1.
+  // 'first' is the corner which defined each vertex.
+  std::vector<uint32_t> first;
+  first.reserve(mesh.vertices.size());
+  size_t capacity = 16;
+  while(capacity < 2*mesh.vertices.size()) { capacity *= 2; }
+  std::vector<uint32_t> table(capacity, 0);
+  IndexVec indices(corners);
+  for(size_t c=0; c < corners; ++c) {
+    size_t slot = size_t(hashes[c]) & (capacity-1);
+    for(;; slot = (slot+1) & (capacity-1)) {
+      const uint32_t id = table[slot];
+      if(id == 0) {
+        first.push_back(uint32_t(c));
+        table[slot] = uint32_t(first.size());
+        indices[c] = uint32_t(first.size() - 1);
+        break;
+      }
+      const uint32_t other = first[id-1];
+      if(hashes[other] == hashes[c] && same_corner(mesh, other, c)) {
+        indices[c] = id-1;
+        break;
+      }
+    }
+    if(2*first.size() > capacity) {
+      capacity *= 2;
+      std::vector<uint32_t>(capacity, 0).swap(table);
+      for(size_t v=0; v < first.size(); ++v) {
+        size_t s = size_t(hashes[first[v]]) & (capacity-1);
+        while(table[s] != 0) { s = (s+1) & (capacity-1); }
+        table[s] = uint32_t(v+1);
+      }
+    }
+  }
+  std::vector<uint64_t>().swap(hashes);
+  std::vector<uint32_t>().swap(table);
+
+  const size_t before = mesh.vertices.size();
+  gather(mesh.vertices, mesh.vIndices, first);
+  gather(mesh.normals, mesh.nIndices, first);
+  gather(mesh.texcoords, mesh.tIndices, first);
+  gather(mesh.colors, mesh.cIndices, first);
+  if(!mesh.nIndices.empty()) { mesh.nIndices = indices; }
+  if(!mesh.tIndices.empty()) { mesh.tIndices = indices; }
+  if(!mesh.cIndices.empty()) { mesh.cIndices = indices; }
+  mesh.vIndices.swap(indices);
+  MESSAGE("Welded %llu vertices into %llu",
+          static_cast<unsigned long long>(before),
+          static_cast<unsigned long long>(mesh.vertices.size()));
+}
+
+namespace {
+  // fwrite through a large buffer; the writers emit one small record at a
+  // time.
+  class BufferedFile {
+  public:
+    explicit BufferedFile(const std::string& filename) :
+      m_file(std::fopen(filename.c_str(), "wb")),
+      m_swap(!EndianConvert::IsLittleEndian())
+    {
+      m_buffer.reserve(BUFFER_SIZE);
+    }
+    ~BufferedFile() { Close(); }
+
+    bool IsOpen() const { return m_file != NULL; }
+
+    void Write(const void* data, size_t bytes) {
+      const char* p = static_cast<const char*>(data);
+      m_buffer.insert(m_buffer.end(), p, p + bytes);
+      if(m_buffer.size() >= BUFFER_SIZE) { Flush(); }
+    }
+    /// writes 'v' little endian, as binary STL requires.
+    template<typename T> void WriteLE(T v) {
+      if(m_swap) {
+        uint8_t* b = reinterpret_cast<uint8_t*>(&v);
+        std::reverse(b, b + sizeof(T));
+      }
+      Write(&v, sizeof(T));
+    }
+
+    bool Close() {
+      if(!m_file) { return false; }
+      Flush();
+      const bool ok = !std::ferror(m_file);
+      const bool closed = std::fclose(m_file) == 0;
+      m_file = NULL;
+      return ok && closed;
+    }
+
+  private:
+    void Flush() {
+      if(!m_buffer.empty()) {
+        std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+        m_buffer.clear();
+      }
+    }
+
+    static const size_t BUFFER_SIZE = 4*1024*1024;
+    FILE* m_file;
+    bool m_swap;
+    std::vector<char> m_buffer;
+  };
+
+  bool write_stl(const MeshData& mesh, const std::string& filename) {
+    const uint64_t triangles = mesh.vIndices.size() / 3;
+    if(triangles > uint64_t(std::numeric_limits<uint32_t>::max())) {
+      T_ERROR("Too many triangles for STL");
+      return false;
+    }
+    BufferedFile out(filename);
+    if(!out.IsOpen()) { return false; }
+    // the header must not start with "solid", which marks ASCII STL
+    char header[80];
+    std::memset(header, ' ', sizeof(header));
+    const char desc[] = "binary STL written by uvfconvert";
+    std::memcpy(header, desc, sizeof(desc)-1);
+    out.Write(header, sizeof(header));
+    out.WriteLE(uint32_t(triangles));
+    for(uint64_t t=0; t < triangles; ++t) {
+      const FLOATVECTOR3& a = mesh.vertices[mesh.vIndices[size_t(3*t)]];
+      const FLOATVECTOR3& b = mesh.vertices[mesh.vIndices[size_t(3*t+1)]];
+      const FLOATVECTOR3& c = mesh.vertices[mesh.vIndices[size_t(3*t+2)]];
+      const FLOATVECTOR3 u = b - a, v = c - a;
+      FLOATVECTOR3 n(u.y*v.z - u.z*v.y, u.z*v.x - u.x*v.z, u.x*v.y - u.y*v.x);
+      const float len = std::sqrt(n.x*n.x + n.y*n.y + n.z*n.z);
+      if(len > 0.0f) { n = n / len; }
+      const FLOATVECTOR3* record[4] = { &n, &a, &b, &c };
+      for(size_t i=0; i < 4; ++i) {
+        out.WriteLE(record[i]->x);
+        out.WriteLE(record[i]->y);
+        out.WriteLE(record[i]->z);
+      }
+      out.WriteLE(uint16_t(0));
+    }
+    return out.Close();
+  }
+
+  bool write_ply(MeshData& mesh, const std::string& filename) {
+    if(!mesh.IsUnified()) { WeldVertices(mesh); }
+    BufferedFile out(filename);
+    if(!out.IsOpen()) { return false; }
+    // written in host byte order, which PLY can declare
+    std::ostringstream hdr;
+    hdr << "ply\nformat "
+        << (EndianConvert::IsLittleEndian() ? "binary_little_endian"
+                                            : "binary_big_endian")
+        << " 1.0\ncomment written by uvfconvert\n"
+        << "element vertex " << mesh.vertices.size() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n";
+    if(!mesh.normals.empty()) {
+      hdr << "property float nx\nproperty float ny\nproperty float nz\n";
+    }
+    if(!mesh.texcoords.empty()) {
+      hdr << "property float s\nproperty float t\n";
+    }
+    if(!mesh.colors.empty()) {
+      hdr << "property uchar red\nproperty uchar green\n"
+          << "property uchar blue\nproperty uchar alpha\n";
+    }
+    hdr << "element face " << mesh.vIndices.size() / 3 << "\n"
+        << "property list uchar uint vertex_indices\nend_header\n";
+    const std::string h = hdr.str();
+    out.Write(h.data(), h.size());
+
+    for(size_t v=0; v < mesh.vertices.size(); ++v) {
+      out.Write(&mesh.vertices[v], sizeof(FLOATVECTOR3));
+      if(!mesh.normals.empty()) {
+        out.Write(&mesh.normals[v], sizeof(FLOATVECTOR3));
+      }
+      if(!mesh.texcoords.empty()) {
+        out.Write(&mesh.texcoords[v], sizeof(FLOATVECTOR2));
+      }
+      if(!mesh.colors.empty()) {
+        const FLOATVECTOR4& c = mesh.colors[v];
+        const float rgba[4] = { c.x, c.y, c.z, c.w };
+        uint8_t bytes[4];
+        for(size_t i=0; i < 4; ++i) {
+          bytes[i] = uint8_t(std::min(1.0f, std::max(0.0f, rgba[i])) * 255.0f
+                             + 0.5f);
+        }
+        out.Write(bytes, sizeof(bytes));
+      }
+    }
+    for(size_t t=0; t+2 < mesh.vIndices.size(); t += 3) {
+      const uint8_t three = 3;
+      out.Write(&three, 1);
+      out.Write(&mesh.vIndices[t], 3*sizeof(uint32_t));
+    }
+    return out.Close();
+  }
+}
+
+bool CanWriteMesh(const std::string& filename)
+{
+  const std::string ext = SysTools::ToLowerCase(SysTools::GetExt(filename));
+  return ext == "stl" || ext == "ply";
+}
+
+bool WriteMesh(MeshData& mesh, const std::string& filename)
+{
+  const std::string ext = SysTools::ToLowerCase(SysTools::GetExt(filename));
+  const bool ok = ext == "stl" ? write_stl(mesh, filename)
+                               : write_ply(mesh, filename);
+  if(!ok) {
+    T_ERROR("Could not write '%s'", filename.c_str());
+  }
+  return ok;
+}
@@ -0,0 +1,92 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    MeshPipeline.h
+  \brief   Fast paths for converting large triangle meshes: a chunked,
+           parallel parser for ASCII OBJ and PLY, vertex welding and
+           streaming writers for binary STL and PLY.
+*/
+
+#pragma once
+
+#ifndef MESHPIPELINE_H
+#define MESHPIPELINE_H
+
+#include <memory>
+#include <string>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/Basics/Mesh.h"
+
+/// A triangle mesh with the attribute layout of tuvok::Mesh: every
+/// attribute has its own index list, which is either empty or as long as
+/// vIndices.  Unlike tuvok::Mesh it is filled in place and never copied.
+struct MeshData {
+  tuvok::VertVec vertices;
+  tuvok::NormVec normals;
+  tuvok::TexCoordVec texcoords;
+  tuvok::ColorVec colors;
+  tuvok::IndexVec vIndices;
+  tuvok::IndexVec nIndices;
+  tuvok::IndexVec tIndices;
+  tuvok::IndexVec cIndices;
+
+  /// true if all attributes use the vertex indices, i.e. they are stored
+  /// per vertex as PLY requires.
+  bool IsUnified() const;
+};
+
+/// true for the extensions ParseMesh handles (obj, ply).
+bool CanParseMesh(const std::string& filename);
+/// Reads an ASCII OBJ or PLY file in blocks; the lines of each block are
+/// parsed by all cores while the next block is read.  Returns false if the
+/// file uses anything the fast path does not handle (binary PLY, lines,
+/// points, vertex colors in OBJ, ...) or is malformed; the caller should
+/// then fall back to the Tuvok converter, which reports real errors.
+bool ParseMesh(const std::string& filename, MeshData& mesh);
+
+/// Copies a triangle mesh read by a Tuvok converter; false for line meshes.
+bool FromTuvokMesh(const tuvok::Mesh& m, MeshData& mesh);
+/// Hands the data to a tuvok::Mesh for the Tuvok writers; 'mesh' is left
+/// empty.
+std::shared_ptr<tuvok::Mesh> ToTuvokMesh(MeshData& mesh,
+                                         const std::string& desc);
+
+/// Merges corners whose attributes are bitwise identical into one vertex,
+/// using a hash table over all attributes.  Afterwards the mesh is unified.
+void WeldVertices(MeshData& mesh);
+
+/// true for the extensions WriteMesh handles (stl, ply).
+bool CanWriteMesh(const std::string& filename);
+/// Writes binary STL or binary PLY straight from the index lists through a
+/// fixed size buffer.  PLY stores attributes per vertex, so meshes which
+/// are not unified are welded first.
+bool WriteMesh(MeshData& mesh, const std::string& filename);
+
+#endif // MESHPIPELINE_H
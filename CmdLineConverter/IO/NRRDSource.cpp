@@ -0,0 +1,348 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    NRRDSource.cpp
+  \brief   Streaming source for NRRD files with raw encoding.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "NRRDSource.h"
+#include "UVFBrickSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/EndianConvert.h"
+#include "../../Tuvok/Basics/SysTools.h"
+
+namespace {
+  struct NRRDHeader {
+    NRRDHeader() : type(ExtendedOctree::CT_UINT8), components(1),
+                   aspect(1,1,1), raw(false), bigEndian(false),
+                   byteSkip(0), lineSkip(0), length(0) {}
+    UINT64VECTOR3 size;
+    ExtendedOctree::COMPONENT_TYPE type;
+    uint64_t components;
+    DOUBLEVECTOR3 aspect;
+    std::string title;
+    bool raw;            ///< "encoding: raw"
+    bool bigEndian;
+    int64_t byteSkip;    ///< -1: the data are the last bytes of the file
+    uint64_t lineSkip;
+    std::string dataFile;  ///< empty for attached data
+    uint64_t length;     ///< bytes of the header, including the empty line
+  };
+
+  std::string trim(const std::string& s) {
+    const size_t first = s.find_first_not_of(" \t\r");
+    if(first == std::string::npos) { return std::string(); }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+  }
+
+  bool nrrd_type(std::string name, ExtendedOctree::COMPONENT_TYPE& type) {
+    // the spellings the NRRD format allows for each type.
+    static const struct { const char* name; ExtendedOctree::COMPONENT_TYPE t; }
+    types[] = {
+      {"uchar", ExtendedOctree::CT_UINT8},
+      {"unsigned char", ExtendedOctree::CT_UINT8},
+      {"uint8", ExtendedOctree::CT_UINT8},
+      {"uint8_t", ExtendedOctree::CT_UINT8},
+      {"signed char", ExtendedOctree::CT_INT8},
+      {"int8", ExtendedOctree::CT_INT8},
+      {"int8_t", ExtendedOctree::CT_INT8},
+      {"ushort", ExtendedOctree::CT_UINT16},
+      {"unsigned short", ExtendedOctree::CT_UINT16},
+      {"unsigned short int", ExtendedOctree::CT_UINT16},
+      {"uint16", ExtendedOctree::CT_UINT16},
+      {"uint16_t", ExtendedOctree::CT_UINT16},
+      {"short", ExtendedOctree::CT_INT16},
+      {"short int", ExtendedOctree::CT_INT16},
+      {"signed short", ExtendedOctree::CT_INT16},
+      {"signed short int", ExtendedOctree::CT_INT16},
+      {"int16", ExtendedOctree::CT_INT16},
+      {"int16_t", ExtendedOctree::CT_INT16},
+      {"uint", ExtendedOctree::CT_UINT32},
+      {"unsigned int", ExtendedOctree::CT_UINT32},
+      {"uint32", ExtendedOctree::CT_UINT32},
+      {"uint32_t", ExtendedOctree::CT_UINT32},
+      {"int", ExtendedOctree::CT_INT32},
+      {"signed int", ExtendedOctree::CT_INT32},
+      {"int32", ExtendedOctree::CT_INT32},
+      {"int32_t", ExtendedOctree::CT_INT32},
+      {"ulonglong", ExtendedOctree::CT_UINT64},
+      {"unsigned long long", ExtendedOctree::CT_UINT64},
+      {"unsigned long long int", ExtendedOctree::CT_UINT64},
+      {"uint64", ExtendedOctree::CT_UINT64},
+      {"uint64_t", ExtendedOctree::CT_UINT64},
+      {"longlong", ExtendedOctree::CT_INT64},
+      {"long long", ExtendedOctree::CT_INT64},
+      {"long long int", ExtendedOctree::CT_INT64},
+      {"signed long long", ExtendedOctree::CT_INT64},
+      {"signed long long int", ExtendedOctree::CT_INT64},
+      {"int64", ExtendedOctree::CT_INT64},
+      {"int64_t", ExtendedOctree::CT_INT64},
+      {"float", ExtendedOctree::CT_FLOAT32},
+      {"double", ExtendedOctree::CT_FLOAT64},
+    };
+    name = SysTools::ToLowerCase(name);
+    for(size_t i=0; i < sizeof(types)/sizeof(types[0]); ++i) {
+      if(name == types[i].name) {
+        type = types[i].t;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // lengths of the vectors in a "space directions" field, "none" for the
+  // component axis.
+  std::vector<double> direction_lengths(const std::string& value) {
+    std::vector<double> lengths;
+    std::istringstream is(value);
+    std::string word;
+    while(is >> word) {
+      if(word == "none") { lengths.push_back(1.0); continue; }
+      std::string vec = word;
+      while(vec.find(')') == std::string::npos && is >> word) { vec += word; }
+      std::replace(vec.begin(), vec.end(), '(', ' ');
+      std::replace(vec.begin(), vec.end(), ')', ' ');
+      std::replace(vec.begin(), vec.end(), ',', ' ');
+      std::istringstream v(vec);
+      double sum = 0, c;
+      while(v >> c) { sum += c*c; }
+      lengths.push_back(std::sqrt(sum));
+    }
+    return lengths;
+  }
+
+  // Parses the header at the start of 'text'.  False if it is not a NRRD
+  // header this source can read, or if 'text' ends before the header does
+  // and 'complete' says there is more of the file.
+  bool parse_header(const std::string& text, bool complete, NRRDHeader& hdr)
+  {
+    if(text.compare(0, 7, "NRRD000") != 0) { return false; }
+    uint64_t dimension = 0;
+    std::vector<uint64_t> sizes;
+    std::vector<double> spacings;
+    bool hasEndian = false;
+    bool ended = false;
+    size_t pos = text.find('\n');
+    while(pos != std::string::npos && pos+1 < text.size()) {
+      const size_t begin = pos + 1;
+      pos = text.find('\n', begin);
+      if(pos == std::string::npos && !complete) { return false; }
+      const std::string line = trim(text.substr(begin, pos == std::string::npos
+                                                ? std::string::npos
+                                                : pos - begin));
+      if(line.empty()) {
+        ended = true;
+        hdr.length = pos + 1;
+        break;
+      }
+      if(line[0] == '#') { continue; }
+      const size_t colon = line.find(": ");
+      if(colon == std::string::npos) { continue; }
+      if(colon > 0 && line.find(":=") != std::string::npos &&
+         line.find(":=") < colon) {
+        continue;  // a key/value pair
+      }
+      const std::string field = SysTools::ToLowerCase(line.substr(0, colon));
+      const std::string value = trim(line.substr(colon + 2));
+      std::istringstream is(value);
+      if(field == "type") {
+        if(!nrrd_type(value, hdr.type)) { return false; }
+      } else if(field == "dimension") {
+        is >> dimension;
+      } else if(field == "sizes") {
+        uint64_t s;
+        while(is >> s) { sizes.push_back(s); }
+      } else if(field == "spacings") {
+        std::string s;
+        while(is >> s) {
+          const double d = std::atof(s.c_str());
+          spacings.push_back(d > 0 ? d : 1.0);  // nan for the component axis
+        }
+      } else if(field == "space directions") {
+        spacings = direction_lengths(value);
+      } else if(field == "encoding") {
+        hdr.raw = SysTools::ToLowerCase(value) == "raw";
+      } else if(field == "endian") {
+        hdr.bigEndian = SysTools::ToLowerCase(value) == "big";
+        hasEndian = true;
+      } else if(field == "byte skip" || field == "byteskip") {
+        is >> hdr.byteSkip;
+      } else if(field == "line skip" || field == "lineskip") {
+        is >> hdr.lineSkip;
+      } else if(field == "data file" || field == "datafile") {
+        hdr.dataFile = value;
+      } else if(field == "content") {
+        hdr.title = value;
+      }
+    }
+    // a detached header may end without an empty line.
+    if(!ended) {
+      if(!complete || hdr.dataFile.empty()) { return false; }
+      hdr.length = text.size();
+    }
+
+    if(!hdr.raw || hdr.lineSkip != 0 || hdr.byteSkip < -1) { return false; }
+    // lists of data files are not a single array.
+    if(hdr.dataFile.compare(0, 4, "LIST") == 0 ||
+       hdr.dataFile.find(' ') != std::string::npos) {
+      return false;
+    }
+    if(ComponentTypeSize(hdr.type) > 1 && !hasEndian) { return false; }
+    if(dimension != sizes.size() || dimension < 3 || dimension > 4) {
+      return false;
+    }
+    const size_t first = size_t(dimension - 3);
+    hdr.components = first ? sizes[0] : 1;
+    hdr.size = UINT64VECTOR3(sizes[first], sizes[first+1], sizes[first+2]);
+    if(hdr.size.volume() == 0 || hdr.components == 0) { return false; }
+    if(spacings.size() == sizes.size()) {
+      hdr.aspect = DOUBLEVECTOR3(spacings[first], spacings[first+1],
+                                 spacings[first+2]);
+    }
+    return true;
+  }
+
+  class NRRDSource : public VolumeSource {
+  public:
+    NRRDSource(const NRRDHeader& hdr, const std::string& file,
+               uint64_t offset) :
+      m_hdr(hdr), m_file(file), m_offset(offset) {}
+
+    virtual VolumeSourceInfo GetInfo() const {
+      VolumeSourceInfo info;
+      info.size = m_hdr.size;
+      info.type = m_hdr.type;
+      info.components = m_hdr.components;
+      info.aspect = m_hdr.aspect;
+      info.title = m_hdr.title;
+      return info;
+    }
+
+    virtual bool ReadSlab(uint64_t z0, uint64_t depth, void* out) {
+      if(!m_in.is_open()) {
+        m_in.open(m_file.c_str(), std::ios::in | std::ios::binary);
+        if(!m_in.is_open()) { return false; }
+      }
+      const uint64_t elem = ComponentTypeSize(m_hdr.type);
+      const uint64_t slice = m_hdr.size.x * m_hdr.size.y *
+                             m_hdr.components * elem;
+      m_in.seekg(std::streamoff(m_offset + z0*slice));
+      m_in.read(static_cast<char*>(out), std::streamsize(depth*slice));
+      if(uint64_t(m_in.gcount()) != depth*slice) { return false; }
+      if(elem > 1 && m_hdr.bigEndian == EndianConvert::IsLittleEndian()) {
+        char* c = static_cast<char*>(out);
+        for(uint64_t i=0; i < depth*slice; i += elem) {
+          std::reverse(c + i, c + i + elem);
+        }
+      }
+      return true;
+    }
+
+    virtual bool GetRawLayout(std::string& file, uint64_t& offset,
+                              bool& bigEndian) const {
+      file = m_file;
+      offset = m_offset;
+      bigEndian = m_hdr.bigEndian;
+      return true;
+    }
+
+  private:
+    NRRDHeader m_hdr;
+    std::string m_file;
+    uint64_t m_offset;
+    std::ifstream m_in;
+  };
+}
+
+bool NRRDSourceFactory::CanRead(const std::string& filename,
+                                const std::vector<int8_t>& bytes) const
+{
+  const std::string ext = SysTools::ToLowerCase(SysTools::GetExt(filename));
+  if(ext != "nrrd" && ext != "nhdr") { return false; }
+  // FindVolumeSource shows us 512 bytes; fewer means we have the whole file.
+  const std::string text(reinterpret_cast<const char*>(bytes.data()),
+                         bytes.size());
+  NRRDHeader hdr;
+  return parse_header(text, bytes.size() < 512, hdr);
+}
+
+VolumeSource* NRRDSourceFactory::Open(const std::string& filename) const
+{
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  if(!in.is_open()) {
+    T_ERROR("Could not open %s", filename.c_str());
+    return NULL;
+  }
+  // headers are short; this is plenty even for long comments.
+  std::string text(64*1024, '\0');
+  in.read(&text[0], std::streamsize(text.size()));
+  text.resize(size_t(in.gcount()));
+  in.close();
+
+  NRRDHeader hdr;
+  if(!parse_header(text, true, hdr)) {
+    T_ERROR("%s is not a raw encoded NRRD file", filename.c_str());
+    return NULL;
+  }
+
+  std::string file = filename;
+  uint64_t offset = hdr.length;
+  if(!hdr.dataFile.empty()) {
+    file = hdr.dataFile;
+    if(file[0] != '/' && file[0] != '\\' &&
+       file.find(':') == std::string::npos) {
+      file = SysTools::GetPath(filename) + file;
+    }
+    offset = 0;
+  }
+  const uint64_t bytes = hdr.size.volume() * hdr.components *
+                         ComponentTypeSize(hdr.type);
+  std::ifstream data(file.c_str(), std::ios::in | std::ios::binary);
+  data.seekg(0, std::ios::end);
+  const uint64_t fileSize = data ? uint64_t(data.tellg()) : 0;
+  if(hdr.byteSkip == -1) {
+    offset = fileSize >= bytes ? fileSize - bytes : 0;
+  } else {
+    offset += uint64_t(hdr.byteSkip);
+  }
+  if(fileSize < offset + bytes) {
+    T_ERROR("%s holds %llu bytes, the header of %s describes %llu",
+            file.c_str(), static_cast<unsigned long long>(fileSize),
+            filename.c_str(),
+            static_cast<unsigned long long>(offset + bytes));
+    return NULL;
+  }
+  return new NRRDSource(hdr, file, offset);
+}
@@ -0,0 +1,53 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    NRRDSource.h
+  \brief   Streaming source for NRRD files with raw encoding.
+*/
+
+#pragma once
+
+#ifndef NRRDSOURCE_H
+#define NRRDSOURCE_H
+
+#include "VolumeSource.h"
+
+/// NRRD (.nrrd with attached, .nhdr with detached data) in raw encoding.
+/// The voxels are a plain array in one file, so they are always bricked in
+/// place.  Compressed encodings, data file lists and line skips are left to
+/// Tuvok's NRRD converter.
+class NRRDSourceFactory : public VolumeSourceFactory {
+public:
+  virtual const char* GetDesc() const { return "NRRD, raw encoding"; }
+  virtual bool CanRead(const std::string& filename,
+                       const std::vector<int8_t>& bytes) const;
+  virtual VolumeSource* Open(const std::string& filename) const;
+};
+
+#endif // NRRDSOURCE_H
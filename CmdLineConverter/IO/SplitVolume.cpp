@@ -0,0 +1,229 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    SplitVolume.cpp
+  \brief   Splits a UVF into spatial parts for sort-last parallel rendering.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "SplitVolume.h"
+#include "StreamingExport.h"
+#include "UVFBrickSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/SysTools.h"
+#include "../../Tuvok/IO/IOManager.h"
+
+namespace {
+  uint64_t& at(UINT64VECTOR3& v, unsigned axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+  }
+  uint64_t at(const UINT64VECTOR3& v, unsigned axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+  }
+
+  bool bisect(const UINT64VECTOR3& lo, const UINT64VECTOR3& hi,
+              const UINT64VECTOR3& stride, uint32_t count,
+              std::vector<SplitPlane>& path, std::vector<VolumePart>& parts)
+  {
+    if(count == 1) {
+      VolumePart part;
+      part.lo = lo;
+      part.hi = hi;
+      part.path = path;
+      parts.push_back(part);
+      return true;
+    }
+    const UINT64VECTOR3 size = hi - lo;
+    const unsigned axis = (size.x >= size.y && size.x >= size.z) ? 0
+                        : (size.y >= size.z ? 1 : 2);
+    const uint64_t slice = size.volume() / at(size, axis);
+    const uint32_t lower = count / 2;
+    // both sides need at least one voxel per part.
+    const auto fits = [&](uint64_t plane) {
+      return plane > at(lo, axis) && plane < at(hi, axis) &&
+             (plane - at(lo, axis)) * slice >= lower &&
+             (at(hi, axis) - plane) * slice >= count - lower;
+    };
+
+    uint64_t plane = at(lo, axis) + at(size, axis) * lower / count;
+    // a brick boundary is only worth it if the parts stay about as large.
+    const uint64_t s = at(stride, axis);
+    const uint64_t aligned = s == 0 ? 0 : (plane + s/2) / s * s;
+    const uint64_t shift = aligned > plane ? aligned - plane : plane - aligned;
+    if(s != 0 && shift * 8 <= at(size, axis) && fits(aligned)) {
+      plane = aligned;
+    } else if(!fits(plane)) {
+      return false;
+    }
+
+    SplitPlane split;
+    split.axis = axis;
+    split.plane = plane;
+    UINT64VECTOR3 mid = hi;
+    at(mid, axis) = plane;
+    split.upper = false;
+    path.push_back(split);
+    if(!bisect(lo, mid, stride, lower, path, parts)) { return false; }
+    mid = lo;
+    at(mid, axis) = plane;
+    path.back().upper = true;
+    if(!bisect(mid, hi, stride, count - lower, path, parts)) { return false; }
+    path.pop_back();
+    return true;
+  }
+
+  std::string lua_string(const std::string& s) {
+    std::string q = "\"";
+    for(size_t i=0; i < s.size(); ++i) {
+      if(s[i] == '"' || s[i] == '\\') { q += '\\'; }
+      q += s[i];
+    }
+    return q + "\"";
+  }
+
+  template<typename T>
+  std::string lua_vector(const T& v) {
+    std::ostringstream os;
+    os.precision(17);
+    os << "{x=" << v.x << ", y=" << v.y << ", z=" << v.z << "}";
+    return os.str();
+  }
+}
+
+std::vector<VolumePart> PartitionDomain(const UINT64VECTOR3& domain,
+                                        const UINT64VECTOR3& stride,
+                                        uint32_t count)
+{
+  std::vector<VolumePart> parts;
+  std::vector<SplitPlane> path;
+  if(count == 0 ||
+     !bisect(UINT64VECTOR3(0,0,0), domain, stride, count, path, parts)) {
+    parts.clear();
+  }
+  return parts;
+}
+
+bool SplitVolume(const IOManager& iom, const std::string& input,
+                 uint32_t count, const std::string& output,
+                 const std::string& tempDir, uint64_t bricksize,
+                 uint32_t brickoverlap)
+{
+  UINT64VECTOR3 domain, stride;
+  DOUBLEVECTOR3 scale;
+  try {
+    UVFBrickSource src(input);
+    domain = src.GetDomainSize(0);
+    stride = src.GetMaxBrickSize() - 2*uint64_t(src.GetOverlap());
+    scale = src.GetScale();
+  } catch(const std::exception& e) {
+    T_ERROR("%s", e.what());
+    return false;
+  }
+
+  const std::vector<VolumePart> parts = PartitionDomain(domain, stride,
+                                                        count);
+  if(parts.empty()) {
+    T_ERROR("Cannot split %llux%llux%llu voxels into %u parts",
+            static_cast<unsigned long long>(domain.x),
+            static_cast<unsigned long long>(domain.y),
+            static_cast<unsigned long long>(domain.z), count);
+    return false;
+  }
+
+  const std::string base = SysTools::RemoveExt(output);
+  std::ostringstream manifest;
+  manifest << "-- Parts of " << SysTools::GetFilename(input)
+           << ", written by uvfconvert --split.\n"
+           << "return {\n"
+           << "  domain = " << lua_vector(domain) << ",\n"
+           << "  scale = " << lua_vector(scale) << ",\n"
+           << "  parts = {\n";
+  for(size_t k=0; k < parts.size(); ++k) {
+    const VolumePart& p = parts[k];
+    // the voxels of the next part on the upper side of every split: the
+    // renderer spans a data set between its outermost voxel centers, so
+    // with them the part reaches the first voxel of its neighbours and
+    // interpolates across the split like the whole volume does.
+    const UINT64VECTOR3 hi(std::min(p.hi.x + 1, domain.x),
+                           std::min(p.hi.y + 1, domain.y),
+                           std::min(p.hi.z + 1, domain.z));
+    std::ostringstream file;
+    file << base << "-" << k << ".uvf";
+    MESSAGE("Writing part %u of %u: [%llu,%llu) x [%llu,%llu) x [%llu,%llu)",
+            static_cast<unsigned>(k+1), count,
+            static_cast<unsigned long long>(p.lo.x),
+            static_cast<unsigned long long>(p.hi.x),
+            static_cast<unsigned long long>(p.lo.y),
+            static_cast<unsigned long long>(p.hi.y),
+            static_cast<unsigned long long>(p.lo.z),
+            static_cast<unsigned long long>(p.hi.z));
+
+    // like an --roi export: the box is streamed to an NRRD, which is then
+    // bricked as usual.
+    const std::string nhdrFile = tempDir +
+      SysTools::ChangeExt(SysTools::GetFilename(file.str()), "nhdr");
+    std::unique_ptr<SlabSink> sink = CreateSlabSink(nhdrFile);
+    const bool ok = StreamExport(input, 0, p.lo, hi, *sink) &&
+                    iom.ConvertDataset(nhdrFile, file.str(), tempDir, true,
+                                       bricksize, brickoverlap);
+    std::remove(nhdrFile.c_str());
+    std::remove(SysTools::ChangeExt(nhdrFile, "raw").c_str());
+    if(!ok) { return false; }
+
+    static const char* axes[] = { "x", "y", "z" };
+    manifest << "    {file=" << lua_string(SysTools::GetFilename(file.str()))
+             << ", lo=" << lua_vector(p.lo) << ", hi=" << lua_vector(p.hi)
+             << ",\n     dataHi=" << lua_vector(hi) << ", path={";
+    for(size_t i=0; i < p.path.size(); ++i) {
+      manifest << (i ? ", " : "") << "{axis='" << axes[p.path[i].axis]
+               << "', plane=" << p.path[i].plane << ", upper="
+               << (p.path[i].upper ? "true" : "false") << "}";
+    }
+    manifest << "}},\n";
+  }
+  manifest << "  }\n}\n";
+
+  const std::string manifestFile = SysTools::ChangeExt(output, "lua");
+  std::ofstream out(manifestFile.c_str());
+  out << manifest.str();
+  out.close();
+  if(out.fail()) {
+    T_ERROR("Could not write '%s'", manifestFile.c_str());
+    return false;
+  }
+  MESSAGE("Wrote %u parts; the manifest is '%s'", count,
+          manifestFile.c_str());
+  return true;
+}
@@ -0,0 +1,84 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    SplitVolume.h
+  \brief   Splits a UVF into spatial parts for sort-last parallel rendering.
+*/
+
+#pragma once
+
+#ifndef SPLITVOLUME_H
+#define SPLITVOLUME_H
+
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/Basics/Vectors.h"
+
+class IOManager;
+
+/// One of the planes which separate the parts.
+struct SplitPlane {
+  unsigned axis;    ///< 0, 1 or 2 for x, y or z
+  uint64_t plane;   ///< voxel index where the upper side begins
+  bool upper;       ///< the part is on the upper side
+};
+
+/// A box of the finest level, [lo, hi) in voxels.  'path' lists the planes
+/// from the first split down to the part: visiting the side of each plane
+/// that holds the eye first gives the parts in front-to-back order.
+struct VolumePart {
+  UINT64VECTOR3 lo;
+  UINT64VECTOR3 hi;
+  std::vector<SplitPlane> path;
+};
+
+/// Cuts 'domain' into 'count' boxes by recursive bisection of the longest
+/// side, in proportion to the number of parts on either side, so the boxes
+/// have about the same number of voxels.  Planes are moved to the nearest
+/// multiple of 'stride' if that is within an eighth of the side, so parts
+/// mostly read whole bricks of the source.  Empty if the domain has fewer voxels than parts.
+std::vector<VolumePart> PartitionDomain(const UINT64VECTOR3& domain,
+                                        const UINT64VECTOR3& stride,
+                                        uint32_t count);
+
+/// Writes every part of the finest level of 'input' to its own UVF,
+/// '<output>-<k>.uvf' for an output of '<output>.uvf', reading only the
+/// bricks which intersect it.  Parts get one more layer of voxels on the
+/// upper side of each split ('dataHi' in the manifest), the first layer of
+/// the next part, so the two meet without a gap.  A Lua manifest ('<output>.lua') lists the
+/// parts with their boxes and split planes, together with the domain and
+/// aspect ratio of the whole volume; see LuaScripts/RenderParts.lua.
+bool SplitVolume(const IOManager& iom, const std::string& input,
+                 uint32_t count, const std::string& output,
+                 const std::string& tempDir, uint64_t bricksize,
+                 uint32_t brickoverlap);
+
+#endif // SPLITVOLUME_H
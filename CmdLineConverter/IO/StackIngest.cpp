@@ -0,0 +1,236 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    StackIngest.cpp
+  \brief   Pipelined reading of image and DICOM stacks into a flat raw file.
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../Common/JPEGSliceDecoder.h"
+#include "MemoryAccountant.h"
+#include "StackIngest.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/EndianConvert.h"
+#include "../../Tuvok/Basics/LargeRAWFile.h"
+#include "../../Tuvok/Basics/SysTools.h"
+#include "../../Tuvok/IO/DirectoryParser.h"
+#include "../../Tuvok/IO/DICOM/DICOMParser.h"
+#include "../../Tuvok/IO/3rdParty/jpeglib/jconfig.h"
+
+using tuvok::FileStackInfo;
+
+namespace {
+  // the JPEG library decodes to its own sample size.
+  uint32_t bits_per_component(const FileStackInfo& stack) {
+    return stack.m_bIsJPEGEncoded ? uint32_t(BITS_IN_JSAMPLE)
+                                  : stack.m_iAllocated;
+  }
+
+  uint64_t element_bytes(const FileStackInfo& stack) {
+    return uint64_t(stack.m_ivSize.x) * stack.m_ivSize.y * stack.m_ivSize.z *
+           stack.m_iComponentCount * (bits_per_component(stack) / 8);
+  }
+
+  void swap16(std::vector<char>& data) {
+    for(size_t i=0; i+1 < data.size(); i += 2) {
+      std::swap(data[i], data[i+1]);
+    }
+  }
+
+  // reads, decodes and byte-swaps element 'i' of the stack into 'data'.
+  bool read_element(const FileStackInfo& stack, size_t i, size_t bytes,
+                    JPEGSliceDecoder& decoder, std::vector<char>& data)
+  {
+    SimpleFileInfo* element = stack.m_Elements[i];
+    if(stack.m_bIsJPEGEncoded) {
+      const SimpleDICOMFileInfo* dicom =
+        dynamic_cast<const SimpleDICOMFileInfo*>(element);
+      if(!dicom) { return false; }
+      // decoded straight into the ring slot.
+      data.resize(bytes);
+      return decoder.Decode(element->m_strFileName, dicom->GetOffsetToData(),
+                            data.data(), bytes);
+    }
+    element->GetData(data);
+    if(data.size() < bytes) { return false; }
+    data.resize(bytes);
+    if(bits_per_component(stack) == 16 &&
+       stack.m_bIsBigEndian == EndianConvert::IsLittleEndian()) {
+      swap16(data);
+    }
+    return true;
+  }
+
+  // One decoded element per slot.  Element i goes to slot i % slots.size()
+  // once element i - slots.size() has been written.
+  struct Ring {
+    struct Slot {
+      std::vector<char> data;
+      bool ready;
+      bool failed;
+    };
+    std::vector<Slot> slots;
+    std::mutex lock;
+    std::condition_variable changed;
+    uint64_t next;     ///< next element a reader picks up
+    uint64_t written;  ///< elements the writer is done with
+    bool abort;
+  };
+}
+
+bool CanIngestStack(const FileStackInfo& stack)
+{
+  if(stack.m_Elements.empty() || stack.m_iComponentCount != 1) {
+    return false;
+  }
+  const uint32_t bits = bits_per_component(stack);
+  return bits == 8 || bits == 16;
+}
+
+uint64_t StackRawSize(const FileStackInfo& stack)
+{
+  return element_bytes(stack) * stack.m_Elements.size();
+}
+
+bool IngestStack(const FileStackInfo& stack, const std::string& nhdrFile,
+                 size_t readers)
+{
+  if(!CanIngestStack(stack)) {
+    T_ERROR("Stack '%s' has a data layout which cannot be read directly",
+            stack.m_strDesc.c_str());
+    return false;
+  }
+  const std::string rawFile = SysTools::ChangeExt(nhdrFile, "raw");
+  const uint64_t bytes = element_bytes(stack);
+  const uint64_t n = stack.m_Elements.size();
+
+  LargeRAWFile raw(rawFile);
+  if(!raw.Create(bytes * n)) {
+    T_ERROR("Could not create temporary file %s", rawFile.c_str());
+    return false;
+  }
+
+  // reads mostly wait for the file system, so there are more readers than
+  // cores; the ring holds two slices per reader if memory permits.
+  if(readers == 0) {
+    readers = std::max<size_t>(4, std::thread::hardware_concurrency());
+  }
+  readers = size_t(std::min<uint64_t>(readers, n));
+  Ring ring;
+  ring.slots.resize(MemoryAccountant::Instance().Fit(bytes, 2*readers));
+  const MemoryAccountant::Reservation held(ring.slots.size() * bytes);
+  for(size_t s=0; s < ring.slots.size(); ++s) {
+    ring.slots[s].ready = ring.slots[s].failed = false;
+  }
+  ring.next = ring.written = 0;
+  ring.abort = false;
+
+  std::vector<std::thread> pool;
+  for(size_t r=0; r < readers; ++r) {
+    pool.push_back(std::thread([&stack, &ring, bytes, n]() {
+      JPEGDecoderPool::Lease decoder;
+      for(;;) {
+        uint64_t i;
+        {
+          std::unique_lock<std::mutex> lock(ring.lock);
+          ring.changed.wait(lock, [&ring, n]() {
+            return ring.abort || ring.next >= n ||
+                   ring.next < ring.written + ring.slots.size();
+          });
+          if(ring.abort || ring.next >= n) { return; }
+          i = ring.next++;
+        }
+        Ring::Slot& slot = ring.slots[size_t(i % ring.slots.size())];
+        const bool ok = read_element(stack, size_t(i), size_t(bytes),
+                                     *decoder, slot.data);
+        {
+          std::lock_guard<std::mutex> lock(ring.lock);
+          slot.ready = true;
+          slot.failed = !ok;
+        }
+        ring.changed.notify_all();
+      }
+    }));
+  }
+
+  bool ok = true;
+  for(uint64_t i=0; i < n && ok; ++i) {
+    Ring::Slot& slot = ring.slots[size_t(i % ring.slots.size())];
+    {
+      std::unique_lock<std::mutex> lock(ring.lock);
+      ring.changed.wait(lock, [&slot]() { return slot.ready; });
+    }
+    if(slot.failed) {
+      T_ERROR("Could not read '%s'",
+              stack.m_Elements[size_t(i)]->m_strFileName.c_str());
+      ok = false;
+    } else if(raw.WriteRAW(reinterpret_cast<const unsigned char*>(
+                             slot.data.data()), bytes) != bytes) {
+      T_ERROR("Could not write %s", rawFile.c_str());
+      ok = false;
+    }
+    MESSAGE("Read slice %llu of %llu of stack '%s'",
+            static_cast<unsigned long long>(i+1),
+            static_cast<unsigned long long>(n), stack.m_strDesc.c_str());
+    {
+      std::lock_guard<std::mutex> lock(ring.lock);
+      slot.ready = false;
+      ++ring.written;
+      ring.abort = !ok;
+    }
+    ring.changed.notify_all();
+  }
+  for(size_t r=0; r < pool.size(); ++r) { pool[r].join(); }
+  raw.Close();
+  if(!ok) {
+    raw.Delete();
+    return false;
+  }
+
+  std::ofstream nhdr(nhdrFile.c_str());
+  nhdr << "NRRD0004\n"
+       << "type: " << (bits_per_component(stack) == 8 ? "uint8" : "uint16")
+       << "\n"
+       << "dimension: 3\n"
+       << "sizes: " << stack.m_ivSize.x << " " << stack.m_ivSize.y << " "
+       << uint64_t(stack.m_ivSize.z) * n << "\n"
+       << "spacings: " << stack.m_fvfAspect.x << " " << stack.m_fvfAspect.y
+       << " " << stack.m_fvfAspect.z << "\n"
+       << "encoding: raw\n"
+       << "endian: " << (EndianConvert::IsLittleEndian() ? "little" : "big")
+       << "\n"
+       << "data file: " << SysTools::GetFilename(rawFile) << "\n";
+  return nhdr.good();
+}
@@ -0,0 +1,62 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    StackIngest.h
+  \brief   Pipelined reading of image and DICOM stacks into a flat raw file.
+*/
+
+#pragma once
+
+#ifndef STACKINGEST_H
+#define STACKINGEST_H
+
+#include <string>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+
+namespace tuvok { class FileStackInfo; }
+
+/// true if IngestStack can read 'stack': scalar 8 or 16 bit data, raw or
+/// JPEG-encoded.  Other stacks go through IOManager's own stack converter.
+bool CanIngestStack(const tuvok::FileStackInfo& stack);
+/// bytes of the flat raw file IngestStack writes for 'stack'.
+uint64_t StackRawSize(const tuvok::FileStackInfo& stack);
+
+/// Writes the slices of 'stack' to a raw file next to 'nhdrFile' and
+/// describes it in 'nhdrFile', ready for IOManager::ConvertDataset.  A pool
+/// of 'readers' threads (0: a default suited to network storage) reads,
+/// decodes and byte-swaps the slices ahead of the writer into a bounded
+/// ring of slice buffers; the ring is sized to the MemoryAccountant budget.
+/// The whole stack is flattened before it can be bricked, so a directory
+/// with a single stack gains only the parallel reads; reading overlaps with
+/// bricking only from the second stack of a directory on.
+bool IngestStack(const tuvok::FileStackInfo& stack,
+                 const std::string& nhdrFile, size_t readers=0);
+
+#endif // STACKINGEST_H
@@ -0,0 +1,766 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    StencilExpression.cpp
+  \brief   Expression language with neighborhood (stencil) operators,
+           evaluated brick by brick using the brick overlap as a halo.
+*/
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "ConversionJournal.h"
+#include "MemoryAccountant.h"
+#include "StencilExpression.h"
+#include "UVFBrickSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/EndianConvert.h"
+#include "../../Tuvok/Basics/LargeRAWFile.h"
+#include "../../Tuvok/Basics/SysTools.h"
+#include "../../Tuvok/IO/IOManager.h"
+
+namespace stencil {
+
+// the median needs all neighborhood values at once; this bounds the size of
+// that neighborhood.  Halos are only a few voxels wide anyway.
+static const uint32_t MAX_RADIUS = 4;
+
+/// A box of brick-local voxel coordinates, 'hi' exclusive.
+struct Box {
+  INT64VECTOR3 lo, hi;
+
+  Box Grow(int64_t r) const {
+    Box b;
+    b.lo = INT64VECTOR3(lo.x-r, lo.y-r, lo.z-r);
+    b.hi = INT64VECTOR3(hi.x+r, hi.y+r, hi.z+r);
+    return b;
+  }
+  int64_t Size(int axis) const {
+    return axis == 0 ? hi.x-lo.x : axis == 1 ? hi.y-lo.y : hi.z-lo.z;
+  }
+  size_t Volume() const { return size_t(Size(0) * Size(1) * Size(2)); }
+  size_t Index(int64_t x, int64_t y, int64_t z) const {
+    return size_t((x-lo.x) + Size(0)*((y-lo.y) + Size(1)*(z-lo.z)));
+  }
+};
+
+class Node {
+public:
+  virtual ~Node() {}
+  /// Called once per brick before any Eval; Eval is then only asked for
+  /// voxels inside 'box'.  Neighborhood operators compute all their values
+  /// here, so that each is evaluated once per voxel and not once for every
+  /// neighbor which needs it.
+  virtual void Prepare(const BrickData& b, const Box& box) = 0;
+  virtual double Eval(const BrickData& b, int64_t x, int64_t y,
+                      int64_t z) const = 0;
+  virtual uint32_t Radius() const = 0;
+  virtual size_t Volumes() const = 0;
+  /// number of neighborhood operators, each of which holds brick buffers.
+  virtual size_t Stencils() const = 0;
+};
+
+namespace {
+
+class Constant : public Node {
+public:
+  explicit Constant(double v) : m_value(v) {}
+  void Prepare(const BrickData&, const Box&) {}
+  double Eval(const BrickData&, int64_t, int64_t, int64_t) const {
+    return m_value;
+  }
+  uint32_t Radius() const { return 0; }
+  size_t Volumes() const { return 0; }
+  size_t Stencils() const { return 0; }
+private:
+  double m_value;
+};
+
+class Volume : public Node {
+public:
+  explicit Volume(size_t index) : m_index(index) {}
+  void Prepare(const BrickData&, const Box&) {}
+  double Eval(const BrickData& b, int64_t x, int64_t y, int64_t z) const {
+    x = std::min(b.validMax.x, std::max(b.validMin.x, x));
+    y = std::min(b.validMax.y, std::max(b.validMin.y, y));
+    z = std::min(b.validMax.z, std::max(b.validMin.z, z));
+    return b.volumes[m_index][size_t(x + b.size.x*(y + b.size.y*z))];
+  }
+  uint32_t Radius() const { return 0; }
+  size_t Volumes() const { return m_index+1; }
+  size_t Stencils() const { return 0; }
+private:
+  size_t m_index;
+};
+
+class Negate : public Node {
+public:
+  explicit Negate(Node* n) : m_child(n) {}
+  void Prepare(const BrickData& b, const Box& box) {
+    m_child->Prepare(b, box);
+  }
+  double Eval(const BrickData& b, int64_t x, int64_t y, int64_t z) const {
+    return -m_child->Eval(b, x,y,z);
+  }
+  uint32_t Radius() const { return m_child->Radius(); }
+  size_t Volumes() const { return m_child->Volumes(); }
+  size_t Stencils() const { return m_child->Stencils(); }
+private:
+  std::unique_ptr<Node> m_child;
+};
+
+enum BinaryOp { OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_LT, OP_GT, OP_AND, OP_OR };
+
+class Binary : public Node {
+public:
+  Binary(BinaryOp op, Node* a, Node* b) : m_op(op), m_a(a), m_b(b) {}
+  void Prepare(const BrickData& b, const Box& box) {
+    m_a->Prepare(b, box);
+    m_b->Prepare(b, box);
+  }
+  double Eval(const BrickData& b, int64_t x, int64_t y, int64_t z) const {
+    const double l = m_a->Eval(b, x,y,z);
+    // short-circuit like the per-voxel evaluator does.
+    if(m_op == OP_AND && l == 0.0) { return 0.0; }
+    if(m_op == OP_OR && l != 0.0) { return 1.0; }
+    const double r = m_b->Eval(b, x,y,z);
+    switch(m_op) {
+      case OP_ADD: return l + r;
+      case OP_SUB: return l - r;
+      case OP_MUL: return l * r;
+      case OP_DIV: return l / r;
+      case OP_LT: return l < r ? 1.0 : 0.0;
+      case OP_GT: return l > r ? 1.0 : 0.0;
+      case OP_AND:
+      case OP_OR: return r != 0.0 ? 1.0 : 0.0;
+    }
+    return 0.0;
+  }
+  uint32_t Radius() const { return std::max(m_a->Radius(), m_b->Radius()); }
+  size_t Volumes() const { return std::max(m_a->Volumes(), m_b->Volumes()); }
+  size_t Stencils() const { return m_a->Stencils() + m_b->Stencils(); }
+private:
+  BinaryOp m_op;
+  std::unique_ptr<Node> m_a, m_b;
+};
+
+class Conditional : public Node {
+public:
+  Conditional(Node* c, Node* t, Node* f) : m_cond(c), m_true(t), m_false(f) {}
+  void Prepare(const BrickData& b, const Box& box) {
+    m_cond->Prepare(b, box);
+    m_true->Prepare(b, box);
+    m_false->Prepare(b, box);
+  }
+  double Eval(const BrickData& b, int64_t x, int64_t y, int64_t z) const {
+    return m_cond->Eval(b, x,y,z) != 0.0 ? m_true->Eval(b, x,y,z)
+                                         : m_false->Eval(b, x,y,z);
+  }
+  uint32_t Radius() const {
+    return std::max(m_cond->Radius(),
+                    std::max(m_true->Radius(), m_false->Radius()));
+  }
+  size_t Volumes() const {
+    return std::max(m_cond->Volumes(),
+                    std::max(m_true->Volumes(), m_false->Volumes()));
+  }
+  size_t Stencils() const {
+    return m_cond->Stencils() + m_true->Stencils() + m_false->Stencils();
+  }
+private:
+  std::unique_ptr<Node> m_cond, m_true, m_false;
+};
+
+enum StencilOp { ST_BLUR, ST_GAUSS, ST_GRADMAG, ST_MIN, ST_MAX, ST_MEDIAN };
+
+class Stencil : public Node {
+public:
+  Stencil(StencilOp op, Node* child, uint32_t radius, double sigma) :
+    m_op(op), m_child(child), m_radius(radius)
+  {
+    // the box operators and the Gaussian are products of one 1D kernel per
+    // axis and are applied as three 1D passes.
+    const int r = int(radius);
+    if(op == ST_GAUSS) {
+      double sum = 0.0;
+      for(int i=-r; i <= r; ++i) {
+        m_weights.push_back(std::exp(-(i*i) / (2.0*sigma*sigma)));
+        sum += m_weights.back();
+      }
+      for(size_t i=0; i < m_weights.size(); ++i) { m_weights[i] /= sum; }
+    } else if(op == ST_BLUR) {
+      m_weights.assign(size_t(2*r+1), 1.0 / double(2*r+1));
+    }
+  }
+
+  void Prepare(const BrickData& b, const Box& box) {
+    const int64_t r = int64_t(m_radius);
+    const Box in = box.Grow(r);
+    m_child->Prepare(b, in);
+    m_input.resize(in.Volume());
+    #pragma omp parallel for
+    for(int64_t z=in.lo.z; z < in.hi.z; ++z) {
+      for(int64_t y=in.lo.y; y < in.hi.y; ++y) {
+        double* row = &m_input[in.Index(in.lo.x, y, z)];
+        for(int64_t x=in.lo.x; x < in.hi.x; ++x) {
+          row[x - in.lo.x] = m_child->Eval(b, x,y,z);
+        }
+      }
+    }
+
+    m_box = box;
+    m_values.resize(box.Volume());
+    if(m_op == ST_GRADMAG || m_op == ST_MEDIAN) {
+      Gather(in);
+      return;
+    }
+    // x, then y, then z; every pass shrinks one axis to the result's.
+    Box x = in;
+    x.lo.x = box.lo.x; x.hi.x = box.hi.x;
+    Box xy = x;
+    xy.lo.y = box.lo.y; xy.hi.y = box.hi.y;
+    Pass(m_input, in, m_scratch, x, 0);
+    Pass(m_scratch, x, m_input, xy, 1);
+    Pass(m_input, xy, m_values, box, 2);
+  }
+
+  double Eval(const BrickData&, int64_t x, int64_t y, int64_t z) const {
+    return m_values[m_box.Index(x,y,z)];
+  }
+  uint32_t Radius() const { return m_child->Radius() + m_radius; }
+  size_t Volumes() const { return m_child->Volumes(); }
+  size_t Stencils() const { return m_child->Stencils() + 1; }
+
+private:
+  // applies the 1D kernel along 'axis' to 'src', which covers 'from', for
+  // every voxel of 'to'.
+  void Pass(const std::vector<double>& src, const Box& from,
+            std::vector<double>& dst, const Box& to, int axis) const {
+    const int64_t r = int64_t(m_radius);
+    const int64_t stride = axis == 0 ? 1 : axis == 1 ? from.Size(0)
+                                         : from.Size(0)*from.Size(1);
+    dst.resize(to.Volume());
+    #pragma omp parallel for
+    for(int64_t z=to.lo.z; z < to.hi.z; ++z) {
+      for(int64_t y=to.lo.y; y < to.hi.y; ++y) {
+        double* row = &dst[to.Index(to.lo.x, y, z)];
+        for(int64_t x=to.lo.x; x < to.hi.x; ++x) {
+          const double* v = &src[from.Index(x,y,z)];
+          double acc;
+          switch(m_op) {
+            case ST_MIN:
+              acc = v[-r*stride];
+              for(int64_t i=1-r; i <= r; ++i) {
+                acc = std::min(acc, v[i*stride]);
+              }
+              break;
+            case ST_MAX:
+              acc = v[-r*stride];
+              for(int64_t i=1-r; i <= r; ++i) {
+                acc = std::max(acc, v[i*stride]);
+              }
+              break;
+            default:
+              acc = 0.0;
+              for(int64_t i=-r; i <= r; ++i) {
+                acc += m_weights[size_t(i+r)] * v[i*stride];
+              }
+              break;
+          }
+          row[x - to.lo.x] = acc;
+        }
+      }
+    }
+  }
+
+  // the operators which need the whole neighborhood at once.
+  void Gather(const Box& in) {
+    const int64_t r = int64_t(m_radius);
+    const int64_t sy = in.Size(0), sz = in.Size(0)*in.Size(1);
+    #pragma omp parallel for
+    for(int64_t z=m_box.lo.z; z < m_box.hi.z; ++z) {
+      std::array<double, (2*MAX_RADIUS+1)*(2*MAX_RADIUS+1)*(2*MAX_RADIUS+1)> n;
+      for(int64_t y=m_box.lo.y; y < m_box.hi.y; ++y) {
+        double* row = &m_values[m_box.Index(m_box.lo.x, y, z)];
+        for(int64_t x=m_box.lo.x; x < m_box.hi.x; ++x) {
+          const double* v = &m_input[in.Index(x,y,z)];
+          if(m_op == ST_GRADMAG) {
+            const double dx = v[1] - v[-1];
+            const double dy = v[sy] - v[-sy];
+            const double dz = v[sz] - v[-sz];
+            row[x - m_box.lo.x] = 0.5 * std::sqrt(dx*dx + dy*dy + dz*dz);
+            continue;
+          }
+          size_t c = 0;
+          for(int64_t k=-r; k <= r; ++k) {
+            for(int64_t j=-r; j <= r; ++j) {
+              for(int64_t i=-r; i <= r; ++i) { n[c++] = v[i + j*sy + k*sz]; }
+            }
+          }
+          std::nth_element(n.begin(), n.begin()+c/2, n.begin()+c);
+          row[x - m_box.lo.x] = n[c/2];
+        }
+      }
+    }
+  }
+
+  StencilOp m_op;
+  std::unique_ptr<Node> m_child;
+  uint32_t m_radius;
+  std::vector<double> m_weights;
+  // the child over the box grown by the radius, scratch space for the
+  // passes, and this operator's result over 'm_box'.
+  std::vector<double> m_input, m_scratch, m_values;
+  Box m_box;
+};
+
+/// Recursive descent parser.  Precedence, lowest first:
+///   ?:   ||   &&   < >   + -   * /   unary -   primary
+class Parser {
+public:
+  explicit Parser(const std::string& s) : m_str(s), m_pos(0) {}
+
+  Node* Parse() {
+    std::unique_ptr<Node> n(ParseConditional());
+    SkipWhitespace();
+    if(m_pos != m_str.size()) { Fail("unexpected trailing input"); }
+    return n.release();
+  }
+
+private:
+  void SkipWhitespace() {
+    while(m_pos < m_str.size() && std::isspace(m_str[m_pos])) { ++m_pos; }
+  }
+  bool Accept(const char* tok) {
+    SkipWhitespace();
+    const size_t len = std::string(tok).size();
+    if(m_str.compare(m_pos, len, tok) == 0) {
+      m_pos += len;
+      return true;
+    }
+    return false;
+  }
+  void Expect(const char* tok) {
+    if(!Accept(tok)) { Fail(std::string("expected '") + tok + "'"); }
+  }
+  void Fail(const std::string& msg) const {
+    std::ostringstream err;
+    err << "expression error at position " << m_pos << ": " << msg;
+    throw std::runtime_error(err.str());
+  }
+
+  // Operands are parsed into their own unique_ptr before 'l' gives up
+  // ownership, so a syntax error in the right operand cannot leak the left.
+  static void Join(BinaryOp op, std::unique_ptr<Node>& l,
+                   std::unique_ptr<Node> r) {
+    Node* n = new Binary(op, l.get(), r.get());
+    l.release();
+    r.release();
+    l.reset(n);
+  }
+
+  Node* ParseConditional() {
+    std::unique_ptr<Node> c(ParseOr());
+    if(!Accept("?")) { return c.release(); }
+    std::unique_ptr<Node> t(ParseConditional());
+    Expect(":");
+    std::unique_ptr<Node> f(ParseConditional());
+    Node* n = new Conditional(c.get(), t.get(), f.get());
+    c.release(); t.release(); f.release();
+    return n;
+  }
+  Node* ParseOr() {
+    std::unique_ptr<Node> l(ParseAnd());
+    while(Accept("||")) {
+      std::unique_ptr<Node> r(ParseAnd());
+      Join(OP_OR, l, std::move(r));
+    }
+    return l.release();
+  }
+  Node* ParseAnd() {
+    std::unique_ptr<Node> l(ParseCompare());
+    while(Accept("&&")) {
+      std::unique_ptr<Node> r(ParseCompare());
+      Join(OP_AND, l, std::move(r));
+    }
+    return l.release();
+  }
+  Node* ParseCompare() {
+    std::unique_ptr<Node> l(ParseSum());
+    for(;;) {
+      BinaryOp op;
+      if(Accept("<")) { op = OP_LT; }
+      else if(Accept(">")) { op = OP_GT; }
+      else { return l.release(); }
+      std::unique_ptr<Node> r(ParseSum());
+      Join(op, l, std::move(r));
+    }
+  }
+  Node* ParseSum() {
+    std::unique_ptr<Node> l(ParseProduct());
+    for(;;) {
+      BinaryOp op;
+      if(Accept("+")) { op = OP_ADD; }
+      else if(Accept("-")) { op = OP_SUB; }
+      else { return l.release(); }
+      std::unique_ptr<Node> r(ParseProduct());
+      Join(op, l, std::move(r));
+    }
+  }
+  Node* ParseProduct() {
+    std::unique_ptr<Node> l(ParseUnary());
+    for(;;) {
+      BinaryOp op;
+      if(Accept("*")) { op = OP_MUL; }
+      else if(Accept("/")) { op = OP_DIV; }
+      else { return l.release(); }
+      std::unique_ptr<Node> r(ParseUnary());
+      Join(op, l, std::move(r));
+    }
+  }
+  Node* ParseUnary() {
+    if(Accept("-")) { return new Negate(ParseUnary()); }
+    return ParsePrimary();
+  }
+
+  double ParseNumber() {
+    SkipWhitespace();
+    const char* begin = m_str.c_str() + m_pos;
+    char* end = NULL;
+    const double v = std::strtod(begin, &end);
+    if(end == begin) { Fail("expected a number"); }
+    m_pos += size_t(end - begin);
+    return v;
+  }
+
+  std::string ParseIdentifier() {
+    SkipWhitespace();
+    const size_t begin = m_pos;
+    while(m_pos < m_str.size() &&
+          (std::isalnum(m_str[m_pos]) || m_str[m_pos] == '_')) {
+      ++m_pos;
+    }
+    return m_str.substr(begin, m_pos - begin);
+  }
+
+  Node* ParsePrimary() {
+    if(Accept("(")) {
+      std::unique_ptr<Node> n(ParseConditional());
+      Expect(")");
+      return n.release();
+    }
+    SkipWhitespace();
+    if(m_pos < m_str.size() && std::isalpha(m_str[m_pos])) {
+      const std::string id = ParseIdentifier();
+      if(id == "v") {
+        Expect("[");
+        const double idx = ParseNumber();
+        Expect("]");
+        if(idx < 0 || idx != std::floor(idx)) { Fail("invalid volume index"); }
+        return new Volume(size_t(idx));
+      }
+      return ParseStencil(id);
+    }
+    return new Constant(ParseNumber());
+  }
+
+  Node* ParseStencil(const std::string& id) {
+    StencilOp op;
+    if(id == "blur") { op = ST_BLUR; }
+    else if(id == "gauss") { op = ST_GAUSS; }
+    else if(id == "gradmag") { op = ST_GRADMAG; }
+    else if(id == "min") { op = ST_MIN; }
+    else if(id == "max") { op = ST_MAX; }
+    else if(id == "median") { op = ST_MEDIAN; }
+    else { Fail("unknown function '" + id + "'"); return NULL; }
+
+    Expect("(");
+    std::unique_ptr<Node> child(ParseConditional());
+    uint32_t radius = 1;
+    double sigma = 0.0;
+    if(op != ST_GRADMAG) {
+      Expect(",");
+      const double param = ParseNumber();
+      if(op == ST_GAUSS) {
+        if(param <= 0.0) { Fail("gauss needs a positive standard deviation"); }
+        sigma = param;
+        radius = uint32_t(std::ceil(2.0*sigma));
+      } else {
+        if(param < 1 || param != std::floor(param)) {
+          Fail(id + " needs a positive integer radius");
+        }
+        radius = uint32_t(param);
+      }
+    }
+    Expect(")");
+    if(radius > MAX_RADIUS) {
+      std::ostringstream err;
+      err << id << ": neighborhood radius " << radius << " exceeds the "
+          << "maximum of " << MAX_RADIUS;
+      Fail(err.str());
+    }
+    return new Stencil(op, child.release(), radius, sigma);
+  }
+
+  const std::string& m_str;
+  size_t m_pos;
+};
+
+} // anonymous namespace
+} // namespace stencil
+
+using namespace stencil;
+
+StencilExpression::StencilExpression(const std::string& expr) :
+  m_root(Parser(expr).Parse())
+{
+}
+
+StencilExpression::~StencilExpression() {}
+
+bool StencilExpression::UsesStencils(const std::string& expr)
+{
+  static const char* funcs[] = {
+    "blur", "gauss", "gradmag", "min", "max", "median"
+  };
+  for(size_t i=0; i < sizeof(funcs)/sizeof(funcs[0]); ++i) {
+    if(expr.find(funcs[i]) != std::string::npos) { return true; }
+  }
+  return false;
+}
+
+uint32_t StencilExpression::GetRadius() const { return m_root->Radius(); }
+size_t StencilExpression::GetVolumeCount() const { return m_root->Volumes(); }
+size_t StencilExpression::GetStencilCount() const {
+  return m_root->Stencils();
+}
+
+void StencilExpression::Evaluate(const BrickData& brick, uint32_t overlap,
+                                 double* out)
+{
+  const int64_t o = int64_t(overlap);
+  const int64_t sx = int64_t(brick.size.x) - 2*o;
+  const int64_t sy = int64_t(brick.size.y) - 2*o;
+  const int64_t sz = int64_t(brick.size.z) - 2*o;
+
+  Box inner;
+  inner.lo = INT64VECTOR3(o, o, o);
+  inner.hi = INT64VECTOR3(o+sx, o+sy, o+sz);
+  m_root->Prepare(brick, inner);
+
+  #pragma omp parallel for
+  for(int64_t z=0; z < sz; ++z) {
+    for(int64_t y=0; y < sy; ++y) {
+      double* row = out + size_t(sx*(y + sy*z));
+      for(int64_t x=0; x < sx; ++x) {
+        row[x] = m_root->Eval(brick, x+o, y+o, z+o);
+      }
+    }
+  }
+}
+
+void EvaluateStencilExpression(const IOManager& iom, const std::string& expr,
+                               const std::vector<std::string>& volumes,
+                               const std::string& output,
+                               const std::string& tempDir,
+                               uint64_t bricksize, uint32_t brickoverlap,
+                               ConversionJournal* journal)
+{
+  StencilExpression expression(expr);
+  if(expression.GetVolumeCount() > volumes.size()) {
+    std::ostringstream err;
+    err << "expression references v[" << expression.GetVolumeCount()-1
+        << "] but only " << volumes.size() << " volumes were given";
+    throw std::runtime_error(err.str());
+  }
+
+  std::vector<std::unique_ptr<UVFBrickSource>> src;
+  for(size_t i=0; i < volumes.size(); ++i) {
+    src.push_back(std::unique_ptr<UVFBrickSource>(
+      new UVFBrickSource(volumes[i])
+    ));
+    if(src[i]->GetComponentCount() != 1) {
+      throw std::runtime_error("'" + volumes[i] + "' is not a scalar volume");
+    }
+    if(src[i]->GetDomainSize(0) != src[0]->GetDomainSize(0) ||
+       src[i]->GetMaxBrickSize() != src[0]->GetMaxBrickSize() ||
+       src[i]->GetOverlap() != src[0]->GetOverlap()) {
+      throw std::runtime_error("'" + volumes[i] + "' differs from '" +
+                               volumes[0] + "' in size or bricking; "
+                               "re-convert both with the same brick size");
+    }
+  }
+
+  const uint32_t overlap = src[0]->GetOverlap();
+  if(expression.GetRadius() > overlap) {
+    std::ostringstream err;
+    err << "expression needs " << expression.GetRadius() << " voxels of "
+        << "context but the input only has a brick overlap of " << overlap;
+    throw std::runtime_error(err.str());
+  }
+
+  const ExtendedOctree::COMPONENT_TYPE type = src[0]->GetComponentType();
+  const uint64_t compSize = src[0]->GetComponentSize();
+  const UINT64VECTOR3 domain = src[0]->GetDomainSize(0);
+  const UINT64VECTOR3 bricks = src[0]->GetBrickCount(0);
+
+  const std::string base = SysTools::GetFilename(SysTools::RemoveExt(output));
+  const std::string rawFile = tempDir + base + ".stencil.raw";
+  const std::string nhdrFile = tempDir + base + ".stencil.nhdr";
+
+  // the result of an interrupted run is reused; its bricks are verified
+  // against the journal's checksums below.
+  const bool resume = journal && SysTools::FileExists(rawFile) &&
+                      (journal->IsStageDone("stencil") ||
+                       journal->GetBrickDoneCount("stencil") > 0);
+  LargeRAWFile_ptr raw(new LargeRAWFile(rawFile));
+  if(resume ? !raw->Open(true) : !raw->Create(domain.volume() * compSize)) {
+    throw std::runtime_error("could not create temporary file " + rawFile);
+  }
+  if(journal) { journal->BeginStage("stencil"); }
+
+  BrickData brick;
+  brick.volumes.resize(src.size());
+  std::vector<double> result;
+  std::vector<uint8_t> converted;
+  // every input brick as raw data and as doubles, the result and its
+  // converted copy, and three buffers for each neighborhood operator.
+  const MemoryAccountant::Reservation buffers(
+    src[0]->GetMaxBrickSize().volume() *
+    (uint64_t(sizeof(double))*(src.size()+1+3*expression.GetStencilCount()) +
+     2*compSize)
+  );
+  const uint64_t total = bricks.volume();
+  // if every brick was written before, the result only needs bricking.
+  uint64_t done = (resume && journal->IsStageDone("stencil")) ? total : 0;
+  for(uint64_t bz=0; bz < bricks.z && done < total; ++bz) {
+    for(uint64_t by=0; by < bricks.y; ++by) {
+      for(uint64_t bx=0; bx < bricks.x; ++bx) {
+        const UINT64VECTOR4 key(bx,by,bz, 0);
+        const uint64_t index = bx + bricks.x*(by + bricks.y*bz);
+        MESSAGE("Evaluating expression on brick %llu of %llu",
+                static_cast<unsigned long long>(++done),
+                static_cast<unsigned long long>(total));
+
+        const UINT64VECTOR3 offset = src[0]->GetBrickOffset(key);
+        const UINT64VECTOR3 inner = src[0]->GetBrickSize(key) -
+                                    2*uint64_t(overlap);
+        const size_t line = size_t(inner.x * compSize);
+        converted.resize(size_t(inner.volume() * compSize));
+
+        uint64_t checksum = 0;
+        if(resume && journal->GetBrickChecksum("stencil", index, checksum)) {
+          for(uint64_t z=0; z < inner.z; ++z) {
+            for(uint64_t y=0; y < inner.y; ++y) {
+              const uint64_t pos = offset.x + domain.x*((offset.y+y) +
+                                                        domain.y*(offset.z+z));
+              raw->SeekPos(pos * compSize);
+              raw->ReadRAW(&converted[size_t(line*(y + inner.y*z))], line);
+            }
+          }
+          if(ConversionJournal::Checksum(converted.data(), converted.size())
+             == checksum) {
+            continue;
+          }
+          WARNING("Brick %llu failed verification; recomputing it.",
+                  static_cast<unsigned long long>(index));
+        }
+
+        for(size_t i=0; i < src.size(); ++i) {
+          src[i]->ReadBrick(key, brick.volumes[i]);
+        }
+        brick.size = src[0]->GetBrickSize(key);
+        // clamp reads at the volume border: the overlap there does not
+        // correspond to any real data.
+        brick.validMin = INT64VECTOR3(
+          offset.x == 0 ? overlap : 0,
+          offset.y == 0 ? overlap : 0,
+          offset.z == 0 ? overlap : 0
+        );
+        brick.validMax = INT64VECTOR3(
+          offset.x+inner.x == domain.x ? overlap+inner.x-1 : brick.size.x-1,
+          offset.y+inner.y == domain.y ? overlap+inner.y-1 : brick.size.y-1,
+          offset.z+inner.z == domain.z ? overlap+inner.z-1 : brick.size.z-1
+        );
+
+        result.resize(size_t(inner.volume()));
+        expression.Evaluate(brick, overlap, result.data());
+
+        ConvertFromDouble(type, result.data(), result.size(),
+                          converted.data());
+        for(uint64_t z=0; z < inner.z; ++z) {
+          for(uint64_t y=0; y < inner.y; ++y) {
+            const uint64_t pos = offset.x + domain.x*((offset.y+y) +
+                                                      domain.y*(offset.z+z));
+            raw->SeekPos(pos * compSize);
+            raw->WriteRAW(&converted[size_t(line*(y + inner.y*z))], line);
+          }
+        }
+        if(journal) {
+          journal->MarkBrickDone("stencil", index,
+            ConversionJournal::Checksum(converted.data(), converted.size()));
+        }
+      }
+    }
+  }
+  raw->Close();
+  if(journal) { journal->EndStage("stencil"); }
+
+  {
+    std::ofstream nhdr(nhdrFile.c_str());
+    nhdr << "NRRD0004\n"
+         << "type: " << NRRDTypeName(type) << "\n"
+         << "dimension: 3\n"
+         << "sizes: " << domain.x << " " << domain.y << " " << domain.z << "\n"
+         << "encoding: raw\n"
+         << "endian: " << (EndianConvert::IsLittleEndian() ? "little" : "big")
+         << "\n"
+         << "data file: " << SysTools::GetFilename(rawFile) << "\n";
+  }
+
+  if(journal) { journal->BeginStage("brick"); }
+  const bool ok = iom.ConvertDataset(nhdrFile, output, tempDir, true,
+                                     bricksize, brickoverlap);
+  if(!ok) {
+    if(journal) { journal->AbortStage("brick"); }
+    throw std::runtime_error("could not brick the expression result into " +
+                             output);
+  }
+  if(journal) { journal->EndStage("brick"); }
+  raw->Delete();
+  std::remove(nhdrFile.c_str());
+}
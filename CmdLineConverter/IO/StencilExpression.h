@@ -0,0 +1,116 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    StencilExpression.h
+  \brief   Expression language with neighborhood (stencil) operators,
+           evaluated brick by brick using the brick overlap as a halo.
+*/
+
+#pragma once
+
+#ifndef STENCILEXPRESSION_H
+#define STENCILEXPRESSION_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/Basics/Vectors.h"
+
+class ConversionJournal;
+class IOManager;
+
+namespace stencil {
+  class Node;
+
+  /// The voxels of all input volumes for one brick, overlap included.
+  struct BrickData {
+    std::vector<std::vector<double>> volumes;
+    UINT64VECTOR3 size;     ///< brick size including the overlap
+    /// range of brick-local coordinates which lie inside the domain; reads
+    /// outside of it are clamped, i.e. the volume border is replicated.
+    INT64VECTOR3 validMin;
+    INT64VECTOR3 validMax;
+  };
+}
+
+/// Parses the merge expression language (see doc/expressions.adoc) extended
+/// by the neighborhood operators
+///   blur(e, r)     mean over a (2r+1)^3 box
+///   gauss(e, s)    Gaussian with standard deviation s, cut at 2s
+///   gradmag(e)     gradient magnitude by central differences
+///   min(e, r)      minimum over a (2r+1)^3 box
+///   max(e, r)      maximum over a (2r+1)^3 box
+///   median(e, r)   median over a (2r+1)^3 box
+/// where 'e' is any subexpression and 'r'/'s' are constants.
+class StencilExpression {
+public:
+  /// throws std::runtime_error on syntax errors.
+  explicit StencilExpression(const std::string& expr);
+  ~StencilExpression();
+
+  /// true if the expression calls any neighborhood operator, i.e. if it
+  /// must be evaluated by this class instead of the per-voxel evaluator.
+  static bool UsesStencils(const std::string& expr);
+
+  /// number of voxels of context needed around each voxel.
+  uint32_t GetRadius() const;
+  /// number of input volumes referenced (highest v[] index + 1).
+  size_t GetVolumeCount() const;
+  /// number of neighborhood operators; each holds three brick-sized
+  /// buffers of doubles while evaluating.
+  size_t GetStencilCount() const;
+
+  /// evaluates the expression for every non-overlap voxel of the brick;
+  /// 'out' receives (size - 2*overlap).volume() values in x-fastest order.
+  /// Every operator first writes its argument, including the halo it
+  /// needs, to a buffer, so nested operators evaluate their argument once
+  /// per voxel.
+  void Evaluate(const stencil::BrickData& brick, uint32_t overlap,
+                double* out);
+
+private:
+  std::unique_ptr<stencil::Node> m_root;
+};
+
+/// Evaluates 'expr' over the given UVF volumes and writes the result to
+/// 'output'.  Every brick of the finest level is read exactly once and the
+/// result is assembled in a single raw file in 'tempDir' which is then
+/// bricked like any other conversion.  Throws std::runtime_error on failure.
+/// If a journal is given, finished bricks are recorded in it and bricks a
+/// previous, interrupted run already wrote are verified and skipped.
+void EvaluateStencilExpression(const IOManager& iom, const std::string& expr,
+                               const std::vector<std::string>& volumes,
+                               const std::string& output,
+                               const std::string& tempDir,
+                               uint64_t bricksize, uint32_t brickoverlap,
+                               ConversionJournal* journal=NULL);
+
+#endif // STENCILEXPRESSION_H
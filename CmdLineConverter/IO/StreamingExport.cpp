@@ -0,0 +1,355 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    StreamingExport.cpp
+  \brief   Exports a level of a UVF by assembling scanlines from its bricks
+           on the fly, without staging the volume in a temporary file.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
+#include "MemoryAccountant.h"
+#include "StreamingExport.h"
+#include "UVFBrickSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/EndianConvert.h"
+#include "../../Tuvok/Basics/SysTools.h"
+
+RawSlabSink::RawSlabSink(const std::string& filename) :
+  m_filename(filename),
+  m_offset(0),
+  m_voxelSize(0)
+{
+}
+
+bool RawSlabSink::Begin(const UINT64VECTOR3& size,
+                        ExtendedOctree::COMPONENT_TYPE type,
+                        uint64_t components, const DOUBLEVECTOR3&)
+{
+  m_file.reset(new LargeRAWFile(m_filename));
+  if(!m_file->Create()) {
+    T_ERROR("Could not create '%s'", m_filename.c_str());
+    return false;
+  }
+  m_offset = 0;
+  m_size = size;
+  m_voxelSize = ComponentTypeSize(type) * components;
+  return true;
+}
+
+bool RawSlabSink::Write(const std::string& header)
+{
+  m_file->SeekPos(0);
+  m_offset = header.size();
+  return m_file->WriteRAW(reinterpret_cast<const uint8_t*>(header.data()),
+                          header.size()) == header.size();
+}
+
+bool RawSlabSink::Rows(uint64_t z0, uint64_t depth, uint64_t y0,
+                       uint64_t height, const uint8_t* data)
+{
+  const uint64_t line = m_size.x * m_voxelSize;
+  if(height == m_size.y) {
+    // whole slices: one contiguous write
+    m_file->SeekPos(m_offset + z0*m_size.y*line);
+    const uint64_t bytes = depth*height*line;
+    return m_file->WriteRAW(data, bytes) == bytes;
+  }
+  for(uint64_t z=0; z < depth; ++z) {
+    m_file->SeekPos(m_offset + ((z0+z)*m_size.y + y0)*line);
+    const uint64_t bytes = height*line;
+    if(m_file->WriteRAW(data + z*bytes, bytes) != bytes) { return false; }
+  }
+  return true;
+}
+
+bool RawSlabSink::End()
+{
+  m_file->Close();
+  return true;
+}
+
+NRRDSlabSink::NRRDSlabSink(const std::string& filename) :
+  RawSlabSink(SysTools::ToLowerCase(SysTools::GetExt(filename)) == "nhdr"
+              ? SysTools::ChangeExt(filename, "raw") : filename),
+  m_header(filename),
+  m_bDetached(SysTools::ToLowerCase(SysTools::GetExt(filename)) == "nhdr")
+{
+}
+
+bool NRRDSlabSink::Begin(const UINT64VECTOR3& size,
+                         ExtendedOctree::COMPONENT_TYPE type,
+                         uint64_t components, const DOUBLEVECTOR3& spacing)
+{
+  std::ostringstream hdr;
+  hdr << "NRRD0004\n"
+      << "type: " << NRRDTypeName(type) << "\n";
+  if(components > 1) {
+    hdr << "dimension: 4\n"
+        << "sizes: " << components << " " << size.x << " " << size.y << " "
+        << size.z << "\n"
+        << "spacings: nan " << spacing.x << " " << spacing.y << " "
+        << spacing.z << "\n";
+  } else {
+    hdr << "dimension: 3\n"
+        << "sizes: " << size.x << " " << size.y << " " << size.z << "\n"
+        << "spacings: " << spacing.x << " " << spacing.y << " " << spacing.z
+        << "\n";
+  }
+  hdr << "encoding: raw\n"
+      << "endian: " << (EndianConvert::IsLittleEndian() ? "little" : "big")
+      << "\n";
+
+  if(m_bDetached) {
+    hdr << "data file: " << SysTools::GetFilename(m_filename) << "\n";
+    std::ofstream nhdr(m_header.c_str());
+    nhdr << hdr.str();
+    if(!nhdr) {
+      T_ERROR("Could not write '%s'", m_header.c_str());
+      return false;
+    }
+    return RawSlabSink::Begin(size, type, components, spacing);
+  }
+  // an empty line separates the header from the attached data.
+  hdr << "\n";
+  return RawSlabSink::Begin(size, type, components, spacing) &&
+         Write(hdr.str());
+}
+
+std::unique_ptr<SlabSink> CreateSlabSink(const std::string& filename)
+{
+  const std::string ext = SysTools::ToLowerCase(SysTools::GetExt(filename));
+  if(ext == "raw") {
+    return std::unique_ptr<SlabSink>(new RawSlabSink(filename));
+  }
+  if(ext == "nrrd" || ext == "nhdr") {
+    return std::unique_ptr<SlabSink>(new NRRDSlabSink(filename));
+  }
+  return std::unique_ptr<SlabSink>();
+}
+
+namespace {
+  // The part of one row of bricks (all bricks sharing a y and z index)
+  // which lies in the exported region.
+  struct BrickRow {
+    uint64_t by, bz;        ///< brick index of the row
+    uint64_t y0, z0;        ///< position in the region
+    uint64_t height, depth;
+    std::vector<uint8_t> data;
+  };
+}
+
+bool StreamExport(const std::string& uvf, uint64_t lod, SlabSink& sink,
+                  size_t lookAhead)
+{
+  const uint64_t all = std::numeric_limits<uint64_t>::max();
+  return StreamExport(uvf, lod, UINT64VECTOR3(0,0,0),
+                      UINT64VECTOR3(all,all,all), sink, lookAhead);
+}
+
+bool StreamExport(const std::string& uvf, uint64_t lod,
+                  const UINT64VECTOR3& roiMin, const UINT64VECTOR3& roiMax,
+                  SlabSink& sink, size_t lookAhead)
+{
+#ifdef _OPENMP
+  const int workers = std::max(1, omp_get_max_threads());
+#else
+  const int workers = 1;
+#endif
+  // the TOC reader shares one file handle, so every thread gets its own.
+  std::vector<std::unique_ptr<UVFBrickSource>> src;
+  try {
+    for(int i=0; i < workers; ++i) {
+      src.push_back(std::unique_ptr<UVFBrickSource>(new UVFBrickSource(uvf)));
+    }
+  } catch(const std::exception& e) {
+    T_ERROR("%s", e.what());
+    return false;
+  }
+  const UVFBrickSource& s0 = *src[0];
+  if(lod >= s0.GetLoDCount()) {
+    T_ERROR("'%s' has only %llu levels of detail", uvf.c_str(),
+            static_cast<unsigned long long>(s0.GetLoDCount()));
+    return false;
+  }
+
+  // the region is given in finest-level voxels; scale it to this level,
+  // rounding outwards.
+  const UINT64VECTOR3 finest = s0.GetDomainSize(0);
+  const UINT64VECTOR3 domain = s0.GetDomainSize(lod);
+  const UINT64VECTOR3 lo(
+    std::min(roiMin.x, finest.x) * domain.x / finest.x,
+    std::min(roiMin.y, finest.y) * domain.y / finest.y,
+    std::min(roiMin.z, finest.z) * domain.z / finest.z
+  );
+  const UINT64VECTOR3 hi(
+    (std::min(roiMax.x, finest.x) * domain.x + finest.x-1) / finest.x,
+    (std::min(roiMax.y, finest.y) * domain.y + finest.y-1) / finest.y,
+    (std::min(roiMax.z, finest.z) * domain.z + finest.z-1) / finest.z
+  );
+  if(hi.x <= lo.x || hi.y <= lo.y || hi.z <= lo.z) {
+    T_ERROR("The export region is empty");
+    return false;
+  }
+  const UINT64VECTOR3 region = hi - lo;
+
+  const uint64_t overlap = s0.GetOverlap();
+  const uint64_t voxel = s0.GetComponentSize() * s0.GetComponentCount();
+  // only the bricks which intersect the region are read.
+  const UINT64VECTOR3 stride = s0.GetMaxBrickSize() - 2*overlap;
+  const UINT64VECTOR3 bmin(lo.x / stride.x, lo.y / stride.y, lo.z / stride.z);
+  const UINT64VECTOR3 bmax((hi.x-1) / stride.x, (hi.y-1) / stride.y,
+                           (hi.z-1) / stride.z);
+  const uint64_t nx = bmax.x - bmin.x + 1;
+  const uint64_t ny = bmax.y - bmin.y + 1;
+  const uint64_t rows = ny * (bmax.z - bmin.z + 1);
+  // keep every worker busy with at least two bricks if memory permits;
+  // the memory budget decides per batch how many rows are decoded.
+  lookAhead = std::max<size_t>(lookAhead,
+                               size_t((2*uint64_t(workers) + nx-1) / nx));
+  const uint64_t rowBytes = region.x * std::min(region.y, stride.y) *
+                            std::min(region.z, stride.z) * voxel;
+  MemoryAccountant& memory = MemoryAccountant::Instance();
+  // one decoded brick per worker
+  const MemoryAccountant::Reservation scratch(
+    uint64_t(workers) * s0.GetMaxBrickSize().volume() * voxel
+  );
+
+  // a coarser level covers the same extent with fewer, larger voxels.
+  const DOUBLEVECTOR3 scale = s0.GetScale();
+  const DOUBLEVECTOR3 spacing(scale.x * double(finest.x) / double(domain.x),
+                              scale.y * double(finest.y) / double(domain.y),
+                              scale.z * double(finest.z) / double(domain.z));
+  if(!sink.Begin(region, s0.GetComponentType(), s0.GetComponentCount(),
+                 spacing)) {
+    return false;
+  }
+
+  // one batch is decoded while the previous one is written.
+  std::vector<BrickRow> buffers[2];
+  MemoryAccountant::Reservation held[2];
+  std::future<bool> writing;
+  size_t slot = 0;
+  bool limited = false;
+  for(uint64_t first=0, n=0; first < rows; first += n, slot ^= 1) {
+    const size_t wanted = size_t(std::min<uint64_t>(lookAhead, rows - first));
+    n = memory.Fit(rowBytes, wanted, held[slot].Bytes());
+    if(n < wanted && !limited) {
+      MESSAGE("The memory budget limits the export to %llu brick row(s) "
+              "at a time", static_cast<unsigned long long>(n));
+      limited = true;
+    }
+    std::vector<BrickRow>& batch = buffers[slot];
+    batch.resize(size_t(n));
+    held[slot].Resize(n * rowBytes);
+    for(size_t r=0; r < batch.size(); ++r) {
+      BrickRow& row = batch[r];
+      row.by = bmin.y + (first+r) % ny;
+      row.bz = bmin.z + (first+r) / ny;
+      const UINT64VECTOR4 key(bmin.x, row.by, row.bz, lod);
+      const UINT64VECTOR3 offset = s0.GetBrickOffset(key);
+      const UINT64VECTOR3 inner = s0.GetBrickSize(key) - 2*overlap;
+      row.y0 = std::max(lo.y, offset.y) - lo.y;
+      row.z0 = std::max(lo.z, offset.z) - lo.z;
+      row.height = std::min(hi.y, offset.y + inner.y) - lo.y - row.y0;
+      row.depth = std::min(hi.z, offset.z + inner.z) - lo.z - row.z0;
+      row.data.resize(size_t(region.x * row.height * row.depth * voxel));
+    }
+
+    // decode every brick of the batch; bricks write disjoint parts of their
+    // row, so no locking is needed.
+    const int64_t tasks = int64_t(n * nx);
+    bool failed = false;
+    #pragma omp parallel for schedule(dynamic) reduction(||:failed)
+    for(int64_t t=0; t < tasks; ++t) {
+#ifdef _OPENMP
+      const UVFBrickSource& s = *src[omp_get_thread_num()];
+#else
+      const UVFBrickSource& s = *src[0];
+#endif
+      BrickRow& row = batch[size_t(uint64_t(t) / nx)];
+      const UINT64VECTOR4 key(bmin.x + uint64_t(t) % nx, row.by, row.bz, lod);
+      std::vector<uint8_t> brick;
+      try {
+        s.ReadBrick(key, brick);
+      } catch(const std::exception&) {
+        failed = true;
+        continue;
+      }
+      const UINT64VECTOR3 size = s.GetBrickSize(key);
+      const UINT64VECTOR3 offset = s.GetBrickOffset(key);
+      const uint64_t x0 = std::max(lo.x, offset.x);
+      const uint64_t x1 = std::min(hi.x, offset.x + size.x - 2*overlap);
+      const size_t line = size_t((x1 - x0) * voxel);
+      for(uint64_t z=0; z < row.depth; ++z) {
+        // brick-local coordinates, overlap included
+        const uint64_t bz = lo.z + row.z0 + z - offset.z + overlap;
+        for(uint64_t y=0; y < row.height; ++y) {
+          const uint64_t by = lo.y + row.y0 + y - offset.y + overlap;
+          const uint64_t from = (bz*size.y + by)*size.x +
+                                (x0 - offset.x + overlap);
+          const uint64_t to = (z*row.height + y)*region.x + (x0 - lo.x);
+          std::memcpy(&row.data[size_t(to*voxel)],
+                      &brick[size_t(from*voxel)], line);
+        }
+      }
+    }
+    if(failed) {
+      T_ERROR("Could not read the bricks of '%s'", uvf.c_str());
+      if(writing.valid()) { writing.wait(); }
+      return false;
+    }
+
+    if(writing.valid() && !writing.get()) { return false; }
+    MESSAGE("Exporting brick row %llu of %llu",
+            static_cast<unsigned long long>(first + n),
+            static_cast<unsigned long long>(rows));
+    writing = std::async(std::launch::async, [&sink, &batch]() {
+      for(size_t r=0; r < batch.size(); ++r) {
+        const BrickRow& row = batch[r];
+        if(!sink.Rows(row.z0, row.depth, row.y0, row.height,
+                      row.data.data())) {
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+  if(writing.valid() && !writing.get()) { return false; }
+  return sink.End();
+}
@@ -0,0 +1,124 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    StreamingExport.h
+  \brief   Exports a level of a UVF by assembling scanlines from its bricks
+           on the fly, without staging the volume in a temporary file.
+*/
+
+#pragma once
+
+#ifndef STREAMINGEXPORT_H
+#define STREAMINGEXPORT_H
+
+#include <memory>
+#include <string>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/Basics/Vectors.h"
+#include "../../Tuvok/Basics/LargeRAWFile.h"
+#include "../../Tuvok/IO/UVF/TOCBlock.h"
+
+/// Receives an exported volume as blocks of full-width scanlines.  Blocks
+/// arrive in brick order, one row of bricks at a time, and never overlap.
+class SlabSink {
+public:
+  virtual ~SlabSink() {}
+
+  /// called once before any data.
+  virtual bool Begin(const UINT64VECTOR3& size,
+                     ExtendedOctree::COMPONENT_TYPE type,
+                     uint64_t components, const DOUBLEVECTOR3& spacing) = 0;
+  /// 'data' holds scanlines [y0, y0+height) of slices [z0, z0+depth); each
+  /// scanline is size.x voxels, x fastest, then y, then z.  When height is
+  /// the full size.y, the block is a contiguous slab of slices.
+  virtual bool Rows(uint64_t z0, uint64_t depth, uint64_t y0,
+                    uint64_t height, const uint8_t* data) = 0;
+  virtual bool End() = 0;
+};
+
+/// Writes the voxels to a flat raw file.
+class RawSlabSink : public SlabSink {
+public:
+  explicit RawSlabSink(const std::string& filename);
+  virtual ~RawSlabSink() {}
+
+  virtual bool Begin(const UINT64VECTOR3& size,
+                     ExtendedOctree::COMPONENT_TYPE type,
+                     uint64_t components, const DOUBLEVECTOR3& spacing);
+  virtual bool Rows(uint64_t z0, uint64_t depth, uint64_t y0,
+                    uint64_t height, const uint8_t* data);
+  virtual bool End();
+
+protected:
+  /// for subclasses which put a header in front of the data.
+  bool Write(const std::string& header);
+
+  std::string m_filename;
+  LargeRAWFile_ptr m_file;
+  uint64_t m_offset;      ///< position of the first voxel in the file
+  UINT64VECTOR3 m_size;
+  uint64_t m_voxelSize;
+};
+
+/// Writes a NRRD: a .nrrd with the data attached to the header, or a .nhdr
+/// header plus a .raw data file next to it.
+class NRRDSlabSink : public RawSlabSink {
+public:
+  explicit NRRDSlabSink(const std::string& filename);
+  virtual ~NRRDSlabSink() {}
+
+  virtual bool Begin(const UINT64VECTOR3& size,
+                     ExtendedOctree::COMPONENT_TYPE type,
+                     uint64_t components, const DOUBLEVECTOR3& spacing);
+
+private:
+  std::string m_header;
+  bool m_bDetached;
+};
+
+/// a sink for the output file's type, or NULL if the type cannot be
+/// streamed and must go through IOManager::ExportDataset.
+std::unique_ptr<SlabSink> CreateSlabSink(const std::string& filename);
+
+/// Streams level 'lod' of 'uvf' to 'sink'.  Rows of bricks are decompressed
+/// in parallel, each thread with its own file handle; up to 'lookAhead'
+/// rows (or two bricks per thread, if that is more) are decoded while the
+/// previous ones are being written, fewer if the MemoryAccountant budget
+/// does not have room for them.
+bool StreamExport(const std::string& uvf, uint64_t lod, SlabSink& sink,
+                  size_t lookAhead=4);
+/// Streams the box [roiMin, roiMax) of level 'lod'; the box is given in
+/// voxels of the finest level and clamped to the domain.  Only the bricks
+/// which intersect it are read.
+bool StreamExport(const std::string& uvf, uint64_t lod,
+                  const UINT64VECTOR3& roiMin, const UINT64VECTOR3& roiMax,
+                  SlabSink& sink, size_t lookAhead=4);
+
+#endif // STREAMINGEXPORT_H
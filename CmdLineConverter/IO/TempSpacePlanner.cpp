@@ -0,0 +1,212 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    TempSpacePlanner.cpp
+  \brief   Chooses scratch directories for conversion intermediates and
+           checks up front that they have enough free space.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#ifdef _WIN32
+# include <windows.h>
+# include <direct.h>
+#else
+# include <sys/stat.h>
+# include <sys/statvfs.h>
+# include <unistd.h>
+#endif
+
+#include "TempSpacePlanner.h"
+#include "UVFBrickSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/SysTools.h"
+
+static const uint64_t UNKNOWN_SPACE = std::numeric_limits<uint64_t>::max();
+
+static uint64_t file_size(const std::string& filename)
+{
+  std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary |
+                                    std::ios::ate);
+  return f.is_open() ? uint64_t(f.tellg()) : 0;
+}
+
+static unsigned long long megabytes(uint64_t bytes)
+{
+  return static_cast<unsigned long long>(bytes / (1024*1024));
+}
+
+static std::string with_separator(std::string dir)
+{
+  if(dir.empty()) { return "./"; }
+  const char last = dir[dir.size()-1];
+  if(last != '/' && last != '\\') { dir += "/"; }
+  return dir;
+}
+
+TempSpacePlanner::TempSpacePlanner(const std::vector<std::string>& dirs,
+                                   const std::string& fallback,
+                                   const std::string& subdir) :
+  m_bOwnDirs(!subdir.empty())
+{
+  const std::vector<std::string> wanted =
+    dirs.empty() ? std::vector<std::string>(1, fallback) : dirs;
+  for(std::vector<std::string>::const_iterator w = wanted.begin();
+      w != wanted.end(); ++w) {
+    std::string d = with_separator(*w);
+    if(m_bOwnDirs) {
+      d = with_separator(d + subdir);
+#ifdef _WIN32
+      const int made = _mkdir(d.c_str());
+#else
+      const int made = mkdir(d.c_str(), 0755);
+#endif
+      if(made != 0 && errno != EEXIST) {
+        T_ERROR("Could not create the scratch directory '%s': %s; it will "
+                "not be used.", d.c_str(), strerror(errno));
+        continue;
+      }
+    }
+
+    m_dirs.push_back(d);
+    m_free.push_back(FreeSpace(d));
+    if(m_free.back() == UNKNOWN_SPACE) {
+      WARNING("Could not determine the free space in '%s'; assuming there "
+              "is enough.", d.c_str());
+    } else {
+      MESSAGE("Scratch directory '%s': %llu MB free", d.c_str(),
+              megabytes(m_free.back()));
+    }
+  }
+}
+
+TempSpacePlanner::~TempSpacePlanner()
+{
+  if(!m_bOwnDirs) { return; }
+  // fails, as it should, if intermediates were left for a resumed run.
+  for(std::vector<std::string>::const_iterator d = m_dirs.begin();
+      d != m_dirs.end(); ++d) {
+#ifdef _WIN32
+    _rmdir(d->c_str());
+#else
+    rmdir(d->c_str());
+#endif
+  }
+}
+
+std::string TempSpacePlanner::Reserve(const std::string& what,
+                                      uint64_t bytes,
+                                      const std::string& existing)
+{
+  if(m_dirs.empty()) {
+    T_ERROR("%s needs scratch space but no scratch directory is usable.",
+            what.c_str());
+    return "";
+  }
+  size_t best = 0;
+  const std::string found = existing.empty() ? "" : Find(existing);
+  if(!found.empty()) {
+    best = std::find(m_dirs.begin(), m_dirs.end(), found) - m_dirs.begin();
+  } else {
+    for(size_t i=1; i < m_dirs.size(); ++i) {
+      if(m_free[i] > m_free[best]) { best = i; }
+    }
+    if(m_free[best] < bytes) {
+      T_ERROR("%s needs about %llu MB of scratch space but at most %llu MB "
+              "are available; use --tempdir to add scratch directories.",
+              what.c_str(), megabytes(bytes), megabytes(m_free[best]));
+      return "";
+    }
+  }
+  if(m_free[best] != UNKNOWN_SPACE) {
+    m_free[best] -= std::min(m_free[best], bytes);
+  }
+  MESSAGE("%s: reserved %llu MB in '%s'", what.c_str(), megabytes(bytes),
+          m_dirs[best].c_str());
+  return m_dirs[best];
+}
+
+std::string TempSpacePlanner::Find(const std::string& filename) const
+{
+  for(std::vector<std::string>::const_iterator d = m_dirs.begin();
+      d != m_dirs.end(); ++d) {
+    if(SysTools::FileExists(*d + filename)) { return *d; }
+  }
+  return "";
+}
+
+uint64_t TempSpacePlanner::RawSize(const std::string& file)
+{
+  if(SysTools::ToLowerCase(SysTools::GetExt(file)) == "uvf") {
+    try {
+      const UVFBrickSource src(file);
+      return src.GetDomainSize(0).volume() * src.GetComponentCount() *
+             src.GetComponentSize();
+    } catch(const std::exception& e) {
+      WARNING("%s; estimating its size from the file size.", e.what());
+    }
+  }
+  return file_size(file);
+}
+
+uint64_t TempSpacePlanner::DirectorySize(const std::string& dir)
+{
+  const std::vector<std::string> files = SysTools::GetDirContents(dir);
+  uint64_t bytes = 0;
+  for(std::vector<std::string>::const_iterator f = files.begin();
+      f != files.end(); ++f) {
+    bytes += file_size(*f);
+  }
+  return bytes;
+}
+
+uint64_t TempSpacePlanner::EstimateConversion(uint64_t rawBytes)
+{
+  // raw copy + bricked data (the LOD pyramid adds 1/7) + brick overlap and
+  // headers, for which 10% is generous for all but tiny bricks.
+  return rawBytes + (rawBytes + rawBytes/7) + rawBytes/10;
+}
+
+uint64_t TempSpacePlanner::FreeSpace(const std::string& dir)
+{
+#ifdef _WIN32
+  ULARGE_INTEGER avail;
+  if(!GetDiskFreeSpaceExA(dir.c_str(), &avail, NULL, NULL)) {
+    return UNKNOWN_SPACE;
+  }
+  return avail.QuadPart;
+#else
+  struct statvfs fs;
+  if(statvfs(dir.c_str(), &fs) != 0) { return UNKNOWN_SPACE; }
+  return uint64_t(fs.f_bavail) * fs.f_frsize;
+#endif
+}
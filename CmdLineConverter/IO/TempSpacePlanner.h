@@ -0,0 +1,94 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    TempSpacePlanner.h
+  \brief   Chooses scratch directories for conversion intermediates and
+           checks up front that they have enough free space.
+*/
+
+#pragma once
+
+#ifndef TEMPSPACEPLANNER_H
+#define TEMPSPACEPLANNER_H
+
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+
+/// Keeps a budget of the free space in each scratch directory.  Every
+/// intermediate of a conversion reserves its estimated size before the
+/// conversion starts; reservations go to the directory with the most space
+/// left, so large conversions spread over several scratch disks and fail
+/// before any work is done if the space is not there.
+class TempSpacePlanner {
+public:
+  /// 'dirs' are the scratch directories given by the user; if there are
+  /// none, 'fallback' is used.  If 'subdir' is given, the intermediates go
+  /// to that subdirectory of each of them, which is created here and
+  /// removed again by the destructor if it is empty by then.  Directories
+  /// which cannot be created are dropped with an error; GetDirs() is empty
+  /// if none is left.
+  TempSpacePlanner(const std::vector<std::string>& dirs,
+                   const std::string& fallback,
+                   const std::string& subdir="");
+  ~TempSpacePlanner();
+
+  /// all scratch directories, with a trailing separator.
+  const std::vector<std::string>& GetDirs() const { return m_dirs; }
+
+  /// Reserves 'bytes' for 'what' and returns the directory to put it in,
+  /// or an empty string (after logging an error) if no directory has
+  /// enough space left.  If 'existing' is a file name found in one of the
+  /// directories, that directory is used regardless, since the file is the
+  /// leftover of an interrupted run which is about to be picked up again.
+  std::string Reserve(const std::string& what, uint64_t bytes,
+                      const std::string& existing="");
+
+  /// the directory containing 'filename', or an empty string.
+  std::string Find(const std::string& filename) const;
+
+  /// bytes of the raw voxel data of 'file'.  This is exact for UVFs and
+  /// the file size otherwise, which underestimates compressed formats.
+  static uint64_t RawSize(const std::string& file);
+  /// sum of the sizes of all files in 'dir'.
+  static uint64_t DirectorySize(const std::string& dir);
+  /// peak scratch space of a ConvertDataset call on 'rawBytes' of voxels:
+  /// the intermediate raw file plus the bricked copy with all its LODs.
+  static uint64_t EstimateConversion(uint64_t rawBytes);
+  /// free bytes on the file system holding 'dir'; UINT64_MAX if unknown.
+  static uint64_t FreeSpace(const std::string& dir);
+
+private:
+  std::vector<std::string> m_dirs;
+  std::vector<uint64_t> m_free;
+  bool m_bOwnDirs;
+};
+
+#endif // TEMPSPACEPLANNER_H
@@ -0,0 +1,242 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    UVFBrickSource.cpp
+  \brief   Read-only, brick-level access to the TOC block of a UVF file.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "UVFBrickSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/IO/UVF/UVF.h"
+
+UVFBrickSource::UVFBrickSource(const std::string& filename) :
+  m_filename(filename),
+  m_toc(NULL)
+{
+  std::wstring wstrFilename(filename.begin(), filename.end());
+  m_uvf.reset(new UVF(wstrFilename));
+
+  std::string strProblem;
+  if(!m_uvf->Open(false, false, false, &strProblem)) {
+    throw std::runtime_error("could not open '" + filename + "': " +
+                             strProblem);
+  }
+  for(uint64_t i=0; i < m_uvf->GetDataBlockCount(); ++i) {
+    m_toc = dynamic_cast<const TOCBlock*>(m_uvf->GetDataBlock(i).get());
+    if(m_toc) { break; }
+  }
+  if(!m_toc) {
+    m_uvf->Close();
+    throw std::runtime_error("'" + filename + "' does not contain a "
+                             "bricked (TOC) volume");
+  }
+}
+
+UVFBrickSource::~UVFBrickSource()
+{
+  m_uvf->Close();
+}
+
+uint64_t UVFBrickSource::GetLoDCount() const { return m_toc->GetLoDCount(); }
+
+UINT64VECTOR3 UVFBrickSource::GetDomainSize(uint64_t lod) const {
+  return m_toc->GetLODDomainSize(lod);
+}
+
+UINT64VECTOR3 UVFBrickSource::GetBrickCount(uint64_t lod) const {
+  return m_toc->GetBrickCount(lod);
+}
+
+UINT64VECTOR3 UVFBrickSource::GetMaxBrickSize() const {
+  return m_toc->GetMaxBrickSize();
+}
+
+UINT64VECTOR3 UVFBrickSource::GetBrickSize(const UINT64VECTOR4& brick) const {
+  return m_toc->GetBrickSize(brick);
+}
+
+uint32_t UVFBrickSource::GetOverlap() const {
+  return static_cast<uint32_t>(m_toc->GetOverlap());
+}
+
+DOUBLEVECTOR3 UVFBrickSource::GetScale() const { return m_toc->GetScale(); }
+
+ExtendedOctree::COMPONENT_TYPE UVFBrickSource::GetComponentType() const {
+  return m_toc->GetComponentType();
+}
+
+uint64_t UVFBrickSource::GetComponentCount() const {
+  return m_toc->GetComponentCount();
+}
+
+uint64_t UVFBrickSource::GetComponentSize() const {
+  return m_toc->GetComponentTypeSize();
+}
+
+bool UVFBrickSource::IsSigned() const {
+  switch(GetComponentType()) {
+    case ExtendedOctree::CT_INT8:
+    case ExtendedOctree::CT_INT16:
+    case ExtendedOctree::CT_INT32:
+    case ExtendedOctree::CT_INT64:
+    case ExtendedOctree::CT_FLOAT32:
+    case ExtendedOctree::CT_FLOAT64: return true;
+    default: return false;
+  }
+}
+
+bool UVFBrickSource::IsFloat() const {
+  return GetComponentType() == ExtendedOctree::CT_FLOAT32 ||
+         GetComponentType() == ExtendedOctree::CT_FLOAT64;
+}
+
+UINT64VECTOR3 UVFBrickSource::GetBrickOffset(const UINT64VECTOR4& brick) const
+{
+  // all bricks but the last one in each direction have the maximum size, so
+  // the stride between bricks is the max size minus the overlap on both sides
+  const UINT64VECTOR3 stride = GetMaxBrickSize() - 2*uint64_t(GetOverlap());
+  return UINT64VECTOR3(brick.x*stride.x, brick.y*stride.y, brick.z*stride.z);
+}
+
+void UVFBrickSource::ReadBrick(const UINT64VECTOR4& brick,
+                               std::vector<uint8_t>& data) const
+{
+  const uint64_t bytes = GetBrickSize(brick).volume() * GetComponentCount() *
+                         GetComponentSize();
+  data.resize(static_cast<size_t>(bytes));
+  std::lock_guard<std::mutex> lock(m_readLock);
+  m_toc->GetData(data.data(), brick);
+}
+
+void UVFBrickSource::ReadBrick(const UINT64VECTOR4& brick,
+                               std::vector<double>& data) const
+{
+  if(GetComponentCount() != 1) {
+    throw std::runtime_error("only scalar volumes can be read as double");
+  }
+  std::vector<uint8_t> raw;
+  ReadBrick(brick, raw);
+  data.resize(raw.size() / static_cast<size_t>(GetComponentSize()));
+  ConvertToDouble(GetComponentType(), raw.data(), data.size(), data.data());
+}
+
+namespace {
+  template<typename T>
+  void to_double(const uint8_t* in, size_t count, double* out) {
+    const T* src = reinterpret_cast<const T*>(in);
+    std::copy(src, src+count, out);
+  }
+
+  template<typename T>
+  void from_double(const double* in, size_t count, uint8_t* out) {
+    T* dst = reinterpret_cast<T*>(out);
+    if(std::numeric_limits<T>::is_integer) {
+      const double lo = static_cast<double>(std::numeric_limits<T>::min());
+      const double hi = static_cast<double>(std::numeric_limits<T>::max());
+      for(size_t i=0; i < count; ++i) {
+        dst[i] = static_cast<T>(std::min(hi, std::max(lo, std::floor(in[i]+0.5))));
+      }
+    } else {
+      for(size_t i=0; i < count; ++i) { dst[i] = static_cast<T>(in[i]); }
+    }
+  }
+}
+
+void ConvertToDouble(ExtendedOctree::COMPONENT_TYPE type, const uint8_t* in,
+                     size_t count, double* out)
+{
+  switch(type) {
+    case ExtendedOctree::CT_UINT8:   to_double<uint8_t>(in, count, out); break;
+    case ExtendedOctree::CT_UINT16:  to_double<uint16_t>(in, count, out); break;
+    case ExtendedOctree::CT_UINT32:  to_double<uint32_t>(in, count, out); break;
+    case ExtendedOctree::CT_UINT64:  to_double<uint64_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT8:    to_double<int8_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT16:   to_double<int16_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT32:   to_double<int32_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT64:   to_double<int64_t>(in, count, out); break;
+    case ExtendedOctree::CT_FLOAT32: to_double<float>(in, count, out); break;
+    case ExtendedOctree::CT_FLOAT64: to_double<double>(in, count, out); break;
+  }
+}
+
+void ConvertFromDouble(ExtendedOctree::COMPONENT_TYPE type, const double* in,
+                       size_t count, uint8_t* out)
+{
+  switch(type) {
+    case ExtendedOctree::CT_UINT8:   from_double<uint8_t>(in, count, out); break;
+    case ExtendedOctree::CT_UINT16:  from_double<uint16_t>(in, count, out); break;
+    case ExtendedOctree::CT_UINT32:  from_double<uint32_t>(in, count, out); break;
+    case ExtendedOctree::CT_UINT64:  from_double<uint64_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT8:    from_double<int8_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT16:   from_double<int16_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT32:   from_double<int32_t>(in, count, out); break;
+    case ExtendedOctree::CT_INT64:   from_double<int64_t>(in, count, out); break;
+    case ExtendedOctree::CT_FLOAT32: from_double<float>(in, count, out); break;
+    case ExtendedOctree::CT_FLOAT64: from_double<double>(in, count, out); break;
+  }
+}
+
+uint64_t ComponentTypeSize(ExtendedOctree::COMPONENT_TYPE type)
+{
+  switch(type) {
+    case ExtendedOctree::CT_UINT8:
+    case ExtendedOctree::CT_INT8:    return 1;
+    case ExtendedOctree::CT_UINT16:
+    case ExtendedOctree::CT_INT16:   return 2;
+    case ExtendedOctree::CT_UINT32:
+    case ExtendedOctree::CT_INT32:
+    case ExtendedOctree::CT_FLOAT32: return 4;
+    case ExtendedOctree::CT_UINT64:
+    case ExtendedOctree::CT_INT64:
+    case ExtendedOctree::CT_FLOAT64: return 8;
+  }
+  return 1;
+}
+
+const char* NRRDTypeName(ExtendedOctree::COMPONENT_TYPE type)
+{
+  switch(type) {
+    case ExtendedOctree::CT_UINT8:   return "uint8";
+    case ExtendedOctree::CT_UINT16:  return "uint16";
+    case ExtendedOctree::CT_UINT32:  return "uint32";
+    case ExtendedOctree::CT_UINT64:  return "uint64";
+    case ExtendedOctree::CT_INT8:    return "int8";
+    case ExtendedOctree::CT_INT16:   return "int16";
+    case ExtendedOctree::CT_INT32:   return "int32";
+    case ExtendedOctree::CT_INT64:   return "int64";
+    case ExtendedOctree::CT_FLOAT32: return "float";
+    case ExtendedOctree::CT_FLOAT64: return "double";
+  }
+  return "uint8";
+}
@@ -0,0 +1,113 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    UVFBrickSource.h
+  \brief   Read-only, brick-level access to the TOC block of a UVF file.
+*/
+
+#pragma once
+
+#ifndef UVFBRICKSOURCE_H
+#define UVFBRICKSOURCE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/Basics/Vectors.h"
+#include "../../Tuvok/IO/UVF/TOCBlock.h"
+
+class UVF;
+
+/// Opens a UVF and exposes the bricks of its (first) TOC block.  Bricks are
+/// addressed as (x, y, z, lod) like in the TOC itself; every brick carries
+/// GetOverlap() voxels of its neighbors on each side.
+///
+/// Reading is serialized internally, since the underlying file handle is
+/// shared.  Callers that want to decompress in parallel should open one
+/// source per thread.
+class UVFBrickSource {
+public:
+  /// throws std::runtime_error if the file cannot be opened or has no
+  /// bricked volume in it.
+  explicit UVFBrickSource(const std::string& filename);
+  ~UVFBrickSource();
+
+  const std::string& GetFilename() const { return m_filename; }
+
+  uint64_t GetLoDCount() const;
+  UINT64VECTOR3 GetDomainSize(uint64_t lod) const;
+  UINT64VECTOR3 GetBrickCount(uint64_t lod) const;
+  UINT64VECTOR3 GetMaxBrickSize() const;
+  /// size of the given brick, overlap included.
+  UINT64VECTOR3 GetBrickSize(const UINT64VECTOR4& brick) const;
+  uint32_t GetOverlap() const;
+  /// voxel aspect ratio.
+  DOUBLEVECTOR3 GetScale() const;
+
+  ExtendedOctree::COMPONENT_TYPE GetComponentType() const;
+  uint64_t GetComponentCount() const;
+  uint64_t GetComponentSize() const;
+  bool IsSigned() const;
+  bool IsFloat() const;
+
+  /// position, in its LOD's domain, of the first voxel of the brick which is
+  /// not part of the overlap.
+  UINT64VECTOR3 GetBrickOffset(const UINT64VECTOR4& brick) const;
+
+  /// reads and decompresses a brick, overlap included.
+  void ReadBrick(const UINT64VECTOR4& brick, std::vector<uint8_t>& data) const;
+  /// reads a single-component brick and converts it to double.
+  void ReadBrick(const UINT64VECTOR4& brick, std::vector<double>& data) const;
+
+private:
+  std::string m_filename;
+  std::unique_ptr<UVF> m_uvf;
+  const TOCBlock* m_toc;
+  mutable std::mutex m_readLock;
+};
+
+/// Converts 'count' values of the given component type to double.
+void ConvertToDouble(ExtendedOctree::COMPONENT_TYPE type, const uint8_t* in,
+                     size_t count, double* out);
+
+/// Converts 'count' doubles into the given component type, rounding and
+/// clamping to the type's range for integer types.
+void ConvertFromDouble(ExtendedOctree::COMPONENT_TYPE type, const double* in,
+                       size_t count, uint8_t* out);
+
+/// bytes per component of the given type.
+uint64_t ComponentTypeSize(ExtendedOctree::COMPONENT_TYPE type);
+
+/// NRRD name ("uint8", "float", ...) of a component type.
+const char* NRRDTypeName(ExtendedOctree::COMPONENT_TYPE type);
+
+#endif // UVFBRICKSOURCE_H
@@ -0,0 +1,248 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    VolumeSource.cpp
+  \brief   Pull-based readers for volume formats which the bricker can
+           consume without a raw intermediate file.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <sstream>
+
+#include "MemoryAccountant.h"
+#include "NRRDSource.h"
+#include "UVFBrickSource.h"
+#include "VolumeSource.h"
+#include "../../Tuvok/Controller/Controller.h"
+#include "../../Tuvok/Basics/EndianConvert.h"
+#include "../../Tuvok/Basics/LargeRAWFile.h"
+#include "../../Tuvok/Basics/SysTools.h"
+#include "../../Tuvok/IO/IOManager.h"
+
+const std::vector<std::shared_ptr<VolumeSourceFactory>>& VolumeSourceFactories()
+{
+  // Register streaming formats here.
+  static const std::vector<std::shared_ptr<VolumeSourceFactory>> factories = {
+    std::make_shared<NRRDSourceFactory>(),
+  };
+  return factories;
+}
+
+const VolumeSourceFactory* FindVolumeSource(const std::string& filename)
+{
+  const std::vector<std::shared_ptr<VolumeSourceFactory>>& factories =
+    VolumeSourceFactories();
+  if(factories.empty()) { return NULL; }
+
+  // the same amount IOManager shows its converters.
+  std::vector<int8_t> bytes(512, 0);
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  if(!in.is_open()) { return NULL; }
+  in.read(reinterpret_cast<char*>(bytes.data()),
+          std::streamsize(bytes.size()));
+  bytes.resize(size_t(in.gcount()));
+
+  for(size_t i=0; i < factories.size(); ++i) {
+    if(factories[i]->CanRead(filename, bytes)) { return factories[i].get(); }
+  }
+  return NULL;
+}
+
+namespace {
+  std::string absolute_path(const std::string& path) {
+#ifdef _WIN32
+    char buf[_MAX_PATH];
+    return _fullpath(buf, path.c_str(), _MAX_PATH) ? std::string(buf)
+                                                   : std::string();
+#else
+    char* resolved = realpath(path.c_str(), NULL);
+    if(!resolved) { return std::string(); }
+    const std::string abs(resolved);
+    std::free(resolved);
+    return abs;
+#endif
+  }
+
+  std::vector<std::string> split_path(const std::string& path) {
+    std::vector<std::string> parts;
+    std::string part;
+    for(size_t i=0; i <= path.size(); ++i) {
+      if(i == path.size() || path[i] == '/' || path[i] == '\\') {
+        parts.push_back(part);
+        part.clear();
+      } else {
+        part += path[i];
+      }
+    }
+    return parts;
+  }
+
+  // 'file' relative to the directory 'dir', or an empty string if there is
+  // no such path (different drives).  NRRD data files are looked up
+  // relative to their header, which lives in the temp directory.
+  std::string relative_path(const std::string& dir, const std::string& file)
+  {
+    const std::string absDir = absolute_path(dir.empty() ? "." : dir);
+    const std::string absFile = absolute_path(file);
+    if(absDir.empty() || absFile.empty()) { return std::string(); }
+    std::vector<std::string> d = split_path(absDir);
+    const std::vector<std::string> f = split_path(absFile);
+    while(!d.empty() && d.back().empty()) { d.pop_back(); }
+    // the first part is empty on POSIX systems and the drive on Windows.
+    if(d.empty() || f.empty() || d[0] != f[0]) { return std::string(); }
+
+    size_t common = 1;
+    while(common < d.size() && common+1 < f.size() && d[common] == f[common]) {
+      ++common;
+    }
+    std::string rel;
+    for(size_t i=common; i < d.size(); ++i) { rel += "../"; }
+    for(size_t i=common; i < f.size(); ++i) {
+      rel += f[i] + (i+1 < f.size() ? "/" : "");
+    }
+    return rel;
+  }
+
+  bool write_nhdr(const std::string& nhdrFile, const VolumeSourceInfo& info,
+                  const std::string& dataFile, uint64_t offset,
+                  bool bigEndian)
+  {
+    std::ofstream nhdr(nhdrFile.c_str());
+    nhdr << "NRRD0004\n"
+         << "type: " << NRRDTypeName(info.type) << "\n";
+    if(info.components > 1) {
+      nhdr << "dimension: 4\n"
+           << "sizes: " << info.components << " ";
+    } else {
+      nhdr << "dimension: 3\n"
+           << "sizes: ";
+    }
+    nhdr << info.size.x << " " << info.size.y << " " << info.size.z << "\n"
+         << "spacings: " << (info.components > 1 ? "nan " : "")
+         << info.aspect.x << " " << info.aspect.y << " " << info.aspect.z
+         << "\n"
+         << "encoding: raw\n"
+         << "endian: " << (bigEndian ? "big" : "little") << "\n";
+    if(offset != 0) { nhdr << "byte skip: " << offset << "\n"; }
+    if(!info.title.empty()) { nhdr << "content: " << info.title << "\n"; }
+    nhdr << "data file: " << dataFile << "\n";
+    return nhdr.good();
+  }
+
+  // streams all slabs of 'source' to 'rawFile'; one slab is written while
+  // the next one is read.
+  bool stage(VolumeSource& source, const VolumeSourceInfo& info,
+             const std::string& rawFile)
+  {
+    const uint64_t slice = info.size.x * info.size.y * info.components *
+                           ComponentTypeSize(info.type);
+    LargeRAWFile raw(rawFile);
+    if(!raw.Create(slice * info.size.z)) {
+      T_ERROR("Could not create temporary file %s", rawFile.c_str());
+      return false;
+    }
+    std::vector<uint8_t> slabs[2];
+    MemoryAccountant::Reservation held[2];
+    std::future<bool> writing;
+    size_t buf = 0;
+    bool ok = true;
+    for(uint64_t z=0, depth=0; z < info.size.z && ok; z += depth, buf ^= 1) {
+      depth = MemoryAccountant::Instance().Fit(
+        slice, size_t(std::min<uint64_t>(64, info.size.z - z)),
+        held[buf].Bytes()
+      );
+      held[buf].Resize(depth * slice);
+      slabs[buf].resize(size_t(depth * slice));
+      if(!source.ReadSlab(z, depth, slabs[buf].data())) {
+        T_ERROR("Could not read slices %llu to %llu",
+                static_cast<unsigned long long>(z),
+                static_cast<unsigned long long>(z + depth - 1));
+        ok = false;
+        break;
+      }
+      if(writing.valid() && !writing.get()) { ok = false; break; }
+      MESSAGE("Read slice %llu of %llu",
+              static_cast<unsigned long long>(z + depth),
+              static_cast<unsigned long long>(info.size.z));
+      const std::vector<uint8_t>* slab = &slabs[buf];
+      writing = std::async(std::launch::async, [&raw, slab]() {
+        return raw.WriteRAW(slab->data(), slab->size()) == slab->size();
+      });
+    }
+    if(writing.valid() && !writing.get()) { ok = false; }
+    raw.Close();
+    if(!ok) {
+      T_ERROR("Could not write %s", rawFile.c_str());
+      raw.Delete();
+    }
+    return ok;
+  }
+}
+
+bool ConvertVolumeSource(const IOManager& iom, VolumeSource& source,
+                         const std::string& output, const std::string& tempDir,
+                         uint64_t bricksize, uint32_t brickoverlap)
+{
+  const VolumeSourceInfo info = source.GetInfo();
+  const std::string nhdrFile = tempDir +
+    SysTools::ChangeExt(SysTools::GetFilename(output), "source.nhdr");
+
+  std::string file, rawFile;
+  uint64_t offset = 0;
+  bool bigEndian = false;
+  std::string dataFile;
+  if(source.GetRawLayout(file, offset, bigEndian)) {
+    dataFile = relative_path(tempDir, file);
+  }
+  if(dataFile.empty()) {
+    rawFile = SysTools::ChangeExt(nhdrFile, "raw");
+    dataFile = SysTools::GetFilename(rawFile);
+    offset = 0;
+    bigEndian = !EndianConvert::IsLittleEndian();
+    if(!stage(source, info, rawFile)) { return false; }
+  } else {
+    MESSAGE("Bricking %s in place", file.c_str());
+  }
+
+  bool ok = write_nhdr(nhdrFile, info, dataFile, offset, bigEndian);
+  if(!ok) {
+    T_ERROR("Could not write %s", nhdrFile.c_str());
+  } else {
+    ok = iom.ConvertDataset(nhdrFile, output, tempDir, true, bricksize,
+                            brickoverlap);
+  }
+  std::remove(nhdrFile.c_str());
+  if(!rawFile.empty()) { std::remove(rawFile.c_str()); }
+  return ok;
+}
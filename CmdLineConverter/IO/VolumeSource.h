@@ -0,0 +1,111 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    VolumeSource.h
+  \brief   Pull-based readers for volume formats which the bricker can
+           consume without a raw intermediate file.
+*/
+
+#pragma once
+
+#ifndef VOLUMESOURCE_H
+#define VOLUMESOURCE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../Tuvok/StdTuvokDefines.h"
+#include "../../Tuvok/Basics/Vectors.h"
+#include "../../Tuvok/IO/UVF/TOCBlock.h"
+
+class IOManager;
+
+struct VolumeSourceInfo {
+  UINT64VECTOR3 size;
+  ExtendedOctree::COMPONENT_TYPE type;
+  uint64_t components;
+  DOUBLEVECTOR3 aspect;
+  std::string title;
+};
+
+/// An open volume in a format of its own.  The alternative to writing a
+/// RAWConverter: instead of rewriting the data as a raw file, a source
+/// hands out slabs of slices on request, and if its file stores the voxels
+/// as a plain array anyway, says where, so the bricker reads them in place.
+class VolumeSource {
+public:
+  virtual ~VolumeSource() {}
+
+  virtual VolumeSourceInfo GetInfo() const = 0;
+
+  /// Copies the slices [z0, z0+depth) to 'out', x varying fastest and in
+  /// the byte order of the running program.  Slabs are requested in
+  /// increasing z order, though slices may be skipped.
+  virtual bool ReadSlab(uint64_t z0, uint64_t depth, void* out) = 0;
+
+  /// If 'file' holds the voxels as one contiguous array starting at byte
+  /// 'offset' (x fastest, components interleaved), returns true; the data
+  /// is then bricked straight from that file and ReadSlab is not used.
+  virtual bool GetRawLayout(std::string& /*file*/, uint64_t& /*offset*/,
+                            bool& /*bigEndian*/) const {
+    return false;
+  }
+};
+
+/// Recognizes and opens the files of one format.
+class VolumeSourceFactory {
+public:
+  virtual ~VolumeSourceFactory() {}
+
+  /// a short description of the format, for messages.
+  virtual const char* GetDesc() const = 0;
+  /// true if 'filename', which starts with 'bytes', is in this format; like
+  /// AbstrConverter::CanRead, this must not read the file.
+  virtual bool CanRead(const std::string& filename,
+                       const std::vector<int8_t>& bytes) const = 0;
+  /// NULL, after logging the reason, if the file cannot be opened.
+  virtual VolumeSource* Open(const std::string& filename) const = 0;
+};
+
+/// the factories of all streaming formats; new formats are added in
+/// VolumeSource.cpp.
+const std::vector<std::shared_ptr<VolumeSourceFactory>>& VolumeSourceFactories();
+/// the factory which can read 'filename', or NULL.
+const VolumeSourceFactory* FindVolumeSource(const std::string& filename);
+
+/// Bricks 'source' into the UVF 'output'.  Sources with a raw layout are
+/// read in place; the others are streamed once, in slabs sized to the
+/// MemoryAccountant budget, into a raw file in 'tempDir' which is removed
+/// afterwards.
+bool ConvertVolumeSource(const IOManager& iom, VolumeSource& source,
+                         const std::string& output, const std::string& tempDir,
+                         uint64_t bricksize, uint32_t brickoverlap);
+
+#endif // VOLUMESOURCE_H
@@ -36,14 +36,32 @@
 //!    Copyright (C) 2008 SCI Institute
 
 #include "../Tuvok/StdTuvokDefines.h"
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <tclap/CmdLine.h>
 
 #include "DebugOut/HRConsoleOut.h"
+#include "DebugOut/ProgressOut.h"
+#include "IO/CodecSelector.h"
+#include "IO/ConversionJournal.h"
+#include "IO/MemoryAccountant.h"
+#include "IO/MeshPipeline.h"
+#include "IO/StackIngest.h"
+#include "IO/SplitVolume.h"
+#include "IO/StencilExpression.h"
+#include "IO/StreamingExport.h"
+#include "IO/TempSpacePlanner.h"
+#include "IO/UVFBrickSource.h"
+#include "IO/VolumeSource.h"
 #include "../Tuvok/Controller/Controller.h"
 #include "../Tuvok/Basics/SysTools.h"
 #include "../Tuvok/Basics/SystemInfo.h"
@@ -88,10 +106,55 @@ enum {
   EXIT_FAILURE_MERGE_NO_UVF,  // attempting to merge to format other than UVF
   EXIT_FAILURE_GENERAL_DIR,   // general error during conversion in dir mode
   EXIT_FAILURE_NEED_UVF,      // UVFs must be input to eval expressions.
+  EXIT_FAILURE_TEMPSPACE,     // not enough space in the scratch directories
 };
 
+// machine readable progress (--progress); NULL if not requested.
+static ProgressOut* progressOut = NULL;
+static HRConsoleOut* consoleOut = NULL;
+
+// starts a phase of the --progress output; 'bytes' is the amount of data it
+// processes, if known.  The last status of the previous phase is shown on
+// the console even if it came too quickly after the one before.
+static void progress_phase(const std::string& phase, uint64_t bytes=0)
+{
+  if(consoleOut) { consoleOut->Flush(); }
+  if(progressOut) { progressOut->SetPhase(phase, bytes); }
+}
+
+// Conversions done by a single call can only clean up after an interrupted
+// run, not continue it.
+static void resume_starts_over(const ConversionJournal& journal,
+                               const char* what)
+{
+  if(journal.IsResuming()) {
+    WARNING("%s is done in one step, so --resume cannot skip any of it; it "
+            "starts over once the temporary files of the interrupted run "
+            "are removed.", what);
+  }
+}
+
 static int export_data(const IOManager&, const std::string in,
-                       const std::string out);
+                       const std::string out, const std::string tempDir,
+                       uint64_t lod);
+
+// parses "x0,y0,z0,x1,y1,z1" into the box [lo, hi).
+static bool parse_roi(const std::string& s, UINT64VECTOR3& lo,
+                      UINT64VECTOR3& hi)
+{
+  std::istringstream is(s);
+  uint64_t v[6];
+  for(size_t i=0; i < 6; ++i) {
+    char sep = ',';
+    if((i > 0 && !(is >> sep)) || sep != ',' || !(is >> v[i])) {
+      return false;
+    }
+  }
+  if(!(is >> std::ws).eof()) { return false; }
+  lo = UINT64VECTOR3(v[0], v[1], v[2]);
+  hi = UINT64VECTOR3(v[3], v[4], v[5]);
+  return lo.x < hi.x && lo.y < hi.y && lo.z < hi.z;
+}
 
 // reads an entire file into a string.
 static std::string readfile(const std::string& filename)
@@ -118,7 +181,7 @@ static std::string readfile(const std::string& filename)
   return std::string(&contents[0]);
 }
 
-int main(int argc, const char* argv[])
+static int convert(int argc, const char* argv[])
 {
 /*
 // Enable run-time memory check for debug builds on windows
@@ -129,6 +192,7 @@ int main(int argc, const char* argv[])
   #endif
 */
   std::vector<std::string> input;
+  std::vector<std::string> tempdirs;
   std::string output, directory;
   std::string expression;
 
@@ -140,11 +204,21 @@ int main(int argc, const char* argv[])
   double fScale = 0.0;
   double fBias = 0.0;
   bool debug;
+  bool resume;
   uint32_t bricksize = 64;
   uint32_t bricklayout = 0; // 0 is default scanline layout
   const uint32_t brickoverlap = 2;
   uint32_t compression = 1; // 1 is default zlib compression
   uint32_t level = 1; // generic compression level 1 is best speed
+  bool autoCompress = false;
+  CodecSelector::Objective objective = CodecSelector::OBJ_WEIGHTED;
+  double objectiveWeight = 0.5;
+  uint32_t lod = 0;
+  uint32_t splitParts = 0;
+  bool useROI = false;
+  bool dedup = false;
+  std::string progressTarget;
+  UINT64VECTOR3 roiMin(0,0,0), roiMax(0,0,0);
   float fMem = 0.8f;
 
   try {
@@ -159,6 +233,11 @@ int main(int argc, const char* argv[])
                                       "merge expression", false, "", "string");
     TCLAP::ValueArg<std::string> output("o", "output", "output file (uvf)",
                                         true, "", "filename");
+    TCLAP::MultiArg<std::string> opt_tempdir("t", "tempdir", "scratch "
+                                             "directory for intermediate "
+                                             "files.  Repeat to spread them "
+                                             "over several disks", false,
+                                             "path");
     TCLAP::ValueArg<double> bias("b", "bias",
                                  "(merging) bias value for second file",
                                  false, 0.0, "floating point number");
@@ -183,12 +262,47 @@ int main(int argc, const char* argv[])
     TCLAP::ValueArg<uint32_t> opt_level("v", "level", "UVF compression level "
                                         "between (1..10)",
                                         false, 1, "positive integer");
+    TCLAP::ValueArg<std::string> opt_auto("a", "auto-compress", "choose the "
+                                          "compression method (overrides -p) "
+                                          "by trying all on a sample of the "
+                                          "bricks of a UVF or NRRD input; "
+                                          "one method is used for the whole "
+                                          "dataset, not one per brick: size, "
+                                          "speed, balanced or the weight of "
+                                          "size vs. speed (0..1)", false, "",
+                                          "objective");
+    TCLAP::ValueArg<uint32_t> opt_lod("", "lod", "(export) level of detail "
+                                      "to export, 0 is the finest", false, 0,
+                                      "positive integer");
+    TCLAP::ValueArg<std::string> opt_roi("", "roi", "(export) only export "
+                                         "the box [x0,x1) x [y0,y1) x "
+                                         "[z0,z1), in voxels of the finest "
+                                         "level", false, "",
+                                         "x0,y0,z0,x1,y1,z1");
+    TCLAP::ValueArg<uint32_t> opt_split("", "split", "(uvf to uvf) split "
+                                        "the finest level into this many "
+                                        "spatial parts for sort-last "
+                                        "rendering", false, 0,
+                                        "positive integer");
+    TCLAP::SwitchArg opt_dedup("", "dedup", "(geometry) merge vertices "
+                               "with identical attributes", false);
+    TCLAP::ValueArg<std::string> opt_progress("", "progress", "write "
+                                              "progress as JSON lines to "
+                                              "this file descriptor or "
+                                              "file", false, "", "fd|file");
     TCLAP::SwitchArg dbg("g", "debug", "Enable debugging mode", false);
     TCLAP::SwitchArg experim("", "experimental",
                              "Enable experimental features", false);
+    TCLAP::SwitchArg opt_resume("", "resume", "Resume an interrupted "
+                                "conversion to the same output.  Skips the "
+                                "finished stacks of a directory, the "
+                                "extraction step of UVF to UVF and the "
+                                "finished bricks of a stencil expression; "
+                                "other conversions start over", false);
     
     cmd.xorAdd(inputs, directory);
     cmd.add(output);
+    cmd.add(opt_tempdir);
     cmd.add(bias);
     cmd.add(scale);
     cmd.add(opt_mem);
@@ -196,9 +310,16 @@ int main(int argc, const char* argv[])
     cmd.add(opt_bricklayout);
     cmd.add(opt_compression);
     cmd.add(opt_level);
+    cmd.add(opt_auto);
+    cmd.add(opt_lod);
+    cmd.add(opt_roi);
+    cmd.add(opt_split);
+    cmd.add(opt_dedup);
+    cmd.add(opt_progress);
     cmd.add(expr);
     cmd.add(dbg);
     cmd.add(experim);
+    cmd.add(opt_resume);
     cmd.parse(argc, argv);
 
     // which of "-i" or "-d" did they give?
@@ -213,6 +334,7 @@ int main(int argc, const char* argv[])
       strInDir = directory.getValue();
     }
     strOutFile = output.getValue();
+    tempdirs = opt_tempdir.getValue();
     fBias = bias.getValue();
     fScale = scale.getValue();
     fMem = opt_mem.getValue();
@@ -220,6 +342,27 @@ int main(int argc, const char* argv[])
     bricklayout = opt_bricklayout.getValue();
     compression = opt_compression.getValue();
     level = opt_level.getValue();
+    if(opt_auto.isSet()) {
+      autoCompress = true;
+      if(!CodecSelector::ParseObjective(opt_auto.getValue(), objective,
+                                        objectiveWeight)) {
+        std::cerr << "error: invalid compression objective '"
+                  << opt_auto.getValue() << "'\n";
+        return EXIT_FAILURE_ARG;
+      }
+    }
+
+    lod = opt_lod.getValue();
+    splitParts = opt_split.getValue();
+    if(opt_roi.isSet()) {
+      useROI = true;
+      if(!parse_roi(opt_roi.getValue(), roiMin, roiMax)) {
+        std::cerr << "error: invalid region '" << opt_roi.getValue()
+                  << "'; expected x0,y0,z0,x1,y1,z1 with x0<x1, y0<y1 "
+                  << "and z0<z1\n";
+        return EXIT_FAILURE_ARG;
+      }
+    }
 
     if(expr.isSet()) {
       expression = expr.getValue();
@@ -227,7 +370,10 @@ int main(int argc, const char* argv[])
         expression = readfile(expression);
       }
     }
+    dedup = opt_dedup.getValue();
+    progressTarget = opt_progress.getValue();
     debug = dbg.getValue();
+    resume = opt_resume.getValue();
     Controller::Instance().ExperimentalFeatures(experim.getValue());
   } catch(const TCLAP::ArgException& e) {
     std::cerr << "error: " << e.error() << " for arg " << e.argId() << "\n";
@@ -241,6 +387,19 @@ int main(int argc, const char* argv[])
   }
 
   Controller::Instance().AddDebugOut(debugOut);
+  consoleOut = debugOut;
+  if(!progressTarget.empty()) {
+    progressOut = new ProgressOut(progressTarget);
+    if(!progressOut->IsOpen()) {
+      std::cerr << "error: cannot write progress to '" << progressTarget
+                << "'\n";
+      delete progressOut;
+      progressOut = NULL;
+      return EXIT_FAILURE_ARG;
+    }
+    progressOut->SetOutput(true, true, true, false);
+    Controller::Instance().AddDebugOut(progressOut);
+  }
   if (fMem < 0.05f) {
     fMem = 0.05f;
     MESSAGE("Clamped max allowed RAM utilization to: %.2f%%", fMem * 100);
@@ -252,6 +411,7 @@ int main(int argc, const char* argv[])
   }
   const uint64_t memTotal = Controller::Const().SysInfo().GetCPUMemSize();
   Controller::Instance().SetMaxCPUMem((memTotal*fMem)/(1024*1024));
+  MemoryAccountant::Instance().SetBudget(uint64_t(memTotal*fMem));
   uint32_t mem = uint32_t(Controller::Instance().SysInfo()->GetMaxUsableCPUMem()/1024/1024);
   MESSAGE("Using up to %u MB RAM", mem);
   cout << endl;
@@ -260,7 +420,60 @@ int main(int argc, const char* argv[])
   ioMan.SetCompression(compression);
   ioMan.SetCompressionLevel(level);
   ioMan.SetLayout(bricklayout);
-  
+
+  // Automatic compression tries every codec on bricks of the input: those
+  // of a UVF, or bricks cut from the slabs of a streaming source, which is
+  // opened a second time for this so the conversion reads it from the
+  // start.
+  if(autoCompress) {
+    const bool uvf = !input.empty() &&
+      SysTools::ToLowerCase(SysTools::GetExt(input[0])) == "uvf";
+    const VolumeSourceFactory* sampled =
+      input.empty() || uvf ? NULL : FindVolumeSource(input[0]);
+    if(uvf || sampled) {
+      try {
+        CodecSelector selector(objective, level);
+        selector.SetWeight(objectiveWeight);
+        if(uvf) {
+          selector.Sample(UVFBrickSource(input[0]), 256);
+        } else {
+          std::unique_ptr<VolumeSource> source(sampled->Open(input[0]));
+          if(!source) {
+            throw std::runtime_error("Could not open " + input[0]);
+          }
+          selector.Sample(*source, bricksize, 256);
+        }
+        selector.Report();
+        compression = selector.GetBest();
+        MESSAGE("Using %s compression", CodecSelector::Name(
+                static_cast<COMPRESSION_TYPE>(compression)));
+        ioMan.SetCompression(compression);
+      } catch(const std::exception& e) {
+        WARNING("%s; keeping the -p compression method.", e.what());
+      }
+    } else {
+      WARNING("Automatic compression needs a UVF or NRRD input; convert to "
+              "UVF first and recompress that.  Keeping the -p compression "
+              "method.");
+    }
+  }
+
+  // Intermediates go to the scratch directories, the output's directory if
+  // none were given.  Every mode reserves the space it will need before it
+  // starts, so a conversion never fails hours in because a disk ran full.
+  // Each conversion gets a subdirectory of its own there, so cleaning up
+  // after an interrupted run cannot touch anybody else's files.
+  TempSpacePlanner scratch(tempdirs, SysTools::GetPath(strOutFile),
+                           ConversionJournal::ScratchName(strOutFile));
+  if(scratch.GetDirs().empty()) { return EXIT_FAILURE_TEMPSPACE; }
+
+  // Progress is journaled next to the output so that --resume can skip the
+  // parts an interrupted run already finished.
+  const std::vector<std::string> journalInputs =
+    strInDir.empty() ? input : std::vector<std::string>(1, strInDir);
+  ConversionJournal journal(strOutFile, journalInputs, scratch.GetDirs(),
+                            resume);
+
   // If they gave us an expression, evaluate that.  Otherwise we're doing a
   // normal conversion.
   if(!expression.empty()) {
@@ -274,11 +487,63 @@ int main(int argc, const char* argv[])
       }
     }
     try {
-      ioMan.EvaluateExpression(expression.c_str(), input, strOutFile);
+      if(StencilExpression::UsesStencils(expression)) {
+        // neighborhood operators need the bricks' overlap, which the
+        // per-voxel evaluator does not provide.  The result has the type and
+        // size of v[0] and is written to a raw file before bricking.
+        const uint64_t raw = TempSpacePlanner::RawSize(input[0]);
+        const std::string tempDir = scratch.Reserve(
+          "Expression evaluation",
+          raw + TempSpacePlanner::EstimateConversion(raw),
+          SysTools::GetFilename(SysTools::RemoveExt(strOutFile)) +
+          ".stencil.raw"
+        );
+        if(tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+        progress_phase("expression", raw);
+        EvaluateStencilExpression(ioMan, expression, input, strOutFile,
+                                  tempDir, bricksize, brickoverlap, &journal);
+      } else {
+        progress_phase("expression");
+        resume_starts_over(journal, "Expression evaluation");
+        ioMan.EvaluateExpression(expression.c_str(), input, strOutFile);
+      }
     } catch(const std::exception& e) {
       std::cerr << "expr exception: " << e.what() << "\n";
       return EXIT_FAILURE;
     }
+    journal.Finish();
+    return EXIT_SUCCESS;
+  }
+
+  // Formats with a streaming source are bricked without a RAWConverter.
+  const VolumeSourceFactory* streaming =
+    strInDir.empty() && strInFile2.empty() && !strInFile.empty()
+      ? FindVolumeSource(strInFile) : NULL;
+  if(streaming &&
+     SysTools::ToLowerCase(SysTools::GetExt(strOutFile)) == "uvf") {
+    cout << endl << "Running in streaming source mode.\nConverting "
+         << strInFile << " (" << streaming->GetDesc() << ") to "
+         << strOutFile << "\n\n";
+    std::unique_ptr<VolumeSource> source(streaming->Open(strInFile));
+    if(!source) { return EXIT_FAILURE_GENERAL; }
+    const VolumeSourceInfo info = source->GetInfo();
+    const uint64_t raw = info.size.volume() * info.components *
+                         ComponentTypeSize(info.type);
+    const string tempDir = scratch.Reserve(
+      "Conversion", raw + TempSpacePlanner::EstimateConversion(raw)
+    );
+    if(tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+    resume_starts_over(journal, "The conversion");
+    journal.BeginStage("uvf");
+    progress_phase("uvf", raw);
+    if(!ConvertVolumeSource(ioMan, *source, strOutFile, tempDir, bricksize,
+                            brickoverlap)) {
+      journal.AbortStage("uvf");
+      cout << "\nConversion failed!\n\n";
+      return EXIT_FAILURE_TO_UVF;
+    }
+    journal.Finish();
+    cout << "\nSuccess.\n\n";
     return EXIT_SUCCESS;
   }
 
@@ -308,8 +573,61 @@ int main(int argc, const char* argv[])
     bool bIsVolExt1 = ioMan.GetConverterForExt(sourceType, false, false) != NULL;
     bool bIsGeoExt1 = ioMan.GetGeoConverterForExt(sourceType, false, false) != NULL;
 
+    if(!ioMan.NeedsConversion(strInFile) && splitParts != 0 &&
+       targetType == "uvf") {
+      cout << endl << "Running in split mode.\nWriting " << splitParts
+           << " parts of " << strInFile << "\n\n";
+      const uint64_t raw = TempSpacePlanner::RawSize(strInFile);
+      // parts are converted one at a time, so one part's worth of scratch
+      // space is enough.
+      const uint64_t part = raw / splitParts + 1;
+      const string tempDir = scratch.Reserve(
+        "Split", part + TempSpacePlanner::EstimateConversion(part)
+      );
+      if(tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+      progress_phase("split", raw);
+      if(!SplitVolume(ioMan, strInFile, splitParts, strOutFile, tempDir,
+                      bricksize, brickoverlap)) {
+        cout << "\nSplit failed!\n\n";
+        return EXIT_FAILURE_TO_UVF;
+      }
+      journal.Finish();
+      cout << "\nSuccess.\n\n";
+      return EXIT_SUCCESS;
+    }
+
     if(!ioMan.NeedsConversion(strInFile)) {
-      return export_data(ioMan, strInFile, strOutFile);
+      if(!useROI) {
+        roiMax = UINT64VECTOR3(std::numeric_limits<uint64_t>::max(),
+                               std::numeric_limits<uint64_t>::max(),
+                               std::numeric_limits<uint64_t>::max());
+      }
+      progress_phase("export", TempSpacePlanner::RawSize(strInFile));
+      // raw and NRRD are written straight from the bricks; other formats
+      // need a flat intermediate file.
+      std::unique_ptr<SlabSink> sink = CreateSlabSink(strOutFile);
+      if(sink) {
+        return StreamExport(strInFile, lod, roiMin, roiMax, *sink)
+                 ? EXIT_SUCCESS : EXIT_FAILURE_GENERAL;
+      }
+      const std::string tempDir =
+        scratch.Reserve("Export", TempSpacePlanner::RawSize(strInFile));
+      if(tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+      if(!useROI) {
+        return export_data(ioMan, strInFile, strOutFile, tempDir, lod);
+      }
+
+      // IOManager can only export whole levels, so the region is streamed
+      // to an NRRD first and converted from there.
+      const std::string tmpFile = tempDir +
+        SysTools::ChangeExt(SysTools::GetFilename(strOutFile), "nhdr");
+      sink = CreateSlabSink(tmpFile);
+      bool ok = StreamExport(strInFile, lod, roiMin, roiMax, *sink) &&
+                ioMan.ConvertDataset(tmpFile, strOutFile, tempDir, true,
+                                     bricksize, brickoverlap);
+      std::remove(tmpFile.c_str());
+      std::remove(SysTools::ChangeExt(tmpFile, "raw").c_str());
+      return ok ? EXIT_SUCCESS : EXIT_FAILURE_GENERAL;
     }
 
     if (!bIsVolExt1 && !bIsGeoExt1)  {
@@ -336,7 +654,7 @@ int main(int argc, const char* argv[])
         return EXIT_FAILURE_RO_GEO_IN;
       }
 
-      if (!exporter->CanExportData()) {
+      if (!exporter->CanExportData() && !CanWriteMesh(strOutFile)) {
         std::cerr << "error: cannot write that type of geometry (only read)\n";
         return EXIT_FAILURE_RO_GEO_OUT;
       }
@@ -364,25 +682,43 @@ int main(int argc, const char* argv[])
                << "perserving only the raw data from " << strInFile << " to "
                << strOutFile << endl;
 
-          cout << "Step 1. Extracting raw data" << endl;
           /// use some simple format as intermediate file
-          string tmpFile = SysTools::ChangeExt(strOutFile,"nrrd");
+          const string tmpName =
+            SysTools::GetFilename(SysTools::ChangeExt(strOutFile,"nrrd"));
+          const uint64_t raw = TempSpacePlanner::RawSize(strInFile);
+          const string rawDir = scratch.Reserve("Raw data extraction", raw,
+                                                tmpName);
+          const string tempDir = rawDir.empty() ? "" : scratch.Reserve(
+            "UVF conversion", TempSpacePlanner::EstimateConversion(raw)
+          );
+          if (tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+          const string tmpFile = rawDir + tmpName;
 
-          // HACK: use the output file's dir as temp dir
-          if (ioMan.ConvertDataset(strInFile, tmpFile,
-                                   SysTools::GetPath(tmpFile), true,
-                                   bricksize, brickoverlap)) {
-            cout << endl << "Success." << endl << endl;
+          cout << "Step 1. Extracting raw data" << endl;
+          if (journal.IsStageDone("extract") &&
+              SysTools::FileExists(tmpFile)) {
+            cout << endl << "Already extracted by the interrupted run."
+                 << endl << endl;
           } else {
-            cout << endl << "Extraction failed!" << endl << endl;
-            return EXIT_FAILURE_TO_RAW;
+            journal.BeginStage("extract");
+            progress_phase("extract", raw);
+            if (ioMan.ConvertDataset(strInFile, tmpFile, tempDir, true,
+                                     bricksize, brickoverlap)) {
+              journal.EndStage("extract");
+              cout << endl << "Success." << endl << endl;
+            } else {
+              journal.AbortStage("extract");
+              cout << endl << "Extraction failed!" << endl << endl;
+              return EXIT_FAILURE_TO_RAW;
+            }
           }
 
           cout << "Step 2. Writing new UVF file" << endl;
-          // HACK: use the output file's dir as temp dir
-          if (ioMan.ConvertDataset(tmpFile, strOutFile,
-                                   SysTools::GetPath(strOutFile), true,
+          journal.BeginStage("uvf");
+          progress_phase("uvf", raw);
+          if (ioMan.ConvertDataset(tmpFile, strOutFile, tempDir, true,
                                    bricksize, brickoverlap)) {
+            journal.Finish();
             if(std::remove(tmpFile.c_str()) == -1) {
              cout << endl << "Conversion succeeded but "
                   << " could not delete tmp file " << tmpFile << "\n\n";
@@ -391,6 +727,7 @@ int main(int argc, const char* argv[])
             }
             return EXIT_SUCCESS;
           } else {
+            journal.AbortStage("uvf");
             if(std::remove(tmpFile.c_str()) == -1) {
              cout << "\nUVF write failed and could not delete tmp file "
                   << tmpFile << "\n\n";
@@ -402,13 +739,21 @@ int main(int argc, const char* argv[])
         } else {
           cout << endl << "Running in volume file mode.\nConverting "
                << strInFile << " to " << strOutFile << "\n\n";
-          // HACK: use the output file's dir as temp dir
-          if (ioMan.ConvertDataset(strInFile, strOutFile,
-                                   SysTools::GetPath(strOutFile), true,
+          const uint64_t raw = TempSpacePlanner::RawSize(strInFile);
+          const string tempDir = scratch.Reserve(
+            "Conversion", TempSpacePlanner::EstimateConversion(raw)
+          );
+          if (tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+          resume_starts_over(journal, "The conversion");
+          journal.BeginStage("uvf");
+          progress_phase("uvf", raw);
+          if (ioMan.ConvertDataset(strInFile, strOutFile, tempDir, true,
                                    bricksize, brickoverlap)) {
+            journal.Finish();
             cout << "\nSuccess.\n\n";
             return EXIT_SUCCESS;
           } else {
+            journal.AbortStage("uvf");
             cout << "\nConversion failed!\n\n";
             return EXIT_FAILURE_GENERAL;
           }
@@ -420,16 +765,54 @@ int main(int argc, const char* argv[])
           cout << "\nRunning in geometry file mode.\n"
                << "Converting " << strInFile
                << " (" << sourceConv->GetDesc() << ") to "
-               << strOutFile << " (" << targetConv->GetDesc() << ")\n";
+               << strOutFile << " ("
+               << (targetConv ? targetConv->GetDesc() : targetType) << ")\n";
+
+          // ASCII OBJ and PLY are parsed on all cores and STL and PLY are
+          // written without building a tuvok::Mesh; anything else, or
+          // anything the fast paths reject, goes through the converters.
+          progress_phase("geometry");
+          MeshData mesh;
           std::shared_ptr<Mesh> m;
-          try {
-            m = sourceConv->ConvertToMesh(strInFile);
-          } catch (const tuvok::io::DSOpenFailed& err) {
-            cerr << "Error trying to open the input mesh "
-                 << "(" << err.what() << ")\n";
-            return EXIT_FAILURE_IN_MESH_LOAD;
+          bool haveMeshData = CanParseMesh(strInFile) &&
+                              ParseMesh(strInFile, mesh);
+          if (!haveMeshData) {
+            try {
+              m = sourceConv->ConvertToMesh(strInFile);
+            } catch (const tuvok::io::DSOpenFailed& err) {
+              cerr << "Error trying to open the input mesh "
+                   << "(" << err.what() << ")\n";
+              return EXIT_FAILURE_IN_MESH_LOAD;
+            }
+            if (!m) {
+              cerr << "Error trying to open the input mesh\n";
+              return EXIT_FAILURE_IN_MESH_LOAD;
+            }
+            if ((dedup || CanWriteMesh(strOutFile)) &&
+                FromTuvokMesh(*m, mesh)) {
+              haveMeshData = true;
+              m.reset();
+            }
+          }
+          if (dedup) {
+            if (haveMeshData) {
+              WeldVertices(mesh);
+            } else {
+              cerr << "warning: only triangle meshes can be deduplicated\n";
+            }
           }
-          if (!targetConv->ConvertToNative(*m,strOutFile)) {
+
+          bool written;
+          if (haveMeshData && CanWriteMesh(strOutFile)) {
+            written = WriteMesh(mesh, strOutFile);
+          } else {
+            if (haveMeshData) {
+              m = ToTuvokMesh(mesh, sourceConv->GetDesc() + " data converted "
+                                    "from " + SysTools::GetFilename(strInFile));
+            }
+            written = targetConv && targetConv->ConvertToNative(*m,strOutFile);
+          }
+          if (!written) {
             cerr << "Error writing target mesh\n";
             return EXIT_FAILURE_OUT_MESH_WRITE;
           }
@@ -467,12 +850,29 @@ int main(int argc, const char* argv[])
       }
       cout << " to " << strOutFile << "\n\n";
 
-      // HACK: use the output file's dir as temp dir
+      // every input is converted to raw first, then the merged result is
+      // bricked.
+      uint64_t rawTotal = 0, rawMax = 0;
+      for (size_t i = 0;i<vDataSets.size();i++) {
+        const uint64_t raw = TempSpacePlanner::RawSize(vDataSets[i]);
+        rawTotal += raw;
+        rawMax = std::max(rawMax, raw);
+      }
+      const string tempDir = scratch.Reserve(
+        "Merge", rawTotal + TempSpacePlanner::EstimateConversion(rawMax)
+      );
+      if (tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+
+      resume_starts_over(journal, "Merging");
+      journal.BeginStage("merge");
+      progress_phase("merge", rawTotal);
       if (ioMan.MergeDatasets(vDataSets, vScales, vBiases, strOutFile,
-                              SysTools::GetPath(strOutFile))) {
+                              tempDir)) {
+        journal.Finish();
         cout << "\nSuccess.\n\n";
         return EXIT_SUCCESS;
       } else {
+        journal.AbortStage("merge");
         cout << "\nMerging datasets failed!\n\n";
         return EXIT_FAILURE_MERGE;
       }
@@ -510,18 +910,92 @@ int main(int argc, const char* argv[])
       }
     }
 
+    // stacks are converted one after the other, and none can be larger than
+    // the whole directory.  Up to two of them are held as flat raw files:
+    // the one being bricked and the next one, which is read meanwhile.
+    uint64_t maxStackRaw = 0;
+    for (size_t i = 0;i<dirinfo.size();i++) {
+      if (CanIngestStack(*dirinfo[i])) {
+        maxStackRaw = std::max(maxStackRaw, StackRawSize(*dirinfo[i]));
+      }
+    }
+    const string tempDir = scratch.Reserve(
+      "Directory conversion", TempSpacePlanner::EstimateConversion(
+        TempSpacePlanner::DirectorySize(strInDir)) + 2*maxStackRaw
+    );
+    if (tempDir.empty()) { return EXIT_FAILURE_TEMPSPACE; }
+
+    const string flatBase = tempDir +
+      SysTools::GetFilename(SysTools::RemoveExt(strOutFile)) + ".stack";
+    auto stackStage = [](size_t i) { return "stack" + SysTools::ToString(i); };
+    auto flatFile = [&flatBase](size_t i) {
+      return flatBase + SysTools::ToString(i) + ".nhdr";
+    };
+    auto removeFlat = [&flatFile](size_t i) {
+      std::remove(flatFile(i).c_str());
+      std::remove(SysTools::ChangeExt(flatFile(i), "raw").c_str());
+    };
+    // Stacks which IngestStack can read are flattened by its reader pool
+    // in the background, one stack ahead of the bricking.  The bricker needs
+    // the complete file, so the first stack is waited for: a directory with
+    // a single stack gets the parallel reads, but no overlap.
+    std::future<bool> prefetch;
+    size_t prefetched = dirinfo.size();
+    auto startPrefetch = [&](size_t from) {
+      for (size_t j = from;j<dirinfo.size();j++) {
+        if (journal.IsStageDone(stackStage(j)) &&
+            SysTools::FileExists(vStrFilenames[j])) continue;
+        if (!CanIngestStack(*dirinfo[j])) continue;
+        const FileStackInfo* stack = &*dirinfo[j];
+        const string nhdr = flatFile(j);
+        prefetch = std::async(std::launch::async, [stack, nhdr]() {
+          return IngestStack(*stack, nhdr);
+        });
+        prefetched = j;
+        return;
+      }
+    };
+    startPrefetch(0);
+
     int iFailCount = 0;
     for (size_t i = 0;i<dirinfo.size();i++) {
-      if (ioMan.ConvertDataset(&*dirinfo[i], vStrFilenames[i],
-                               SysTools::GetPath(vStrFilenames[i]),
-                               bricksize, brickoverlap, false)) {
+      const std::string stage = stackStage(i);
+      if (journal.IsStageDone(stage) &&
+          SysTools::FileExists(vStrFilenames[i])) {
+        cout << "\n" << vStrFilenames[i]
+             << " was completed by the interrupted run.\n\n";
+        continue;
+      }
+      journal.BeginStage(stage);
+      progress_phase(stage);
+      // a stack which could not be flattened is left to IOManager, which
+      // may still know how to read it.
+      const bool bFlat = prefetched == i && prefetch.get();
+      if (!prefetch.valid()) startPrefetch(i+1);
+      bool bOK;
+      if (bFlat) {
+        bOK = ioMan.ConvertDataset(flatFile(i), vStrFilenames[i], tempDir,
+                                   true, bricksize, brickoverlap);
+        removeFlat(i);
+      } else {
+        bOK = ioMan.ConvertDataset(&*dirinfo[i], vStrFilenames[i], tempDir,
+                                   bricksize, brickoverlap, false);
+      }
+      if (bOK) {
+        journal.EndStage(stage);
         cout << "\nSuccess.\n\n";
       } else {
+        journal.AbortStage(stage);
         cout << "\nConversion failed!\n\n";
         iFailCount++;
+        if (prefetch.valid()) {
+          prefetch.wait();
+          removeFlat(prefetched);
+        }
         return EXIT_FAILURE_GENERAL_DIR;
       }
     }
+    journal.Finish();
 
     if (iFailCount != 0)  {
       cout << endl << iFailCount << " out of " << dirinfo.size()
@@ -532,14 +1006,40 @@ int main(int argc, const char* argv[])
   }
 }
 
+int main(int argc, const char* argv[])
+{
+  const int status = convert(argc, argv);
+  // only conversions which got as far as setting up the budget report it.
+  if(MemoryAccountant::Instance().GetBudget() != 0) {
+    MemoryAccountant::Instance().Report();
+  }
+  if(progressOut) { progressOut->Done(status); }
+  return status;
+}
+
 static int
-export_data(const IOManager& iom, const std::string in, const std::string out)
+export_data(const IOManager& iom, const std::string in, const std::string out,
+            const std::string tempDir, uint64_t lod)
 {
   assert(iom.NeedsConversion(in) == false);
-  tuvok::Dataset* ds = iom.CreateDataset(in, 256, false);
+  // the dataset is only read brick by brick, so ask for the bricks the file
+  // already has instead of a size which would make Tuvok rebrick.
+  uint64_t bricksize = 256;
+  try {
+    bricksize = UVFBrickSource(in).GetMaxBrickSize().maxVal();
+  } catch(const std::exception& e) {
+    T_ERROR("%s", e.what());
+    return EXIT_FAILURE_GENERAL;
+  }
+  tuvok::Dataset* ds = iom.CreateDataset(in, bricksize, false);
   const tuvok::UVFDataset* uvf = dynamic_cast<tuvok::UVFDataset*>(ds);
-  // use the output file's dir as temp dir
-  if(!iom.ExportDataset(uvf, 0, out, SysTools::GetPath(out))) {
+  if(!uvf || lod >= uvf->GetLODLevelCount()) {
+    T_ERROR("'%s' has no level of detail %llu", in.c_str(),
+            static_cast<unsigned long long>(lod));
+    delete ds;
+    return EXIT_FAILURE_GENERAL;
+  }
+  if(!iom.ExportDataset(uvf, lod, out, tempDir)) {
     return EXIT_FAILURE_GENERAL;
   }
   return EXIT_SUCCESS;
@@ -0,0 +1,7 @@
+# Code shared by several of the programs; include it from their project
+# files.
+HEADERS += $$PWD/JPEGSliceDecoder.h \
+           $$PWD/ShaderBinaryCache.h
+
+SOURCES += $$PWD/JPEGSliceDecoder.cpp \
+           $$PWD/ShaderBinaryCache.cpp
@@ -0,0 +1,198 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    JPEGSliceDecoder.cpp
+  \brief   Reusable decoders for the JPEG-encoded slices of DICOM stacks.
+*/
+
+#include <csetjmp>
+#include <cstdio>
+#include <fstream>
+
+#include "JPEGSliceDecoder.h"
+
+extern "C" {
+#include "../Tuvok/IO/3rdParty/jpeglib/jpeglib.h"
+}
+
+namespace {
+  // where error_exit jumps back to, with libjpeg's message.
+  struct DecodeError {
+    jmp_buf env;
+    char message[JMSG_LENGTH_MAX];
+  };
+
+  // libjpeg must not exit the process on corrupt data.
+  void error_exit(j_common_ptr cinfo) {
+    DecodeError* error = static_cast<DecodeError*>(cinfo->client_data);
+    (*cinfo->err->format_message)(cinfo, error->message);
+    std::longjmp(error->env, 1);
+  }
+  // corrupt-data warnings would be printed to stderr otherwise.
+  void output_message(j_common_ptr) {}
+
+  // the whole stream is in memory, so there is nothing to fetch.
+  void init_source(j_decompress_ptr) {}
+  void term_source(j_decompress_ptr) {}
+  boolean fill_input_buffer(j_decompress_ptr cinfo) {
+    // a truncated stream is ended with a fake EOI marker, as libjpeg's own
+    // sources do.
+    static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+    cinfo->src->next_input_byte = eoi;
+    cinfo->src->bytes_in_buffer = 2;
+    return TRUE;
+  }
+  void skip_input_data(j_decompress_ptr cinfo, long count) {
+    if(count <= 0) { return; }
+    if(size_t(count) > cinfo->src->bytes_in_buffer) {
+      fill_input_buffer(cinfo);
+      return;
+    }
+    cinfo->src->next_input_byte += count;
+    cinfo->src->bytes_in_buffer -= size_t(count);
+  }
+}
+
+struct JPEGSliceDecoder::Context {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr jerr;
+  jpeg_source_mgr src;
+  DecodeError error;
+};
+
+JPEGSliceDecoder::JPEGSliceDecoder() :
+  m_ctx(new Context),
+  m_width(0), m_height(0), m_components(0)
+{
+  Context& c = *m_ctx;
+  c.cinfo.err = jpeg_std_error(&c.jerr);
+  c.jerr.error_exit = error_exit;
+  c.jerr.output_message = output_message;
+  jpeg_create_decompress(&c.cinfo);
+  c.cinfo.client_data = &c.error;
+  c.src.init_source = init_source;
+  c.src.fill_input_buffer = fill_input_buffer;
+  c.src.skip_input_data = skip_input_data;
+  c.src.resync_to_restart = jpeg_resync_to_restart;
+  c.src.term_source = term_source;
+  c.src.next_input_byte = NULL;
+  c.src.bytes_in_buffer = 0;
+  c.cinfo.src = &c.src;
+}
+
+JPEGSliceDecoder::~JPEGSliceDecoder()
+{
+  jpeg_destroy_decompress(&m_ctx->cinfo);
+}
+
+bool JPEGSliceDecoder::Decode(const std::string& filename, uint64_t offset,
+                              char* out, size_t bytes)
+{
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary |
+                                     std::ios::ate);
+  const std::streamoff end = in.is_open() ? std::streamoff(in.tellg()) : 0;
+  if(end <= std::streamoff(offset)) {
+    m_error = "could not read " + filename;
+    m_width = m_height = m_components = 0;
+    return false;
+  }
+  // the buffer keeps its capacity, so a stack of equally sized slices
+  // allocates it once.
+  m_input.resize(size_t(end - std::streamoff(offset)));
+  in.seekg(std::streamoff(offset));
+  in.read(reinterpret_cast<char*>(m_input.data()),
+          std::streamsize(m_input.size()));
+  if(!in) {
+    m_error = "could not read " + filename;
+    m_width = m_height = m_components = 0;
+    return false;
+  }
+  return Decode(m_input.data(), m_input.size(), out, bytes);
+}
+
+bool JPEGSliceDecoder::Decode(const unsigned char* data, size_t size,
+                              char* out, size_t bytes)
+{
+  Context& c = *m_ctx;
+  m_width = m_height = m_components = 0;
+  // no objects with destructors may live between here and the longjmp.
+  if(setjmp(c.error.env)) {
+    jpeg_abort_decompress(&c.cinfo);
+    m_error = c.error.message;
+    m_width = m_height = m_components = 0;
+    return false;
+  }
+  c.src.next_input_byte = data;
+  c.src.bytes_in_buffer = size;
+  jpeg_read_header(&c.cinfo, TRUE);
+  jpeg_start_decompress(&c.cinfo);
+
+  const size_t row = size_t(c.cinfo.output_width) *
+                     size_t(c.cinfo.output_components);
+  if(row * size_t(c.cinfo.output_height) != bytes) {
+    jpeg_abort_decompress(&c.cinfo);
+    m_error = "unexpected image size";
+    return false;
+  }
+  // scanlines are decoded straight into the destination.
+  while(c.cinfo.output_scanline < c.cinfo.output_height) {
+    JSAMPROW line = reinterpret_cast<JSAMPROW>(out +
+                                               row*c.cinfo.output_scanline);
+    jpeg_read_scanlines(&c.cinfo, &line, 1);
+  }
+  m_width = c.cinfo.output_width;
+  m_height = c.cinfo.output_height;
+  m_components = size_t(c.cinfo.output_components);
+  jpeg_finish_decompress(&c.cinfo);
+  return true;
+}
+
+JPEGDecoderPool& JPEGDecoderPool::Shared()
+{
+  static JPEGDecoderPool pool;
+  return pool;
+}
+
+JPEGDecoderPool::Lease::Lease(JPEGDecoderPool& pool) : m_pool(pool)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_pool.m_lock);
+    if(!m_pool.m_idle.empty()) {
+      m_decoder = std::move(m_pool.m_idle.back());
+      m_pool.m_idle.pop_back();
+    }
+  }
+  if(!m_decoder) { m_decoder.reset(new JPEGSliceDecoder); }
+}
+
+JPEGDecoderPool::Lease::~Lease()
+{
+  std::lock_guard<std::mutex> lock(m_pool.m_lock);
+  m_pool.m_idle.push_back(std::move(m_decoder));
+}
@@ -0,0 +1,108 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    JPEGSliceDecoder.h
+  \brief   Reusable decoders for the JPEG-encoded slices of DICOM stacks.
+*/
+
+#pragma once
+
+#ifndef JPEGSLICEDECODER_H
+#define JPEGSLICEDECODER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../Tuvok/StdTuvokDefines.h"
+
+/// Decodes JPEG streams straight into caller-provided memory.  Unlike
+/// tuvok::JPEG, the libjpeg decompressor and the buffer the compressed
+/// stream is read into are set up once and reused for every slice, and no
+/// intermediate copy of the decoded image is made.  A decoder is not
+/// thread-safe; every thread uses its own, see JPEGDecoderPool.
+class JPEGSliceDecoder {
+public:
+  JPEGSliceDecoder();
+  ~JPEGSliceDecoder();
+
+  /// Decodes the stream starting at 'offset' in 'filename' (the pixel data
+  /// of a DICOM) into 'out', which must hold exactly 'bytes', the size of
+  /// the decoded image.  False on errors or if the size does not match.
+  bool Decode(const std::string& filename, uint64_t offset, char* out,
+              size_t bytes);
+  /// decodes a stream which is in memory already.
+  bool Decode(const unsigned char* data, size_t size, char* out,
+              size_t bytes);
+  /// size of the image decoded last; 0 after an error.
+  size_t GetWidth() const { return m_width; }
+  size_t GetHeight() const { return m_height; }
+  size_t GetComponents() const { return m_components; }
+  /// libjpeg's message for the last failed decode.
+  const std::string& GetError() const { return m_error; }
+
+private:
+  JPEGSliceDecoder(const JPEGSliceDecoder&);
+  JPEGSliceDecoder& operator=(const JPEGSliceDecoder&);
+
+  struct Context;
+  std::unique_ptr<Context> m_ctx;
+  std::vector<unsigned char> m_input;
+  size_t m_width, m_height, m_components;
+  std::string m_error;
+};
+
+/// Hands out idle decoders so they are created once per thread that needs
+/// one, not once per slice.
+class JPEGDecoderPool {
+public:
+  /// the pool shared by previews and conversions.
+  static JPEGDecoderPool& Shared();
+
+  /// A decoder for as long as the lease lives.
+  class Lease {
+  public:
+    explicit Lease(JPEGDecoderPool& pool=JPEGDecoderPool::Shared());
+    ~Lease();
+    JPEGSliceDecoder& operator*() const { return *m_decoder; }
+    JPEGSliceDecoder* operator->() const { return m_decoder.get(); }
+  private:
+    Lease(const Lease&);
+    Lease& operator=(const Lease&);
+    JPEGDecoderPool& m_pool;
+    std::unique_ptr<JPEGSliceDecoder> m_decoder;
+  };
+
+private:
+  std::mutex m_lock;
+  std::vector<std::unique_ptr<JPEGSliceDecoder>> m_idle;
+};
+
+#endif // JPEGSLICEDECODER_H
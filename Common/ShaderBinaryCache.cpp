@@ -0,0 +1,342 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    ShaderBinaryCache.cpp
+  \brief   Keeps linked GLSL programs on disk between runs.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef DETECTED_OS_WINDOWS
+# include <direct.h>
+# include <process.h>
+#else
+# include <unistd.h>
+#endif
+
+#include "../Tuvok/3rdParty/GLEW/GL/glew.h"
+#include "ShaderBinaryCache.h"
+#include "../Tuvok/Controller/Controller.h"
+
+namespace tuvok
+{
+
+namespace {
+  const char magic[8] = {'I','V','3','D','P','R','G','1'};
+
+  struct Cache {
+    std::string directory;
+    std::string driver;     ///< vendor, renderer and versions
+    /// glBindAttribLocation and glBindFragDataLocation calls per program;
+    /// they take effect at the next link and so are part of its key.
+    std::map<GLuint, std::string> bindings;
+
+    PFNGLLINKPROGRAMPROC link;
+    PFNGLBINDATTRIBLOCATIONPROC bindAttrib;
+    PFNGLBINDFRAGDATALOCATIONPROC bindFragData;
+    PFNGLDELETEPROGRAMPROC deleteProgram;
+
+    uint32_t loaded;
+    uint32_t linked;
+    uint32_t stored;
+    uint32_t rejected;
+  };
+  Cache* cache = NULL;
+
+  std::string gl_string(GLenum name) {
+    const GLubyte* s = glGetString(name);
+    return s ? reinterpret_cast<const char*>(s) : "";
+  }
+
+  // 64 bit FNV-1a; only names the file, the key itself is compared too.
+  std::string hash(const std::string& key) {
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i=0; i < key.size(); ++i) {
+      h ^= static_cast<unsigned char>(key[i]);
+      h *= 1099511628211ULL;
+    }
+    char hex[17];
+    for(int i=15; i >= 0; --i, h >>= 4) {
+      hex[i] = "0123456789abcdef"[h & 0xf];
+    }
+    hex[16] = 0;
+    return hex;
+  }
+
+  bool is_directory(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFDIR) != 0;
+  }
+
+  bool make_directory(const std::string& dir) {
+    for(size_t i=1; i <= dir.size(); ++i) {
+      if(i < dir.size() && dir[i] != '/' && dir[i] != '\\') { continue; }
+      const std::string parent = dir.substr(0, i);
+      if(is_directory(parent)) { continue; }
+#ifdef DETECTED_OS_WINDOWS
+      _mkdir(parent.c_str());
+#else
+      mkdir(parent.c_str(), 0755);
+#endif
+    }
+    return is_directory(dir);
+  }
+
+  // Everything the result of linking 'program' depends on, or an empty
+  // string if it has no shaders.
+  std::string program_key(GLuint program) {
+    GLint count = 0;
+    glGetProgramiv(program, GL_ATTACHED_SHADERS, &count);
+    if(count <= 0) { return std::string(); }
+    std::vector<GLuint> shaders(count);
+    glGetAttachedShaders(program, count, &count, &shaders[0]);
+
+    // the order shaders are attached in does not matter to the linker
+    std::vector<std::string> sources;
+    for(GLint i=0; i < count; ++i) {
+      GLint type = 0, length = 0;
+      glGetShaderiv(shaders[i], GL_SHADER_TYPE, &type);
+      glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length);
+      std::vector<GLchar> source(std::max(length, 1));
+      glGetShaderSource(shaders[i], GLsizei(source.size()), NULL, &source[0]);
+      std::ostringstream s;
+      s << "shader " << type << " " << length << "\n" << &source[0] << "\n";
+      sources.push_back(s.str());
+    }
+    std::sort(sources.begin(), sources.end());
+
+    std::string key = cache->driver;
+    for(size_t i=0; i < sources.size(); ++i) { key += sources[i]; }
+    std::map<GLuint, std::string>::const_iterator b =
+      cache->bindings.find(program);
+    if(b != cache->bindings.end()) { key += b->second; }
+    return key;
+  }
+
+  // Loads the cached binary for 'key' into 'program'; false if there is none
+  // or the driver does not take it.
+  bool load(GLuint program, const std::string& key, const std::string& file) {
+    std::ifstream in(file.c_str(), std::ios::binary);
+    if(!in) { return false; }
+    char m[sizeof(magic)];
+    uint32_t format = 0, keyLength = 0, length = 0;
+    in.read(m, sizeof(m));
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    in.read(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
+    in.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if(!in || memcmp(m, magic, sizeof(magic)) != 0 ||
+       keyLength != key.size() || length == 0) {
+      return false;
+    }
+    std::vector<char> data(keyLength + length);
+    in.read(&data[0], data.size());
+    if(!in || key.compare(0, keyLength, &data[0], keyLength) != 0) {
+      return false;  // another key with the same hash
+    }
+    in.close();
+
+    glProgramBinary(program, GLenum(format), &data[keyLength], GLsizei(length));
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(status != GL_TRUE) {
+      glGetError();  // GL_INVALID_ENUM for formats the driver dropped
+      WARNING("The driver rejected the cached program binary %s; "
+              "linking the program again.", file.c_str());
+      std::remove(file.c_str());
+      ++cache->rejected;
+      return false;
+    }
+    ++cache->loaded;
+    return true;
+  }
+
+  void store(GLuint program, const std::string& key, const std::string& file)
+  {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) { return; }
+    std::vector<char> data(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, &data[0]);
+    if(length <= 0) { return; }
+
+    // write a file of our own and rename it into place, so processes which
+    // share the directory never read half a binary.
+    std::ostringstream tmp;
+#ifdef DETECTED_OS_WINDOWS
+    tmp << file << "." << _getpid() << ".tmp";
+#else
+    tmp << file << "." << getpid() << ".tmp";
+#endif
+    const uint32_t header[3] = {
+      uint32_t(format), uint32_t(key.size()), uint32_t(length)
+    };
+    {
+      std::ofstream out(tmp.str().c_str(), std::ios::binary);
+      out.write(magic, sizeof(magic));
+      out.write(reinterpret_cast<const char*>(header), sizeof(header));
+      out.write(key.data(), key.size());
+      out.write(&data[0], length);
+      if(!out) {
+        out.close();
+        std::remove(tmp.str().c_str());
+        return;
+      }
+    }
+    if(std::rename(tmp.str().c_str(), file.c_str()) != 0) {
+      std::remove(tmp.str().c_str());  // Windows does not replace files
+      return;
+    }
+    ++cache->stored;
+  }
+
+  void GLAPIENTRY link_program(GLuint program) {
+    const std::string key = program_key(program);
+    if(key.empty()) {
+      cache->link(program);
+      return;
+    }
+    const std::string file = cache->directory + "/" + hash(key) + ".bin";
+    if(load(program, key, file)) { return; }
+
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    cache->link(program);
+    ++cache->linked;
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(status == GL_TRUE) { store(program, key, file); }
+  }
+
+  void GLAPIENTRY bind_attrib(GLuint program, GLuint index,
+                              const GLchar* name) {
+    std::ostringstream s;
+    s << "attrib " << index << " " << name << "\n";
+    cache->bindings[program] += s.str();
+    cache->bindAttrib(program, index, name);
+  }
+
+  void GLAPIENTRY bind_frag_data(GLuint program, GLuint color,
+                                 const GLchar* name) {
+    std::ostringstream s;
+    s << "fragdata " << color << " " << name << "\n";
+    cache->bindings[program] += s.str();
+    cache->bindFragData(program, color, name);
+  }
+
+  void GLAPIENTRY delete_program(GLuint program) {
+    cache->bindings.erase(program);
+    cache->deleteProgram(program);
+  }
+}
+
+namespace ShaderBinaryCache
+{
+
+bool Install(const std::string& directory)
+{
+  if(cache) { return true; }
+  if(!(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) ||
+     !__glewLinkProgram || !__glewBindAttribLocation ||
+     !__glewDeleteProgram) {
+    MESSAGE("Program binaries are not supported, shaders are not cached.");
+    return false;
+  }
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if(formats <= 0) {
+    MESSAGE("The driver has no program binary formats, shaders are not "
+            "cached.");
+    return false;
+  }
+  if(directory.empty() || !make_directory(directory)) {
+    WARNING("Could not create the shader cache directory '%s'.",
+            directory.c_str());
+    return false;
+  }
+
+  cache = new Cache();
+  cache->directory = directory;
+  cache->driver = gl_string(GL_VENDOR) + "\n" + gl_string(GL_RENDERER) +
+                  "\n" + gl_string(GL_VERSION) + "\n" +
+                  gl_string(GL_SHADING_LANGUAGE_VERSION) + "\n";
+  cache->link = __glewLinkProgram;
+  cache->bindAttrib = __glewBindAttribLocation;
+  cache->bindFragData = __glewBindFragDataLocation;
+  cache->deleteProgram = __glewDeleteProgram;
+  cache->loaded = cache->linked = cache->stored = cache->rejected = 0;
+
+  __glewLinkProgram = link_program;
+  __glewBindAttribLocation = bind_attrib;
+  if(__glewBindFragDataLocation) {
+    __glewBindFragDataLocation = bind_frag_data;
+  }
+  __glewDeleteProgram = delete_program;
+  MESSAGE("Caching shader program binaries in '%s'.", directory.c_str());
+  return true;
+}
+
+std::string DefaultDirectory()
+{
+#if defined(DETECTED_OS_WINDOWS)
+  const char* base = getenv("LOCALAPPDATA");
+  return (base && *base) ? std::string(base) + "\\ImageVis3D\\ShaderCache"
+                         : std::string();
+#elif defined(DETECTED_OS_APPLE)
+  const char* home = getenv("HOME");
+  return (home && *home) ? std::string(home) +
+                           "/Library/Caches/ImageVis3D/Shaders"
+                         : std::string();
+#else
+  const char* xdg = getenv("XDG_CACHE_HOME");
+  if(xdg && *xdg) { return std::string(xdg) + "/imagevis3d/shaders"; }
+  const char* home = getenv("HOME");
+  return (home && *home) ? std::string(home) + "/.cache/imagevis3d/shaders"
+                         : std::string();
+#endif
+}
+
+void LogStatistics()
+{
+  if(!cache) { return; }
+  MESSAGE("Shader cache: %u programs loaded, %u linked (%u stored), "
+          "%u binaries rejected by the driver.", cache->loaded,
+          cache->linked, cache->stored, cache->rejected);
+}
+
+}
+
+}
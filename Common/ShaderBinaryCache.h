@@ -0,0 +1,76 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    ShaderBinaryCache.h
+  \brief   Keeps linked GLSL programs on disk between runs.
+*/
+
+#pragma once
+
+#ifndef SHADERBINARYCACHE_H
+#define SHADERBINARYCACHE_H
+
+#include <string>
+
+#include "../Tuvok/StdTuvokDefines.h"
+
+namespace tuvok
+{
+
+/// Caches the binaries of linked GLSL programs (GL_ARB_get_program_binary)
+/// in a directory, so later runs on the same driver skip most of the work of
+/// building Tuvok's shaders.  The cache sits below Tuvok: Install replaces
+/// GLEW's glLinkProgram entry point, and a program whose attached shader
+/// sources, attribute and fragment data bindings, GL vendor, renderer and
+/// version match a cached one is loaded with glProgramBinary instead of
+/// being linked.  Binaries the driver rejects are removed and the program
+/// is linked as usual, which also stores the new binary.  Shaders are still
+/// compiled; drivers do most of their work when linking.
+///
+/// Install needs a current context, after glewInit.  Several processes may
+/// share a directory.  Like GLEW itself this is for the thread(s) using
+/// that context; it is not synchronized.
+namespace ShaderBinaryCache
+{
+  /// Starts caching in 'directory', which is created if necessary.  Returns
+  /// false, and leaves GL alone, if the driver cannot return binaries.
+  bool Install(const std::string& directory);
+
+  /// The per-user cache directory, e.g. ~/.cache/imagevis3d/shaders;
+  /// empty if there is none.
+  std::string DefaultDirectory();
+
+  /// Logs how many programs were loaded from the cache, linked and stored,
+  /// and rejected by the driver.
+  void LogStatistics();
+}
+
+}
+
+#endif // SHADERBINARYCACHE_H
@@ -108,6 +108,7 @@ HEADERS += StdDefines.h \
            UI/Q2DTransferFunction.h \
            UI/QDataRadioButton.h \
            UI/QLightPreview.h \
+           UI/LuaBoundCall.h \
            UI/RenderWindow.h \
            UI/RenderWindowGL.h \
            UI/RAWDialog.h \
@@ -198,3 +199,5 @@ win32 {
   HEADERS += UI/RenderWindowDX.h
   SOURCES += UI/RenderWindowDX.cpp
 }
+
+include(../Common/Common.pri)
@@ -487,12 +487,25 @@ void MainWindow::SetIsoValue(float fValue) {
 // UI command to update isovalue.
 void MainWindow::SetIsoValue(int iValue) {
   if (m_pActiveRenderWin != NULL) {
+    // While the slider is dragged, only the final value is recorded, see
+    // FinalizeIsoValue.
+    shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
+    const bool bDragging = horizontalSlider_Isovalue->isSliderDown();
+    if (bDragging) ss->setTempProvDisable(true);
     m_pActiveRenderWin->SetIsoValue(float(iValue));
+    if (bDragging) ss->setTempProvDisable(false);
     int iMaxSize = int(m_pActiveRenderWin->GetDynamicRange().second);
     UpdateIsoValLabel(iValue, iMaxSize);
   }
 }
 
+// Records the isovalue the slider was dragged to.
+void MainWindow::FinalizeIsoValue() {
+  if (m_pActiveRenderWin != NULL) {
+    m_pActiveRenderWin->SetIsoValue(float(horizontalSlider_Isovalue->value()));
+  }
+}
+
 // Script command to update focus isovalue
 void MainWindow::SetClearViewIsoValue(float fValue) {
   if (m_pActiveRenderWin != NULL) {
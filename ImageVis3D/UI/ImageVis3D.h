@@ -256,6 +256,7 @@ class MainWindow : public QMainWindow, protected Ui_MainWindow
     void SetFoVSlider(int iValue);
     void SetIsoValue(float fValue);
     void SetIsoValue(int iValue);
+    void FinalizeIsoValue();
     void SetClearViewIsoValue(float fValue);
     void ToggleGlobalBBox(bool bRenderBBox);
     void ToggleLocalBBox(bool bRenderBBox);
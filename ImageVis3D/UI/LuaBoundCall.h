@@ -0,0 +1,202 @@
+/*
+   For more information, please see: http://software.sci.utah.edu
+
+   The MIT License
+
+   Copyright (c) 2015 Scientific Computing and Imaging Institute,
+   University of Utah.
+
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+   THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+   FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+   DEALINGS IN THE SOFTWARE.
+*/
+
+/**
+  \file    LuaBoundCall.h
+  \brief   A registered Lua function resolved once and called many times.
+*/
+
+#ifndef IMAGEVIS3D_LUABOUNDCALL_H
+#define IMAGEVIS3D_LUABOUNDCALL_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Tuvok/LuaScripting/LuaScripting.h"
+
+namespace detail {
+  // puts the Lua stack back however the call ends.
+  struct LuaStackRestore {
+    LuaStackRestore(lua_State* L) : L(L), top(lua_gettop(L)) {}
+    ~LuaStackRestore() { lua_settop(L, top); }
+    lua_State* L;
+    int top;
+  };
+
+  // what differs between calls with and without a return value.
+  template<typename R> struct LuaBoundResult {
+    enum { count = 1 };
+    static R get(lua_State* L) {
+      return tuvok::LuaStrictStack<R>::get(L, -1);
+    }
+    template<typename... Args>
+    static R cexec(tuvok::LuaScripting& ss, const std::string& name,
+                   Args... args) {
+      return ss.cexecRet<R>(name, args...);
+    }
+  };
+  template<> struct LuaBoundResult<void> {
+    enum { count = 0 };
+    static void get(lua_State*) {}
+    template<typename... Args>
+    static void cexec(tuvok::LuaScripting& ss, const std::string& name,
+                      Args... args) {
+      ss.cexec(name, args...);
+    }
+  };
+}
+
+template<typename Signature> class LuaBoundCall;
+
+/// cexec/cexecRet resolve the function by its name, e.g.
+/// m_LuaAbstrRenderer.fqName() + ".paint", on every call.  A LuaBoundCall
+/// looks the function up once and keeps a reference to it in the Lua
+/// registry, so calls in paint and mouse handlers neither build strings nor
+/// walk the Lua tables:
+///
+///   LuaBoundCall<bool()> paint;
+///   paint.Bind(ss, rn + ".paint");
+///   if (!paint()) ...
+///
+/// The call goes through the same registered function as cexec does, so
+/// provenance and undo/redo see it as before.  Arguments and results are
+/// converted like for cexec, and errors propagate the same way: the call
+/// is not protected, so Lua errors and the exceptions of the function
+/// reach the caller as they would from cexec.  A call which cannot be
+/// bound (the name does not exist (yet)) is passed on to cexec by name.
+/// Functions of class instances must be bound again when the instance is
+/// replaced.  Every call checks that the table holding the function is
+/// still where it was bound, so calling a function of a deleted instance
+/// throws a LuaError just like cexec does.
+template<typename R, typename... Args>
+class LuaBoundCall<R(Args...)>
+{
+public:
+  LuaBoundCall() :
+    m_ref(LUA_NOREF), m_tableRef(LUA_NOREF), m_ownerRef(LUA_NOREF) {}
+  ~LuaBoundCall() { Unbind(); }
+
+  /// Resolves 'name' (a fully qualified function name as for cexec).
+  void Bind(const std::shared_ptr<tuvok::LuaScripting>& ss,
+            const std::string& name) {
+    Unbind();
+    m_ss = ss;
+    m_name = name;
+
+    std::vector<std::string> parts;
+    for (std::string::size_type begin = 0; begin <= name.size();) {
+      std::string::size_type end = name.find('.', begin);
+      if (end == std::string::npos) end = name.size();
+      parts.push_back(name.substr(begin, end - begin));
+      begin = end + 1;
+    }
+
+    lua_State* L = ss->getLuaState();
+    const int top = lua_gettop(L);
+    lua_getglobal(L, parts[0].c_str());
+    for (size_t i = 1; i < parts.size() && lua_istable(L, -1); ++i) {
+      lua_getfield(L, -1, parts[i].c_str());
+    }
+    if (lua_gettop(L) - top == int(parts.size()) && !lua_isnil(L, -1)) {
+      // the function, the table holding it and that table's owner (the
+      // globals if the table is one).
+      m_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+      if (parts.size() > 1) {
+        m_tableRef = luaL_ref(L, LUA_REGISTRYINDEX);
+        m_tableKey = parts[parts.size() - 2];
+      }
+      if (parts.size() > 2) {
+        m_ownerRef = luaL_ref(L, LUA_REGISTRYINDEX);
+      }
+    }
+    lua_settop(L, top);
+  }
+
+  void Unbind() {
+    std::shared_ptr<tuvok::LuaScripting> ss = m_ss.lock();
+    if (ss) {
+      lua_State* L = ss->getLuaState();
+      luaL_unref(L, LUA_REGISTRYINDEX, m_ref);
+      luaL_unref(L, LUA_REGISTRYINDEX, m_tableRef);
+      luaL_unref(L, LUA_REGISTRYINDEX, m_ownerRef);
+    }
+    m_ref = m_tableRef = m_ownerRef = LUA_NOREF;
+    m_tableKey.clear();
+  }
+
+  bool IsBound() const { return m_ref != LUA_NOREF; }
+  const std::string& Name() const { return m_name; }
+
+  R operator()(Args... args) const {
+    std::shared_ptr<tuvok::LuaScripting> ss = m_ss.lock();
+    if (!ss) {
+      throw tuvok::LuaError(("Lua function '" + m_name +
+                             "' is not bound").c_str());
+    }
+    if (m_ref == LUA_NOREF) {
+      return detail::LuaBoundResult<R>::cexec(*ss, m_name, args...);
+    }
+
+    lua_State* L = ss->getLuaState();
+    const detail::LuaStackRestore restore(L);
+    if (m_tableRef != LUA_NOREF) {
+      // deleting an instance removes its table from its owner.
+      if (m_ownerRef == LUA_NOREF) {
+        lua_getglobal(L, m_tableKey.c_str());
+      } else {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, m_ownerRef);
+        lua_getfield(L, -1, m_tableKey.c_str());
+      }
+      lua_rawgeti(L, LUA_REGISTRYINDEX, m_tableRef);
+      if (!lua_rawequal(L, -1, -2)) {
+        throw tuvok::LuaError(("Lua function '" + m_name +
+                               "' belongs to a deleted instance").c_str());
+      }
+    }
+    lua_rawgeti(L, LUA_REGISTRYINDEX, m_ref);
+    const int pushed[] = { 0, (tuvok::LuaStrictStack<Args>::push(L, args),
+                               0)... };
+    (void)pushed;
+    lua_call(L, sizeof...(Args), detail::LuaBoundResult<R>::count);
+    return detail::LuaBoundResult<R>::get(L);
+  }
+
+private:
+  LuaBoundCall(const LuaBoundCall&);
+  LuaBoundCall& operator=(const LuaBoundCall&);
+
+  std::weak_ptr<tuvok::LuaScripting> m_ss;
+  std::string m_name;
+  int m_ref;
+  int m_tableRef;
+  int m_ownerRef;
+  std::string m_tableKey;
+};
+
+#endif /* IMAGEVIS3D_LUABOUNDCALL_H */
@@ -77,7 +77,12 @@ Q1DTransferFunction::Q1DTransferFunction(MasterController& masterController, QWi
   m_iLastIndex(-1),
   m_fLastValue(0),
   m_bMouseLeft(false),
-  m_bMouseRight(false)
+  m_bMouseRight(false),
+  m_bDragged(false),
+  m_bStdFunctionDragged(false),
+  m_fStdFunctionPos(0),
+  m_fStdFunctionValue(0),
+  m_bStdFunctionInvert(false)
 {
   SetColor(isEnabled());
 }
@@ -335,10 +340,22 @@ void Q1DTransferFunction::mouseReleaseEvent(QMouseEvent *event) {
   if (event->button() == Qt::LeftButton) m_bMouseLeft = false;
   if (event->button() == Qt::RightButton) m_bMouseRight = false;
 
-  // send message to update the GLtexture
-  if(m_eExecutionMode == ONRELEASE) {
+  // The changes of the drag were not recorded; record the final step
+  // function and the texture upload once, so that the whole drag is undone
+  // in one step.
+  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
+  if (m_bStdFunctionDragged) {
+    ss->beginCommandGroup();
+    SetStdFunction(m_fStdFunctionPos, m_fStdFunctionValue,
+                   m_bStdFunctionInvert);
+    ApplyFunction();
+    ss->endCommandGroup();
+  } else if (m_bDragged || m_eExecutionMode == ONRELEASE) {
+    // send message to update the GLtexture
     ApplyFunction();
   }
+  m_bDragged = false;
+  m_bStdFunctionDragged = false;
 }
 
 void Q1DTransferFunction::mouseMoveEvent(QMouseEvent *event) {
@@ -426,42 +443,57 @@ void Q1DTransferFunction::mouseMoveEvent(QMouseEvent *event) {
       }
     }
 
+    m_bDragged = true;
+
     // redraw this widget
     update();
     // send message to update the GLtexture
-    if( m_eExecutionMode == CONTINUOUS ) ApplyFunction();
+    if( m_eExecutionMode == CONTINUOUS ) {
+      ss->setTempProvDisable(true);
+      ApplyFunction();
+      ss->setTempProvDisable(false);
+    }
   } else {
     if (m_bMouseRight) {
 
       bool bShiftPressed = ( event->modifiers() & Qt::ShiftModifier);
 
       // set "step" function
-      size_t cdataSize = cdata->size();
-      if (m_iPaintMode & PAINT_RED)   
-        ss->cexec(m_trans.fqName() + ".setStdFunction", 
-                  float(iCurrentIndex)/float(cdataSize), fValue, 
-                  0, bShiftPressed);
-      if (m_iPaintMode & PAINT_GREEN)
-        ss->cexec(m_trans.fqName() + ".setStdFunction", 
-                  float(iCurrentIndex)/float(cdataSize), fValue, 
-                  1, bShiftPressed);
-      if (m_iPaintMode & PAINT_BLUE)
-        ss->cexec(m_trans.fqName() + ".setStdFunction", 
-                  float(iCurrentIndex)/float(cdataSize), fValue, 
-                  2, bShiftPressed);
-      if (m_iPaintMode & PAINT_ALPHA)
-        ss->cexec(m_trans.fqName() + ".setStdFunction", 
-                  float(iCurrentIndex)/float(cdataSize), fValue, 
-                  3, bShiftPressed);
+      // Temporarily disable provenance, only the final function is recorded.
+      m_fStdFunctionPos = float(iCurrentIndex)/float(cdata->size());
+      m_fStdFunctionValue = fValue;
+      m_bStdFunctionInvert = bShiftPressed;
+      ss->setTempProvDisable(true);
+      SetStdFunction(m_fStdFunctionPos, m_fStdFunctionValue,
+                     m_bStdFunctionInvert);
+      ss->setTempProvDisable(false);
+      m_bStdFunctionDragged = true;
 
       // redraw this widget
       update();
       // send message to update the GLtexture
-      if( m_eExecutionMode == CONTINUOUS ) ApplyFunction();
+      if( m_eExecutionMode == CONTINUOUS ) {
+        ss->setTempProvDisable(true);
+        ApplyFunction();
+        ss->setTempProvDisable(false);
+      }
     }
   }
 }
 
+void Q1DTransferFunction::SetStdFunction(float fPos, float fValue,
+                                         bool bInvert) {
+  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
+  if (m_iPaintMode & PAINT_RED)
+    ss->cexec(m_trans.fqName() + ".setStdFunction", fPos, fValue, 0, bInvert);
+  if (m_iPaintMode & PAINT_GREEN)
+    ss->cexec(m_trans.fqName() + ".setStdFunction", fPos, fValue, 1, bInvert);
+  if (m_iPaintMode & PAINT_BLUE)
+    ss->cexec(m_trans.fqName() + ".setStdFunction", fPos, fValue, 2, bInvert);
+  if (m_iPaintMode & PAINT_ALPHA)
+    ss->cexec(m_trans.fqName() + ".setStdFunction", fPos, fValue, 3, bInvert);
+}
+
 void Q1DTransferFunction::ApplyFunction() {
   // send message to update the GLtexture
   shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
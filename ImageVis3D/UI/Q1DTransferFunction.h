@@ -128,6 +128,16 @@ private:
   float m_fLastValue;
   bool m_bMouseLeft;
   bool m_bMouseRight;
+  // whether the current drag changed the function; the changes are only
+  // recorded for provenance once the drag ends, see mouseReleaseEvent.
+  bool m_bDragged;
+  // the step function of a right button drag, recorded on release.
+  bool m_bStdFunctionDragged;
+  float m_fStdFunctionPos;
+  float m_fStdFunctionValue;
+  bool m_bStdFunctionInvert;
+
+  void SetStdFunction(float fPos, float fValue, bool bInvert);
 
   // drawing routines
   void DrawCoordinateSystem(QPainter& painter);
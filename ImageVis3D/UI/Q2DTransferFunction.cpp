@@ -75,6 +75,7 @@ Q2DTransferFunction::Q2DTransferFunction(MasterController& masterController, QWi
   m_vMousePressPos(0,0),
   m_bDragging(false),
   m_bDraggingAll(false),
+  m_bSwatchDragged(false),
   m_eDragMode(DRM_NONE),
   m_vZoomWindow(0.0f,0.0f,1.0f,1.0f),
   m_eSimpleDragMode(SDM_NONE),
@@ -83,6 +84,9 @@ Q2DTransferFunction::Q2DTransferFunction(MasterController& masterController, QWi
   SetColor(isEnabled());
 
   setFocusPolicy(Qt::StrongFocus);
+
+  m_changed2DTrans.Bind(m_MasterController.LuaScript(),
+                        "tuvok.gpu.changed2DTrans");
 }
 
 Q2DTransferFunction::~Q2DTransferFunction(void)
@@ -107,8 +111,12 @@ void Q2DTransferFunction::SetData(shared_ptr<const Histogram2D> vHistogram,
   m_trans = tf2d;
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   if (m_trans.isValid(ss) == false) {
+    m_swatchUpdate.Unbind();
+    m_swatchGet.Unbind();
     return;
   }
+  m_swatchUpdate.Bind(ss, m_trans.fqName() + ".swatchUpdate");
+  m_swatchGet.Bind(ss, m_trans.fqName() + ".swatchGet");
 
   // resize the histogram vector
   m_vHistogram.Resize(vHistogram->GetSize());
@@ -799,6 +807,23 @@ void Q2DTransferFunction::mouseReleaseEvent(QMouseEvent *event) {
   // call superclass method
   QWidget::mouseReleaseEvent(event);
 
+  // The swatch updates of the drag were not recorded; record where the
+  // swatch ended up, so that the whole drag is undone in one step.
+  if (m_bSwatchDragged && m_iActiveSwatchIndex >= 0 &&
+      static_cast<size_t>(m_iActiveSwatchIndex) < GetSwatchCount()) {
+    shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
+    shared_ptr<const vector<TFPolygon>> swatches = GetSwatches();
+    ss->beginCommandGroup();
+    m_swatchUpdate(static_cast<size_t>(m_iActiveSwatchIndex),
+                   (*swatches)[m_iActiveSwatchIndex]);
+    ApplyFunction();
+    ss->endCommandGroup();
+  } else if(m_eExecutionMode == ONRELEASE) {
+    // send message to update the GLtexture
+    ApplyFunction();
+  }
+  m_bSwatchDragged = false;
+
   m_bDragging = false;
   m_bDraggingAll = false;
   m_iPointSelIndex = -1;
@@ -807,17 +832,11 @@ void Q2DTransferFunction::mouseReleaseEvent(QMouseEvent *event) {
   m_mouseButton = Qt::NoButton;
 
   update();
-
-  // send message to update the GLtexture
-  if(m_eExecutionMode == ONRELEASE) {
-    ApplyFunction();
-  }
 }
 
 void Q2DTransferFunction::ApplyFunction() {
   // send message to update the GLtexture
-  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
-  ss->cexec("tuvok.gpu.changed2DTrans", LuaClassInstance(), m_trans);
+  m_changed2DTrans(LuaClassInstance(), m_trans);
 }
 
 
@@ -937,8 +956,12 @@ void Q2DTransferFunction::mouseMoveEvent(QMouseEvent *event) {
         }
       }
 
-      ss->cexec(m_trans.fqName() + ".swatchUpdate", 
-                static_cast<size_t>(m_iActiveSwatchIndex), currentSwatch);
+      // Temporarily disable provenance, only the final swatch is recorded.
+      ss->setTempProvDisable(true);
+      m_swatchUpdate(static_cast<size_t>(m_iActiveSwatchIndex),
+                     currentSwatch);
+      ss->setTempProvDisable(false);
+      m_bSwatchDragged = true;
     } else {
       if (m_iActiveSwatchIndex < 0) return;
       shared_ptr<const vector<TFPolygon>> swatches = GetSwatches();
@@ -1067,8 +1090,12 @@ void Q2DTransferFunction::mouseMoveEvent(QMouseEvent *event) {
         } break;
       }
 
-      ss->cexec(m_trans.fqName() + ".swatchUpdate", 
-                static_cast<size_t>(m_iActiveSwatchIndex), currentSwatch);
+      // Temporarily disable provenance, only the final swatch is recorded.
+      ss->setTempProvDisable(true);
+      m_swatchUpdate(static_cast<size_t>(m_iActiveSwatchIndex),
+                     currentSwatch);
+      ss->setTempProvDisable(false);
+      m_bSwatchDragged = true;
     }
 
     m_vMousePressPos = vMouseCurrentPos;
@@ -1076,7 +1103,11 @@ void Q2DTransferFunction::mouseMoveEvent(QMouseEvent *event) {
     update();
 
     // send message to update the GLtexture
-    if( m_eExecutionMode == CONTINUOUS ) ApplyFunction();
+    if( m_eExecutionMode == CONTINUOUS ) {
+      ss->setTempProvDisable(true);
+      ApplyFunction();
+      ss->setTempProvDisable(false);
+    }
   }
 }
 
@@ -1628,9 +1659,5 @@ GradientStop Q2DTransferFunction::GetGradient(unsigned int i) {
 
 
 shared_ptr<const vector<TFPolygon>> Q2DTransferFunction::GetSwatches() const {
-  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
-  shared_ptr<const vector<TFPolygon>> swatches = 
-      ss->cexecRet<shared_ptr<const vector<TFPolygon>>>(m_trans.fqName() +
-                                                        ".swatchGet");
-  return swatches;
+  return m_swatchGet();
 }
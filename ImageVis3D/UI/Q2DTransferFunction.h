@@ -42,6 +42,7 @@
 
 #include "QTransferFunction.h"
 #include "../Tuvok/IO/TransferFunction2D.h"
+#include "LuaBoundCall.h"
 #include <QtGui/QMouseEvent>
 
 #define Q2DT_PAINT_NONE  0
@@ -166,6 +167,10 @@ private:
   // states
   NormalizedHistogram2D    m_vHistogram;
   LuaClassInstance         m_trans;
+  // bound in SetData, called for every mouse move while dragging a swatch.
+  LuaBoundCall<void(size_t, TFPolygon)> m_swatchUpdate;
+  LuaBoundCall<std::shared_ptr<const std::vector<TFPolygon>>()> m_swatchGet;
+  LuaBoundCall<void(LuaClassInstance, LuaClassInstance)> m_changed2DTrans;
   unsigned int             m_iPaintmode;
   int                      m_iActiveSwatchIndex;
   E2DTransferFunctionMode m_eTransferFunctionMode;
@@ -203,6 +208,9 @@ private:
   INTVECTOR2  m_vMousePressPos;
   bool    m_bDragging;
   bool    m_bDraggingAll;
+  // whether the current drag changed the active swatch; the swatch is only
+  // recorded for provenance once the drag ends, see mouseReleaseEvent.
+  bool    m_bSwatchDragged;
   EDragMode  m_eDragMode;
   FLOATVECTOR4  m_vZoomWindow;
   Qt::MouseButton m_mouseButton;
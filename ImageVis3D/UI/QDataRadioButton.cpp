@@ -37,9 +37,10 @@
 
 #include "QDataRadioButton.h"
 #include <QtGui/QMouseEvent>
-#include "../Tuvok/IO/TuvokJPEG.h"
+#include "../Tuvok/Controller/Controller.h"
 #include "../Tuvok/IO/DICOM/DICOMParser.h"
 #include "../Tuvok/IO/3rdParty/jpeglib/jconfig.h"
+#include "../../Common/JPEGSliceDecoder.h"
 
 QDataRadioButton::QDataRadioButton(std::shared_ptr<FileStackInfo> stack,
                                    QWidget *parent) :
@@ -96,16 +97,22 @@ void QDataRadioButton::SetStackImage(unsigned int i, bool bForceUpdate) {
 
   QIcon icon;
 
-  std::vector<char> vData;
+  std::vector<char>& vData = m_vImageData;
   if (m_stackInfo->m_bIsJPEGEncoded) {
-    tuvok::JPEG jpg(m_stackInfo->m_Elements[i]->m_strFileName,
-                    dynamic_cast<SimpleDICOMFileInfo*>
-                      (m_stackInfo->m_Elements[i])->GetOffsetToData());
-    const char *jpg_data = jpg.data();
     // JPEG library automagically downsamples the data.
     m_stackInfo->m_iAllocated = BITS_IN_JSAMPLE;
-    vData.resize(jpg.size());
-    std::copy(jpg_data, jpg_data + jpg.size(), &vData[0]);
+    vData.resize(size_t(m_stackInfo->m_ivSize.x) * m_stackInfo->m_ivSize.y *
+                 m_stackInfo->m_ivSize.z * m_stackInfo->m_iComponentCount);
+    JPEGDecoderPool::Lease decoder;
+    if (!decoder->Decode(m_stackInfo->m_Elements[i]->m_strFileName,
+                         dynamic_cast<SimpleDICOMFileInfo*>
+                           (m_stackInfo->m_Elements[i])->GetOffsetToData(),
+                         &vData[0], vData.size())) {
+      WARNING("Could not decode the preview of %s: %s",
+              m_stackInfo->m_Elements[i]->m_strFileName.c_str(),
+              decoder->GetError().c_str());
+      return;
+    }
   } else {
     m_stackInfo->m_Elements[i]->GetData(vData);
   }
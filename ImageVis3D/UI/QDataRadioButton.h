@@ -42,6 +42,7 @@
 
 #include "StdDefines.h"
 #include <memory>
+#include <vector>
 #include <QtGui/QRadioButton>
 #include <../Tuvok/IO/DirectoryParser.h>
 
@@ -60,6 +61,8 @@ protected:
   unsigned int                        m_iCurrentImage;
   std::shared_ptr<FileStackInfo> m_stackInfo;
   float                               m_fScale;
+  /// the decoded preview slice; reused for every image shown
+  std::vector<char>                   m_vImageData;
 
   virtual void leaveEvent ( QEvent * event );
   virtual void mouseMoveEvent(QMouseEvent *event);
@@ -107,7 +107,8 @@ RenderWindow::RenderWindow(MasterController& masterController,
   m_bFirstPersonMode(false),
   m_fFirstPersonSpeed(s_fFirstPersonSpeed),
   m_RTModeBeforeCapture(AbstrRenderer::RT_INVALID_MODE),
-  m_SavedClipLocked(true)
+  m_SavedClipLocked(true),
+  m_RendererCallsID(LuaClassInstance::DEFAULT_INSTANCE_ID)
 {
   m_strID = "[%1] %2";
   m_strID = m_strID.arg(iCounter).arg(dataset);
@@ -135,9 +136,6 @@ void RenderWindow::ToggleHQCaptureMode() {
 }
 
 void RenderWindow::EnableHQCaptureMode(bool enable) {
-  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
-  string abstrRenName = GetLuaAbstrRenderer().fqName();
-
   if (GetRendererTarget() == AbstrRenderer::RT_CAPTURE) {
     // restore rotation from before the capture process
     if (enable == false) {
@@ -148,8 +146,7 @@ void RenderWindow::EnableHQCaptureMode(bool enable) {
   } else {
     // remember rotation from before the capture process
     if (enable == true) {
-      m_RTModeBeforeCapture = ss->cexecRet<AbstrRenderer::ERendererTarget>(
-          abstrRenName + ".getRendererTarget");
+      m_RTModeBeforeCapture = GetRendererTarget();
       m_mCaptureStartRotation = GetRotation(GetActiveRenderRegions()[0]);
       SetRendererTarget(AbstrRenderer::RT_CAPTURE);
     }
@@ -165,6 +162,9 @@ void RenderWindow::SetRendererTarget(AbstrRenderer::ERendererTarget targ)
 
 FLOATMATRIX4 RenderWindow::GetRotation(LuaClassInstance region)
 {
+  RegionCalls* calls = GetRegionCalls(region);
+  if (calls) return calls->getRotation4x4();
+
   shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
   string rn = region.fqName();
   FLOATMATRIX4 regionRot = ss->cexecRet<FLOATMATRIX4>(rn + ".getRotation4x4");
@@ -173,6 +173,9 @@ FLOATMATRIX4 RenderWindow::GetRotation(LuaClassInstance region)
 
 FLOATMATRIX4 RenderWindow::GetTranslation(LuaClassInstance region)
 {
+  RegionCalls* calls = GetRegionCalls(region);
+  if (calls) return calls->getTranslation4x4();
+
   shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
   string rn = region.fqName();
 
@@ -227,6 +230,65 @@ RenderWindow::GetRegionData(LuaClassInstance renderRegion) const
   return iter->second;
 }
 
+RenderWindow::RegionCalls*
+RenderWindow::GetRegionCalls(LuaClassInstance renderRegion) const
+{
+  RegionCallsMap::const_iterator iter = regionCallsMap.find(
+      renderRegion.getGlobalInstID());
+  return iter == regionCallsMap.end() ? NULL : iter->second;
+}
+
+void RenderWindow::RegionCalls::Unbind() {
+  is2D.Unbind();
+  is3D.Unbind();
+  containsPoint.Unbind();
+  getRotation4x4.Unbind();
+  setRotation4x4.Unbind();
+  getTranslation4x4.Unbind();
+  setTranslation4x4.Unbind();
+}
+
+void RenderWindow::RendererCalls::Unbind() {
+  paint.Unbind();
+  checkForRedraw.Unbind();
+  getRendererTarget.Unbind();
+  getRenderMode.Unbind();
+  getClearViewEnabled.Unbind();
+  isClipPlaneLocked.Unbind();
+  getRenderRegions.Unbind();
+  getCurrentSubFrameCount.Unbind();
+  getWorkingSubFrame.Unbind();
+  getCurrentBrickCount.Unbind();
+  getWorkingBrick.Unbind();
+  getMinLODIndex.Unbind();
+}
+
+const RenderWindow::RendererCalls& RenderWindow::BoundRendererCalls() const
+{
+  // the renderer is replaced when the window is re-initialized, e.g. after
+  // switching the renderer type; bind its functions on first use.
+  const LuaClassInstance::IDType id = m_LuaAbstrRenderer.getGlobalInstID();
+  if (id != m_RendererCallsID) {
+    shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
+    const string rn = m_LuaAbstrRenderer.fqName();
+    RendererCalls& c = m_RendererCalls;
+    c.paint.Bind(ss, rn + ".paint");
+    c.checkForRedraw.Bind(ss, rn + ".checkForRedraw");
+    c.getRendererTarget.Bind(ss, rn + ".getRendererTarget");
+    c.getRenderMode.Bind(ss, rn + ".getRenderMode");
+    c.getClearViewEnabled.Bind(ss, rn + ".getClearViewEnabled");
+    c.isClipPlaneLocked.Bind(ss, rn + ".isClipPlaneLocked");
+    c.getRenderRegions.Bind(ss, rn + ".getRenderRegions");
+    c.getCurrentSubFrameCount.Bind(ss, rn + ".getCurrentSubFrameCount");
+    c.getWorkingSubFrame.Bind(ss, rn + ".getWorkingSubFrame");
+    c.getCurrentBrickCount.Bind(ss, rn + ".getCurrentBrickCount");
+    c.getWorkingBrick.Bind(ss, rn + ".getWorkingBrick");
+    c.getMinLODIndex.Bind(ss, rn + ".getMinLODIndex");
+    m_RendererCallsID = id;
+  }
+  return m_RendererCalls;
+}
+
 uint64_t RenderWindow::GetSliceDepth(LuaClassInstance renderRegion) const {
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   return ss->cexecRet<uint64_t>(renderRegion.fqName() + ".getSliceDepth");
@@ -239,17 +301,23 @@ void RenderWindow::SetSliceDepth(LuaClassInstance renderRegion,
 }
 
 bool RenderWindow::IsRegion2D(LuaClassInstance region) const {
+  RegionCalls* calls = GetRegionCalls(region);
+  if (calls) return calls->is2D();
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   return ss->cexecRet<bool>(region.fqName() + ".is2D");
 }
 
 bool RenderWindow::IsRegion3D(LuaClassInstance region) const {
+  RegionCalls* calls = GetRegionCalls(region);
+  if (calls) return calls->is3D();
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   return ss->cexecRet<bool>(region.fqName() + ".is3D");
 }
 
 bool RenderWindow::DoesRegionContainPoint(LuaClassInstance region,
                                           UINTVECTOR2 pos) const {
+  RegionCalls* calls = GetRegionCalls(region);
+  if (calls) return calls->containsPoint(pos);
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   return ss->cexecRet<bool>(region.fqName() + ".containsPoint", pos);
 }
@@ -318,15 +386,11 @@ void RenderWindow::SetRegionMaxCoord(LuaClassInstance region,
 }
 
 tuvok::AbstrRenderer::ERendererTarget RenderWindow::GetRendererTarget() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  return ss->cexecRet<tuvok::AbstrRenderer::ERendererTarget>(
-      m_LuaAbstrRenderer.fqName() + ".getRendererTarget");
+  return BoundRendererCalls().getRendererTarget();
 }
 
 bool RenderWindow::GetClearViewEnabled() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  return ss->cexecRet<bool>(
-      m_LuaAbstrRenderer.fqName() + ".getClearViewEnabled");
+  return BoundRendererCalls().getClearViewEnabled();
 }
 
 string RenderWindow::GetRendererClearViewDisabledReason() {
@@ -388,8 +452,7 @@ void RenderWindow::ScheduleCompleteRedraw() {
 }
 
 bool RenderWindow::RendererCheckForRedraw() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  return ss->cexecRet<bool>(m_LuaAbstrRenderer.fqName() + ".checkForRedraw");
+  return BoundRendererCalls().checkForRedraw();
 }
 
 FLOATVECTOR3 RenderWindow::GetBackgroundColor(int i) {
@@ -451,38 +514,25 @@ void RenderWindow::SetLODLimits(const UINTVECTOR2& vLODLimits) {
 }
 
 uint64_t RenderWindow::GetCurrentSubFrameCount() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  string rn = m_LuaAbstrRenderer.fqName();
-  return static_cast<unsigned int>(ss->cexecRet<uint64_t>(
-          rn + ".getCurrentSubFrameCount"));
+  return static_cast<unsigned int>(
+      BoundRendererCalls().getCurrentSubFrameCount());
 }
 
 uint32_t RenderWindow::GetWorkingSubFrame() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  string rn = m_LuaAbstrRenderer.fqName();
-  return static_cast<unsigned int>(ss->cexecRet<uint32_t>(
-          rn + ".getWorkingSubFrame"));
+  return static_cast<unsigned int>(BoundRendererCalls().getWorkingSubFrame());
 }
 
 uint32_t RenderWindow::GetCurrentBrickCount() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  string rn = m_LuaAbstrRenderer.fqName();
-  return static_cast<unsigned int>(ss->cexecRet<uint32_t>(
-          rn + ".getCurrentBrickCount"));
+  return static_cast<unsigned int>(
+      BoundRendererCalls().getCurrentBrickCount());
 }
 
 uint32_t RenderWindow::GetWorkingBrick() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  string rn = m_LuaAbstrRenderer.fqName();
-  return static_cast<unsigned int>(ss->cexecRet<uint32_t>(
-          rn + ".getWorkingBrick"));
+  return static_cast<unsigned int>(BoundRendererCalls().getWorkingBrick());
 }
 
 uint64_t RenderWindow::GetMinLODIndex() {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  string rn = m_LuaAbstrRenderer.fqName();
-  return static_cast<unsigned int>(ss->cexecRet<uint64_t>(
-          rn + ".getMinLODIndex"));
+  return static_cast<unsigned int>(BoundRendererCalls().getMinLODIndex());
 }
 
 void RenderWindow::SetDatasetIsInvalid(bool datasetIsInvalid) {
@@ -617,9 +667,7 @@ bool RenderWindow::GetRendererClipPlaneEnabled() const {
 }
 
 bool RenderWindow::GetRendererClipPlaneLocked() const {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  string rn = m_LuaAbstrRenderer.fqName();
-  return ss->cexecRet<bool>(rn + ".isClipPlaneLocked");
+  return BoundRendererCalls().isClipPlaneLocked();
 }
 
 bool RenderWindow::GetRendererClipPlaneShown() const {
@@ -979,12 +1027,11 @@ LuaClassInstance RenderWindow::GetRegionUnderCursor(INTVECTOR2 vPos) const {
   if (vPos.x < 0 || vPos.y < 0)
       return LuaClassInstance();
 
-  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
-
   vPos.y = m_vWinDim.y - vPos.y;
-  for (size_t i=0; i < GetActiveRenderRegions().size(); ++i) {
-    if (DoesRegionContainPoint(GetActiveRenderRegions()[i], UINTVECTOR2(vPos)))
-      return GetActiveRenderRegions()[i];
+  const std::vector<LuaClassInstance> regions = GetActiveRenderRegions();
+  for (size_t i=0; i < regions.size(); ++i) {
+    if (DoesRegionContainPoint(regions[i], UINTVECTOR2(vPos)))
+      return regions[i];
   }
   return LuaClassInstance();
 }
@@ -1439,9 +1486,7 @@ RenderWindow::GetFirst3DRegion() {
 
 const std::vector<LuaClassInstance>
 RenderWindow::GetActiveRenderRegions() const {
-  return m_MasterController.LuaScript()->
-      cexecRet<std::vector<LuaClassInstance> >(m_LuaAbstrRenderer.fqName() +
-                                               ".getRenderRegions");
+  return BoundRendererCalls().getRenderRegions();
 }
 
 void RenderWindow::SetActiveRenderRegions(std::vector<LuaClassInstance> regions)
@@ -1580,11 +1625,24 @@ void RenderWindow::Initialize() {
 
   // initialize region data map now that we have all the render regions
   for (int i=0; i < MAX_RENDER_REGIONS; ++i)
-    for (int j=0; j < NUM_WINDOW_MODES; ++j)
+    for (int j=0; j < NUM_WINDOW_MODES; ++j) {
       regionDataMap.insert(std::make_pair(
           luaRenderRegions[i][j].getGlobalInstID(),
           &regionDatas[i][j]));
 
+      const string rn = luaRenderRegions[i][j].fqName();
+      RegionCalls& calls = regionCalls[i][j];
+      calls.is2D.Bind(ss, rn + ".is2D");
+      calls.is3D.Bind(ss, rn + ".is3D");
+      calls.containsPoint.Bind(ss, rn + ".containsPoint");
+      calls.getRotation4x4.Bind(ss, rn + ".getRotation4x4");
+      calls.setRotation4x4.Bind(ss, rn + ".setRotation4x4");
+      calls.getTranslation4x4.Bind(ss, rn + ".getTranslation4x4");
+      calls.setTranslation4x4.Bind(ss, rn + ".setTranslation4x4");
+      regionCallsMap.insert(std::make_pair(
+          luaRenderRegions[i][j].getGlobalInstID(), &calls));
+    }
+
   SetupArcBall();
 }
 
@@ -1593,6 +1651,14 @@ void RenderWindow::Cleanup() {
   if (m_LuaAbstrRenderer.isValid(ss) == false)
     return;
 
+  // the bound calls would keep the functions of the deleted instances alive
+  m_RendererCalls.Unbind();
+  m_RendererCallsID = LuaClassInstance::DEFAULT_INSTANCE_ID;
+  regionCallsMap.clear();
+  for (int i=0; i < MAX_RENDER_REGIONS; ++i)
+    for (int j=0; j < NUM_WINDOW_MODES; ++j)
+      regionCalls[i][j].Unbind();
+
   ss->cexec(m_LuaAbstrRenderer.fqName() + ".cleanup");
   m_MasterController.ReleaseVolumeRenderer(m_LuaAbstrRenderer);
   m_LuaAbstrRenderer.invalidate();
@@ -1610,9 +1676,7 @@ void RenderWindow::CheckForRedraw() {
 }
 
 AbstrRenderer::ERenderMode RenderWindow::GetRenderMode() const {
-  shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
-  return ss->cexecRet<AbstrRenderer::ERenderMode>(m_LuaAbstrRenderer.fqName()
-                                                  + ".getRenderMode");
+  return BoundRendererCalls().getRenderMode();
 }
 
 void RenderWindow::SetBlendPrecision(
@@ -1728,8 +1792,13 @@ void RenderWindow::SetTranslation(LuaClassInstance renderRegion,
                                   FLOATMATRIX4 accumulatedTranslation) {
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   string rn = m_LuaAbstrRenderer.fqName();
+  RegionCalls* calls = GetRegionCalls(renderRegion);
   ss->setTempProvDisable(true);
-  ss->cexec(renderRegion.fqName()+".setTranslation4x4",accumulatedTranslation);
+  if (calls)
+    calls->setTranslation4x4(accumulatedTranslation);
+  else
+    ss->cexec(renderRegion.fqName()+".setTranslation4x4",
+              accumulatedTranslation);
   ss->setTempProvDisable(false);
 
   RegionData *regionData = GetRegionData(renderRegion);
@@ -1747,8 +1816,12 @@ void RenderWindow::SetTranslationDelta(LuaClassInstance renderRegion,
   newTranslation.m43 += trans.z;
 
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
+  RegionCalls* calls = GetRegionCalls(renderRegion);
   ss->setTempProvDisable(true);
-  ss->cexec(renderRegion.fqName() + ".setTranslation4x4", newTranslation);
+  if (calls)
+    calls->setTranslation4x4(newTranslation);
+  else
+    ss->cexec(renderRegion.fqName() + ".setTranslation4x4", newTranslation);
   ss->setTempProvDisable(false);
 
   RegionData *regionData = GetRegionData(renderRegion);
@@ -1816,8 +1889,12 @@ void RenderWindow::SetRotation(LuaClassInstance region,
   // rotation command, only the final rotation command.
   /// @todo should wrap in try catch so that setTempProvDisable always gets
   ///       called.
+  RegionCalls* calls = GetRegionCalls(region);
   ss->setTempProvDisable(true);
-  ss->cexec(region.fqName() + ".setRotation4x4", newRotation);
+  if (calls)
+    calls->setRotation4x4(newRotation);
+  else
+    ss->cexec(region.fqName() + ".setRotation4x4", newRotation);
   ss->setTempProvDisable(false);
 
   updateClipPlaneTransform(region);
@@ -1830,8 +1907,12 @@ void RenderWindow::SetRotationDelta(LuaClassInstance region,
   string rn = m_LuaAbstrRenderer.fqName();
 
   shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
+  RegionCalls* calls = GetRegionCalls(region);
   ss->setTempProvDisable(true);
-  ss->cexec(region.fqName() + ".setRotation4x4", newRotation);
+  if (calls)
+    calls->setRotation4x4(newRotation);
+  else
+    ss->cexec(region.fqName() + ".setRotation4x4", newRotation);
   ss->setTempProvDisable(false);
 
   updateClipPlaneTransform(region);
@@ -1851,16 +1932,13 @@ void RenderWindow::SetRotationDelta(LuaClassInstance region,
 
 void RenderWindow::updateClipPlaneTransform(LuaClassInstance region)
 {
-  shared_ptr<LuaScripting> ss = m_MasterController.LuaScript();
-  string renName = m_LuaAbstrRenderer.fqName();
-
   // Test whether the clipping plane is locked. If it is, then utilize the
   // model->world transform of the volume. Otherwise, just utilize the clip
   // to world matrix.
 
   /// @todo Handle inverted plane normal. A simple inverted boolean will
   ///       suffice.
-  if(ss->cexecRet<bool>(renName + ".isClipPlaneLocked")) {
+  if(GetRendererClipPlaneLocked()) {
     // (clip space ->) object space -> world space
     FLOATMATRIX4 r = computeClipToVolToWorldTransform(region);
 
@@ -2115,7 +2193,6 @@ void RenderWindow::SetFoV(float fFoV, bool bPropagate) {
 }
 
 void RenderWindow::SetIsoValue(float fIsoVal, bool bPropagate) {
-  /// @todo Provenance: Need final iso value instead of continuous change.
   /// @todo Update isovalue slider from hook.
   shared_ptr<LuaScripting> ss(m_MasterController.LuaScript());
   string rn = m_LuaAbstrRenderer.fqName();
@@ -2461,7 +2538,7 @@ void RenderWindow::PaintRenderer()
   string rn = m_LuaAbstrRenderer.fqName();
 
   if (m_LuaAbstrRenderer.isValid(ss) && m_bRenderSubsysOK) {
-    if (!ss->cexecRet<bool>(rn + ".paint")) {
+    if (!BoundRendererCalls().paint()) {
       static bool bBugUseronlyOnce = true;
       if (bBugUseronlyOnce) {
         if (m_eRendererType == MasterController::OPENGL_2DSBVR) {
@@ -52,6 +52,7 @@
 #include "../Tuvok/LuaScripting/LuaScripting.h"
 #include "../Tuvok/LuaScripting/LuaClassRegistration.h"
 #include "../Tuvok/LuaScripting/LuaMemberReg.h"
+#include "LuaBoundCall.h"
 
 class MainWindow;
 
@@ -374,6 +375,47 @@ class RenderWindow
 
     RegionData* GetRegionData(tuvok::LuaClassInstance) const;
 
+    /// The region's functions used on every mouse move, bound once in
+    /// Initialize (see LuaBoundCall).  Kept apart from RegionData since
+    /// CloneViewState copies that between windows.
+    struct RegionCalls {
+      LuaBoundCall<bool()> is2D;
+      LuaBoundCall<bool()> is3D;
+      LuaBoundCall<bool(UINTVECTOR2)> containsPoint;
+      LuaBoundCall<FLOATMATRIX4()> getRotation4x4;
+      LuaBoundCall<void(FLOATMATRIX4)> setRotation4x4;
+      LuaBoundCall<FLOATMATRIX4()> getTranslation4x4;
+      LuaBoundCall<void(FLOATMATRIX4)> setTranslation4x4;
+      void Unbind();
+    };
+    RegionCalls regionCalls[MAX_RENDER_REGIONS][NUM_WINDOW_MODES];
+    typedef std::unordered_map<tuvok::LuaClassInstance::IDType,RegionCalls*>
+        RegionCallsMap;
+    RegionCallsMap regionCallsMap;
+    /// NULL for regions which do not belong to this window.
+    RegionCalls* GetRegionCalls(tuvok::LuaClassInstance) const;
+
+    /// The renderer's functions used for every paint and mouse move, bound
+    /// to the current renderer by BoundRendererCalls.
+    struct RendererCalls {
+      LuaBoundCall<bool()> paint;
+      LuaBoundCall<bool()> checkForRedraw;
+      LuaBoundCall<tuvok::AbstrRenderer::ERendererTarget()> getRendererTarget;
+      LuaBoundCall<tuvok::AbstrRenderer::ERenderMode()> getRenderMode;
+      LuaBoundCall<bool()> getClearViewEnabled;
+      LuaBoundCall<bool()> isClipPlaneLocked;
+      LuaBoundCall<std::vector<tuvok::LuaClassInstance>()> getRenderRegions;
+      LuaBoundCall<uint64_t()> getCurrentSubFrameCount;
+      LuaBoundCall<uint32_t()> getWorkingSubFrame;
+      LuaBoundCall<uint32_t()> getCurrentBrickCount;
+      LuaBoundCall<uint32_t()> getWorkingBrick;
+      LuaBoundCall<uint64_t()> getMinLODIndex;
+      void Unbind();
+    };
+    const RendererCalls& BoundRendererCalls() const;
+    mutable RendererCalls m_RendererCalls;
+    mutable tuvok::LuaClassInstance::IDType m_RendererCallsID;
+
     void SetupArcBall();
 
     void ResizeRenderer(int width, int height);
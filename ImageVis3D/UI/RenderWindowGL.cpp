@@ -58,6 +58,7 @@
 #include "../Tuvok/Renderer/ContextIdentification.h"
 #include "../Tuvok/LuaScripting/LuaScripting.h"
 #include "../Tuvok/LuaScripting/TuvokSpecific/LuaTuvokTypes.h"
+#include "../../Common/ShaderBinaryCache.h"
 
 using namespace std;
 using namespace tuvok;
@@ -216,6 +217,10 @@ void RenderWindowGL::InitializeRenderer()
       ms_gpuVendorString = s.str();
       MESSAGE("Starting up GL!  Running on a %s", ms_gpuVendorString.c_str());
 
+      // reuse the shader programs linked by earlier runs on this driver
+      const std::string shaderCache = ShaderBinaryCache::DefaultDirectory();
+      if (!shaderCache.empty()) ShaderBinaryCache::Install(shaderCache);
+
       const bool bOpenGLSO12     = atof((const char*)version) >= 1.2;
       const bool bOpenGLSO20     = atof((const char*)version) >= 2.0;
       const bool bOpenGLSO       = glewGetExtension("GL_ARB_shader_objects");
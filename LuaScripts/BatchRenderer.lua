@@ -37,6 +37,28 @@ renderer.paint()
 renderer.setRendererTarget(tuvok.renderer.types.RT_Capture)
 renderer.captureSingleFrame(outputDir .. '/render.png', true)
 
+-- Animations: render a list of key frames, see RenderFrames.lua.  Here the
+-- cameras come from a key frame file written by FlyThroughAnimator.lua,
+-- which defines 'keyPoints' and places the data set in 'region'.  Run the
+-- script with 'BatchRenderer -f <script> -w 4' to split the frames between
+-- four processes; everything else in the script then runs in each of them,
+-- so single frames like the capture above belong in a
+-- 'if tuvok.workerIndex() == 0 then ... end' block.
+--dofile('RenderFrames.lua')
+--region = renderer.getFirst3DRenderRegion()
+--dofile(dataset .. '-KeyFrames00.txt')
+--frames = {}
+--for i = 1, #keyPoints do frames[i] = {camera=keyPoints[i]} end
+--renderFrames(renderer, frames, outputDir .. '/frame%04d.png', 640, 480, true)
+
+-- Parameter studies: render every combination of a few settings without
+-- reloading anything in between, see RenderSweep.lua.
+--dofile('RenderSweep.lua')
+--enableSweep(renderer)
+--renderer.sweep{width=640, height=480,
+--               pattern=outputDir .. '/{tf}-sr{sampleRate}.png',
+--               parameters={tf={'bone.1dt', 'skin.1dt'}, sampleRate={1, 2}}}
+
 renderer.cleanup()
 deleteClass(renderer)
 
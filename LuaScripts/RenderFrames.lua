@@ -0,0 +1,76 @@
+description = [[
+********************************************************************************
+
+Brief:  Renders a list of key frames with the batch renderer.
+Usage:  dofile('RenderFrames.lua') from a BatchRenderer script, then call
+        renderFrames(renderer, frames, pattern, width, height, keepAlpha).
+
+        Every frame is a table which may contain
+          camera   = {eye={x=,y=,z=}, ref={x=,y=,z=}, vup={x=,y=,z=}}
+                     (the format FlyThroughAnimator.lua writes key frames in)
+          timestep = the timestep to show
+          setup    = function(renderer, index) for anything else, e.g.
+                     transfer function changes
+        Fields which are missing keep the value of the previous frame.
+
+        Frames are read back while the next one renders and written by
+        background threads, so long animations are bound by rendering
+        instead of image compression.  The file name of frame i is
+        string.format(pattern, i), e.g. 'frame%04d.png'.
+
+        With 'BatchRenderer -w N' the script runs in N processes and each
+        renders a contiguous share of the frames; frame numbers stay those
+        of the whole list, so the shares meet in one output directory.
+
+********************************************************************************
+]]
+
+function applyFrame(renderer, frame, index)
+  if frame.camera then
+    local cam = frame.camera
+    renderer.setViewPos({cam.eye.x, cam.eye.y, cam.eye.z})
+    renderer.setViewDir({cam.ref.x, cam.ref.y, cam.ref.z})
+    renderer.setUpDir(  {cam.vup.x, cam.vup.y, cam.vup.z})
+  end
+  if frame.timestep then
+    renderer.setTimestep(frame.timestep)
+  end
+  if frame.setup then
+    frame.setup(renderer, index)
+  end
+end
+
+-- First and last of the frames 1..n which this process renders.
+function frameRange(n)
+  local k, count = tuvok.workerIndex(), tuvok.workerCount()
+  return math.floor(k * n / count) + 1, math.floor((k + 1) * n / count)
+end
+
+-- Returns the number of frames which could not be written.
+function renderFrames(renderer, frames, pattern, width, height, keepAlpha)
+  -- interactive targets draw the final image into the context's own
+  -- framebuffer, which is where the frames are read from.
+  renderer.setRendererTarget(tuvok.renderer.types.RT_Interactive)
+  local first, last = frameRange(#frames)
+  -- fields missing from a frame keep the values of earlier ones, so a
+  -- worker first applies the frames before its share.
+  for i = 1, first - 1 do
+    applyFrame(renderer, frames[i], i)
+  end
+  for i = first, last do
+    applyFrame(renderer, frames[i], i)
+    renderer.paint()
+    if not tuvok.queueFrame(string.format(pattern, i), width, height,
+                            keepAlpha) then
+      print("Could not read back frame " .. i)
+    end
+    if (i - first + 1) % 100 == 0 then
+      print("Rendered " .. (i - first + 1) .. " of " .. (last - first + 1) ..
+            " frames")
+    end
+  end
+  local failed = tuvok.finishFrames()
+  print("Wrote " .. (last - first + 1 - failed) .. " of " ..
+        (last - first + 1) .. " frames")
+  return failed
+end
@@ -0,0 +1,149 @@
+description = [[
+********************************************************************************
+
+Brief:  Renders a volume which is split into parts with one batch renderer
+        process per part, composited sort-last.
+Usage:  Split the data set with 'uvfconvert -i big.uvf -o parts.uvf
+        --split N', then run 'BatchRenderer -f script.lua -w N -c' with a
+        script along the lines of
+
+          dofile('RenderParts.lua')
+          manifest, part = loadParts('parts.lua')
+          renderer = tuvok.renderer.new(...)
+          renderer.loadDataset(part.file)
+          ...
+          renderer.initialize(context)
+          placePart(renderer.getFirst3DRenderRegion(), manifest, part)
+          renderParts(renderer, manifest, part, frames, 'frame%04d.png',
+                      width, height, keepAlpha)
+
+        Every process loads nothing but its own part, so the whole volume
+        only needs to fit into the memory of all of them together.  Frames
+        are given like for renderFrames (see RenderFrames.lua); the first
+        one needs a camera, since the parts are sorted by the eye position.
+        Every process renders every frame; process 0 writes them.
+
+        The parts are blended in front-to-back order, using the alpha of
+        the framebuffer, so the background is set to transparent black.
+        Data sets are scaled to fit into [-0.5, 0.5] by their longest side
+        and drawn between the centers of their outermost voxels; placePart
+        puts the voxel centers of the part where they are in the whole
+        volume.  Every part holds the first voxels of the parts above it,
+        so neighbours meet at a plane of shared voxel centers and the
+        volume is interpolated across the splits as if it were whole.
+
+********************************************************************************
+]]
+
+dofile('RenderFrames.lua')
+
+local axes = {'x', 'y', 'z'}
+
+-- size of the longest side of a box in world units before scaling.
+local function longestSide(size, scale)
+  local longest = 0
+  for _, a in ipairs(axes) do
+    longest = math.max(longest, size[a] * scale[a])
+  end
+  return longest
+end
+
+-- Reads the manifest uvfconvert --split wrote; returns it and the part of
+-- this process.  Part files are relative to the manifest.
+function loadParts(filename)
+  local manifest = dofile(filename)
+  local dir = string.match(filename, '^(.*[/\\])') or ''
+  manifest.depth = 0
+  for _, part in ipairs(manifest.parts) do
+    part.file = dir .. part.file
+    manifest.depth = math.max(manifest.depth, #part.path)
+  end
+  if #manifest.parts ~= tuvok.workerCount() then
+    error(filename .. ' has ' .. #manifest.parts .. ' parts, but there are ' ..
+          tuvok.workerCount() .. ' workers')
+  end
+  return manifest, manifest.parts[tuvok.workerIndex() + 1]
+end
+
+-- Position of voxel centers along axis a of the whole volume in world
+-- coordinates; the first is at -extent/2, the last at extent/2.
+local function voxelToWorld(manifest, whole, a, voxel)
+  local n = manifest.domain[a]
+  local extent = n * manifest.scale[a] / whole
+  if n == 1 then return 0 end
+  return (voxel / (n - 1) - 0.5) * extent
+end
+
+-- Moves and scales the part, which was loaded as a data set of its own, so
+-- its voxel centers are where they are within the whole volume.
+function placePart(region, manifest, part)
+  local whole = longestSide(manifest.domain, manifest.scale)
+  local size = {}
+  for _, a in ipairs(axes) do
+    size[a] = part.dataHi[a] - part.lo[a]
+  end
+  local own = longestSide(size, manifest.scale)
+  local s, center = {}, {}
+  for _, a in ipairs(axes) do
+    local first = voxelToWorld(manifest, whole, a, part.lo[a])
+    local last = voxelToWorld(manifest, whole, a, part.dataHi[a] - 1)
+    local extent = size[a] * manifest.scale[a] / own
+    center[a] = (first + last) / 2
+    if manifest.domain[a] == 1 then
+      -- a single slice is drawn as thick as the whole volume draws it.
+      s[a] = (manifest.scale[a] / whole) / extent
+    else
+      s[a] = (last - first) / extent
+    end
+  end
+  region.setTranslation4x4({s.x, 0, 0, 0,
+                            0, s.y, 0, 0,
+                            0, 0, s.z, 0,
+                            center.x, center.y, center.z, 1})
+end
+
+-- Sort key of the part for an eye position in world coordinates; smaller
+-- keys are in front.  At every split plane on the path to the part, the
+-- side with the eye comes first.
+function partOrder(manifest, part, eye)
+  local whole = longestSide(manifest.domain, manifest.scale)
+  local key = 0
+  for _, split in ipairs(part.path) do
+    local a = split.axis
+    local n = manifest.domain[a]
+    local voxel = (eye[a] * whole / (n * manifest.scale[a]) + 0.5) * (n - 1)
+    local eyeUpper = voxel >= split.plane
+    key = key * 2 + ((eyeUpper == split.upper) and 0 or 1)
+  end
+  return key * 2 ^ (manifest.depth - #part.path)
+end
+
+-- Returns the number of frames which could not be composited or written.
+function renderParts(renderer, manifest, part, frames, pattern, width,
+                     height, keepAlpha)
+  if not frames[1].camera then
+    error('the first frame needs a camera')
+  end
+  renderer.setRendererTarget(tuvok.renderer.types.RT_Interactive)
+  renderer.setBGColors({0, 0, 0}, {0, 0, 0})
+  local failed = 0
+  local eye
+  for i = 1, #frames do
+    applyFrame(renderer, frames[i], i)
+    if frames[i].camera then eye = frames[i].camera.eye end
+    renderer.paint()
+    if not tuvok.compositeFrame(string.format(pattern, i), width, height,
+                                keepAlpha, partOrder(manifest, part, eye)) then
+      print("Could not composite frame " .. i)
+      failed = failed + 1
+    end
+    if i % 100 == 0 and tuvok.workerIndex() == 0 then
+      print("Rendered " .. i .. " of " .. #frames .. " frames")
+    end
+  end
+  failed = failed + tuvok.finishFrames()
+  if tuvok.workerIndex() == 0 then
+    print("Wrote " .. (#frames - failed) .. " of " .. #frames .. " frames")
+  end
+  return failed
+end
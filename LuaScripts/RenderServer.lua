@@ -0,0 +1,128 @@
+description = [[
+********************************************************************************
+
+Brief:  Serves renderings of data sets from a running batch renderer.
+Usage:  Start 'BatchRenderer -f server.lua -s /tmp/render.sock' with a
+        script along the lines of
+
+          dofile('RenderServer.lua')
+          startServer('/path/to/Tuvok/Shaders', 1024, 1024, 4)
+          render{dataset='head.uvf', width=128, height=128} -- optional warm up
+
+        The script runs once; afterwards the batch renderer stays up and
+        executes every request sent to the socket as a Lua chunk, one at a
+        time and in the order they arrived, in the state the script left.
+        A client connects, writes the chunk, shuts down its writing side and
+        reads "OK <bytes>\n" or "ERROR <bytes>\n" followed by the reply: the
+        string the chunk returns, or what it passes to tuvok.reply or
+        tuvok.replyFrame.  Scripts/renderclient.py is such a client.
+
+        Requests are usually just a call of render with a table describing
+        the image, e.g.
+
+          return render{dataset='head.uvf', width=256, height=256,
+                        camera={eye={x=0,y=0,z=3}, ref={x=0,y=0,z=0},
+                                vup={x=0,y=1,z=0}}}
+
+        Besides dataset, width and height the table may contain everything
+        a frame of renderFrames does (see RenderFrames.lua), plus
+          format = image format of the reply, 'png' (default) or 'jpg'
+          alpha  = true to keep the alpha channel
+        A renderer is kept per data set, so the data set, its shaders and
+        its bricks stay loaded for the next request; the least recently
+        used one is dropped once there are more than startServer allows.
+        Unlike the frames of renderFrames, every request starts from the
+        data set as loaded: a missing camera is the initial view, a missing
+        timestep is 0, and a renderer a setup function has changed (e.g.
+        its transfer function) is loaded again before the next request.
+        'return tuvok.stopServer()' shuts the server down.
+
+********************************************************************************
+]]
+
+dofile('RenderFrames.lua')
+
+-- views: the camera of each renderer when it was created; changed: the
+-- renderers a setup function has run on, which may be in any state.
+local server = {renderers={}, used={}, views={}, changed={}, clock=0}
+
+-- Creates the context all renderers share; requests can be at most
+-- maxWidth x maxHeight.  At most maxRenderers data sets stay loaded.
+function startServer(shadersDir, maxWidth, maxHeight, maxRenderers)
+  server.shadersDir = shadersDir
+  server.context = tuvok.createContext(maxWidth, maxHeight, 32, 24, 8, true,
+                                       false)
+  server.maxWidth, server.maxHeight = maxWidth, maxHeight
+  server.maxRenderers = maxRenderers or 4
+end
+
+local function dropRenderer(dataset)
+  local r = server.renderers[dataset]
+  server.renderers[dataset] = nil
+  server.used[dataset] = nil
+  server.views[dataset] = nil
+  server.changed[dataset] = nil
+  r.cleanup()
+  deleteClass(r)
+end
+
+local function rendererFor(dataset)
+  server.clock = server.clock + 1
+  local r = server.renderers[dataset]
+  if r and not server.changed[dataset] then
+    server.used[dataset] = server.clock
+    return r
+  end
+  if r then dropRenderer(dataset) end
+
+  local count, oldest = 0, nil
+  for name, _ in pairs(server.renderers) do
+    count = count + 1
+    if not oldest or server.used[name] < server.used[oldest] then
+      oldest = name
+    end
+  end
+  if count >= server.maxRenderers then
+    dropRenderer(oldest)
+  end
+
+  r = tuvok.renderer.new(tuvok.renderer.types.OpenGL_SBVR,
+                         false, false, false, false, false)
+  local ok, err = pcall(r.loadDataset, dataset)
+  if not ok then
+    deleteClass(r)
+    error("could not load '" .. tostring(dataset) .. "': " .. tostring(err))
+  end
+  r.addShaderPath(server.shadersDir)
+  r.initialize(server.context)
+  r.setRendererTarget(tuvok.renderer.types.RT_Interactive)
+  local function xyz(v) return {x=v[1], y=v[2], z=v[3]} end
+  server.views[dataset] = {eye=xyz(r.getViewPos()), ref=xyz(r.getViewDir()),
+                           vup=xyz(r.getUpDir())}
+  server.renderers[dataset] = r
+  server.used[dataset] = server.clock
+  return r
+end
+
+-- Renders the image a request describes and makes it the reply.
+function render(request)
+  if not server.context then
+    error('startServer has not been called')
+  end
+  local w, h = request.width or 256, request.height or 256
+  if w > server.maxWidth or h > server.maxHeight then
+    error(w .. 'x' .. h .. ' is larger than the server context (' ..
+          server.maxWidth .. 'x' .. server.maxHeight .. ')')
+  end
+  local r = rendererFor(request.dataset)
+  r.resize({w, h})
+  -- nothing carries over from the previous request.
+  if request.setup then server.changed[request.dataset] = true end
+  applyFrame(r, {camera=request.camera or server.views[request.dataset],
+                 timestep=request.timestep or 0, setup=request.setup}, 1)
+  r.paint()
+  if not tuvok.replyFrame(w, h, request.format or 'png', request.alpha or
+                          false) then
+    error('could not read back the frame')
+  end
+end
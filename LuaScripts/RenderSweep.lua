@@ -0,0 +1,191 @@
+description = [[
+********************************************************************************
+
+Brief:  Renders every combination of a grid of rendering parameters with one
+        renderer, e.g. to compare isovalues, sample rates and transfer
+        functions.
+Usage:  dofile('RenderSweep.lua') from a BatchRenderer script, set up and
+        initialize the renderer as for a single image, then
+
+          sweep(renderer, {
+            width=640, height=480, keepAlpha=false,
+            pattern='out/{tf}-iso{isovalue}-{sampleRate}.png',
+            parameters={
+              tf={'bone.1dt', 'skin.1dt'},
+              isovalue={0.2, 0.4, 0.6},
+              sampleRate={1, 2},
+            },
+          })
+
+        or enableSweep(renderer) once and renderer.sweep{...} with the same
+        table.  Built in parameters are
+          timestep   = timesteps (renderer.setTimestep)
+          tf         = 1D transfer function files
+          isovalue   = isovalues (renderer.setIsoValue)
+          sampleRate = sample rate modifiers
+          camera     = cameras as in RenderFrames.lua
+          setup      = functions(renderer), for anything else
+        Other names need an entry in 'apply', a table of
+        function(renderer, value).  The render mode is left as the renderer
+        has it, so set it to the isosurface mode before sweeping isovalues.
+
+        The data set, its bricks and the shaders stay loaded for the whole
+        sweep; only what differs from the previous image is set.  The
+        combinations are ordered so that the parameters which are expensive
+        to change change least often: by default timestep, tf, setup,
+        isovalue, sampleRate and camera from the slowest to the fastest
+        changing, other names before camera in the order of 'order' if
+        given.  Every image differs from the one before in one parameter
+        only, since the faster parameters run back and forth instead of
+        starting over.
+
+        'pattern' is either a string, where {name} is replaced by the value
+        of the parameter (the file name without extension for tf) and %d
+        style formats by the number of the image, or a function(values,
+        index) returning the file name.  Images are read back and written
+        in the background like in renderFrames, and with
+        'BatchRenderer -w N' each process renders a share of them.  Returns
+        the number of images which could not be written.
+
+********************************************************************************
+]]
+
+dofile('RenderFrames.lua')
+
+-- from the slowest to the fastest changing
+local defaultOrder = {'timestep', 'tf', 'setup', 'isovalue', 'sampleRate',
+                      'camera'}
+
+local builtins = {
+  timestep = function(renderer, t) renderer.setTimestep(t) end,
+  tf = function(renderer, file)
+    local tf = renderer.get1DTrans()
+    if not tf.loadFromFileWithSize(file, tf.getSize()) then
+      error("could not load the transfer function '" .. file .. "'")
+    end
+    tuvok.gpu.changed1DTrans(nil, tf)
+  end,
+  setup = function(renderer, f) f(renderer) end,
+  isovalue = function(renderer, v) renderer.setIsoValue(v) end,
+  sampleRate = function(renderer, v) renderer.setSampleRateModifier(v) end,
+  camera = function(renderer, cam) applyFrame(renderer, {camera=cam}, 1) end,
+}
+
+-- Names of the swept parameters from the slowest to the fastest changing.
+local function sweepOrder(parameters, order)
+  local names, seen = {}, {}
+  local function add(name)
+    if parameters[name] and not seen[name] then
+      names[#names + 1] = name
+      seen[name] = true
+    end
+  end
+  for _, name in ipairs(order or {}) do add(name) end
+  for _, name in ipairs(defaultOrder) do
+    if name == 'camera' then
+      -- parameters without a place go before the cheapest one
+      local rest = {}
+      for n, _ in pairs(parameters) do
+        if not seen[n] and n ~= 'camera' then rest[#rest + 1] = n end
+      end
+      table.sort(rest)
+      for _, n in ipairs(rest) do add(n) end
+    end
+    add(name)
+  end
+  return names
+end
+
+-- All combinations as lists of value indices, in an order where neighbours
+-- differ in one index: each faster index runs up and then back down.
+local function combinations(names, parameters)
+  local combos = {}
+  local current = {}
+  local forward = {}
+  local function visit(level)
+    if level > #names then
+      local c = {}
+      for i = 1, #names do c[i] = current[i] end
+      combos[#combos + 1] = c
+      return
+    end
+    local count = #parameters[names[level]]
+    if forward[level] == nil then forward[level] = true end
+    local first, last, step = 1, count, 1
+    if not forward[level] then first, last, step = count, 1, -1 end
+    for i = first, last, step do
+      current[level] = i
+      visit(level + 1)
+    end
+    forward[level] = not forward[level]
+  end
+  visit(1)
+  return combos
+end
+
+local function valueName(name, value)
+  if name == 'tf' then
+    return (string.gsub(string.match(value, '([^/\\]*)$'), '%.[^.]*$', ''))
+  end
+  return tostring(value)
+end
+
+local function fileName(pattern, values, index)
+  if type(pattern) == 'function' then return pattern(values, index) end
+  local name = string.gsub(pattern, '{([%w_]+)}', function(key)
+    if values[key] == nil then return nil end
+    return valueName(key, values[key])
+  end)
+  if string.find(name, '%%') then name = string.format(name, index) end
+  return name
+end
+
+function sweep(renderer, spec)
+  local parameters = spec.parameters or {}
+  local apply = {}
+  for name, values in pairs(parameters) do
+    apply[name] = (spec.apply and spec.apply[name]) or builtins[name]
+    if not apply[name] then
+      error("no 'apply' function for the parameter '" .. name .. "'")
+    end
+    if #values == 0 then
+      error("the parameter '" .. name .. "' has no values")
+    end
+  end
+  if not spec.pattern then error('the sweep needs a pattern') end
+
+  local names = sweepOrder(parameters, spec.order)
+  local combos = combinations(names, parameters)
+  renderer.setRendererTarget(tuvok.renderer.types.RT_Interactive)
+  local first, last = frameRange(#combos)
+  local applied = {}
+  for i = first, last do
+    local values = {}
+    for level, name in ipairs(names) do
+      local index = combos[i][level]
+      values[name] = parameters[name][index]
+      if applied[level] ~= index then
+        apply[name](renderer, values[name])
+        applied[level] = index
+      end
+    end
+    renderer.paint()
+    if not tuvok.queueFrame(fileName(spec.pattern, values, i), spec.width,
+                            spec.height, spec.keepAlpha or false) then
+      print("Could not read back image " .. i)
+    end
+    if (i - first + 1) % 100 == 0 then
+      print("Rendered " .. (i - first + 1) .. " of " .. (last - first + 1) ..
+            " images")
+    end
+  end
+  local failed = tuvok.finishFrames()
+  print("Wrote " .. (last - first + 1 - failed) .. " of " ..
+        (last - first + 1) .. " images")
+  return failed
+end
+
+-- Adds renderer.sweep{...} for sweep(renderer, {...}).
+function enableSweep(renderer)
+  renderer.sweep = function(spec) return sweep(renderer, spec) end
+end
@@ -0,0 +1,414 @@
+#!/usr/bin/env python
+"""Throughput benchmark for uvfconvert.
+
+Generates a synthetic volume with the UVFReader tool ('uvf -c'), exports it
+to raw with uvfconvert and writes headers for every importable format that
+can point at (or embed) that raw file.  Then every format is converted to
+UVF for each combination of brick size, compression method and brick
+layout, and the following are recorded per run:
+
+  mbps      input megabytes (raw voxel data) per second of wall time
+  rss_mb    peak resident memory of the converter
+  temp_mb   peak size of the converter's scratch directory (-t)
+
+The volume is also written as a directory of PNG slices, which uvfconvert
+reads with -d.  That directory holds a single stack, which is the case
+where the stack reader gains nothing from running ahead of the bricker:
+the whole stack is flattened before bricking starts, so only the parallel
+slice reads can make it faster than converting the raw file.
+
+NHDR and NRRD inputs are read by uvfconvert's NRRD volume source; their
+UVF is exported back to raw and must reproduce the synthetic volume
+exactly, otherwise the run counts as failed.
+
+Meshes are generated directly and converted to PLY and STL.
+
+Results can be stored as a baseline and later runs compared against it; a
+run which is slower, or needs more memory or scratch space, than the
+baseline by more than the tolerance counts as a regression and makes the
+script exit with status 1.  Everything runs locally and needs no GPU.
+Linux only, since peak memory comes from wait4(2).
+
+  python Scripts/convbench.py --save-baseline bench.json
+  python Scripts/convbench.py --baseline bench.json
+"""
+from __future__ import print_function
+
+import argparse
+import filecmp
+import json
+import os
+import shutil
+import struct
+import sys
+import tempfile
+import threading
+import time
+import zlib
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# raw file element type per bit width, in the spelling of each format.
+TYPES = {
+  8:  {"nrrd": "uint8",  "qvis": "UCHAR",  "mhd": "MET_UCHAR",
+       "bov": "BYTE",  "analyze": (2, 8)},
+  16: {"nrrd": "uint16", "qvis": "USHORT", "mhd": "MET_USHORT",
+       "bov": "SHORT", "analyze": (4, 16)},
+}
+
+
+def write_nhdr(base, size, bits):
+  fn = base + ".nhdr"
+  with open(fn, "w") as f:
+    f.write("NRRD0004\ntype: %s\ndimension: 3\nsizes: %d %d %d\n"
+            "spacings: 1 1 1\nendian: little\nencoding: raw\n"
+            "data file: %s\n" % ((TYPES[bits]["nrrd"],) + size +
+                                 (os.path.basename(base) + ".raw",)))
+  return fn
+
+
+def write_nrrd(base, size, bits):
+  # attached header: the data follows the blank line.
+  fn = base + "-attached.nrrd"
+  with open(fn, "wb") as f:
+    f.write(("NRRD0004\ntype: %s\ndimension: 3\nsizes: %d %d %d\n"
+             "spacings: 1 1 1\nendian: little\nencoding: raw\n\n" %
+             ((TYPES[bits]["nrrd"],) + size)).encode("ascii"))
+    with open(base + ".raw", "rb") as raw:
+      shutil.copyfileobj(raw, f, 16*1024*1024)
+  return fn
+
+
+def write_qvis(base, size, bits):
+  fn = base + ".dat"
+  with open(fn, "w") as f:
+    f.write("ObjectFileName: %s\nTaggedFileName: ---\n"
+            "Resolution: %d %d %d\nSliceThickness: 1 1 1\nFormat: %s\n"
+            "NbrTags: 0\nObjectType: TEXTURE_VOLUME_OBJECT\nObjectModel: I\n"
+            "GridType: EQUIDISTANT\n" %
+            ((os.path.basename(base) + ".raw",) + size +
+             (TYPES[bits]["qvis"],)))
+  return fn
+
+
+def write_mhd(base, size, bits):
+  fn = base + ".mhd"
+  with open(fn, "w") as f:
+    f.write("ObjectType = Image\nNDims = 3\nDimSize = %d %d %d\n"
+            "ElementSpacing = 1 1 1\nElementType = %s\n"
+            "ElementByteOrderMSB = False\nElementDataFile = %s\n" %
+            (size + (TYPES[bits]["mhd"], os.path.basename(base) + ".raw")))
+  return fn
+
+
+def write_bov(base, size, bits):
+  fn = base + ".bov"
+  with open(fn, "w") as f:
+    f.write("DATA_FILE: %s\nDATA_SIZE: %d %d %d\nDATA_FORMAT: %s\n"
+            "VARIABLE: data\nDATA_ENDIAN: LITTLE\nCENTERING: zonal\n"
+            "BRICK_ORIGIN: 0 0 0\nBRICK_SIZE: %d %d %d\n" %
+            ((os.path.basename(base) + ".raw",) + size +
+             (TYPES[bits]["bov"],) + size))
+  return fn
+
+
+def write_analyze(base, size, bits):
+  # 348 byte Analyze 7.5 header next to a copy of the data as .img
+  fn = base + ".hdr"
+  datatype, bitpix = TYPES[bits]["analyze"]
+  hdr = bytearray(348)
+  struct.pack_into("<i", hdr, 0, 348)
+  struct.pack_into("<i", hdr, 32, 16384)                   # extents
+  hdr[38] = ord("r")                                       # regular
+  struct.pack_into("<8h", hdr, 40, 3, size[0], size[1], size[2], 1, 0, 0, 0)
+  struct.pack_into("<hh", hdr, 70, datatype, bitpix)
+  struct.pack_into("<8f", hdr, 76, 0, 1, 1, 1, 0, 0, 0, 0)
+  with open(fn, "wb") as f:
+    f.write(hdr)
+  shutil.copyfile(base + ".raw", base + ".img")
+  return fn
+
+
+def write_png(fn, width, height, bits, rows):
+  # grayscale, filter type 0 on every row; PNG samples are big endian.
+  def chunk(kind, data):
+    return (struct.pack(">I", len(data)) + kind + data +
+            struct.pack(">I", zlib.crc32(kind + data) & 0xffffffff))
+  with open(fn, "wb") as f:
+    f.write(b"\x89PNG\r\n\x1a\n")
+    f.write(chunk(b"IHDR", struct.pack(">IIBBBBB", width, height, bits, 0,
+                                       0, 0, 0)))
+    f.write(chunk(b"IDAT", zlib.compress(b"".join(b"\0" + r for r in rows),
+                                         1)))
+    f.write(chunk(b"IEND", b""))
+
+
+def write_png_stack(base, size, bits):
+  # one stack: a directory with a PNG per z slice.
+  path = base + "-stack"
+  if not os.path.isdir(path):
+    os.makedirs(path)
+  bpp = bits // 8
+  row = size[0] * bpp
+  with open(base + ".raw", "rb") as raw:
+    for z in range(size[2]):
+      data = bytearray(raw.read(row * size[1]))
+      if bpp == 2:
+        data[0::2], data[1::2] = data[1::2], data[0::2]
+      rows = [bytes(data[y*row:(y+1)*row]) for y in range(size[1])]
+      write_png(os.path.join(path, "slice%05d.png" % z), size[0], size[1],
+                bits, rows)
+  return path
+
+
+VOLUME_FORMATS = {
+  "nhdr": write_nhdr, "nrrd": write_nrrd, "qvis": write_qvis,
+  "mhd": write_mhd, "bov": write_bov, "analyze": write_analyze,
+}
+# formats which are a directory, converted with -d rather than -i.
+STACK_FORMATS = {"png-stack": write_png_stack}
+# formats whose conversion is checked against the synthetic raw file.
+CHECKED_FORMATS = ("nhdr", "nrrd")
+
+
+def write_obj(base, n):
+  # an n x n grid of quads, every quad with its own four vertices, as
+  # meshes exported triangle by triangle look.
+  fn = base + ".obj"
+  with open(fn, "w") as f:
+    f.write("# convbench grid\n")
+    for j in range(n):
+      lines = []
+      for i in range(n):
+        for (x, y) in ((i, j), (i+1, j), (i+1, j+1), (i, j+1)):
+          lines.append("v %g %g %g\n" % (x, y, ((x*7 + y*3) % 11) * 0.1))
+        lines.append("f -4 -3 -2 -1\n")
+      f.write("".join(lines))
+  return fn
+
+
+def write_ply(base, n):
+  fn = base + ".ply"
+  with open(fn, "w") as f:
+    f.write("ply\nformat ascii 1.0\nelement vertex %d\nproperty float x\n"
+            "property float y\nproperty float z\nelement face %d\n"
+            "property list uchar int vertex_indices\nend_header\n" %
+            ((n+1)*(n+1), n*n))
+    for y in range(n+1):
+      f.write("".join("%g %g %g\n" % (x, y, ((x*7 + y*3) % 11) * 0.1)
+                      for x in range(n+1)))
+    for y in range(n):
+      f.write("".join("4 %d %d %d %d\n" % (y*(n+1)+x, y*(n+1)+x+1,
+                                          (y+1)*(n+1)+x+1, (y+1)*(n+1)+x)
+                      for x in range(n)))
+  return fn
+
+
+GEOMETRY_FORMATS = {"obj": write_obj, "ply": write_ply}
+
+
+def dir_size(path):
+  total = 0
+  for dirpath, _, files in os.walk(path):
+    for fn in files:
+      try:
+        total += os.path.getsize(os.path.join(dirpath, fn))
+      except OSError:
+        pass  # removed while we were looking
+  return total
+
+
+def spawn(cmd):
+  """Starts 'cmd' with its output discarded; returns the pid."""
+  null = os.open(os.devnull, os.O_WRONLY)
+  try:
+    if hasattr(os, "posix_spawnp"):
+      return os.posix_spawnp(cmd[0], cmd, os.environ, file_actions=[
+        (os.POSIX_SPAWN_DUP2, null, 1), (os.POSIX_SPAWN_DUP2, null, 2)])
+    pid = os.fork()
+    if pid == 0:
+      try:
+        os.dup2(null, 1)
+        os.dup2(null, 2)
+        os.execvp(cmd[0], cmd)
+      finally:
+        os._exit(127)
+    return pid
+  finally:
+    os.close(null)
+
+
+def run(cmd, scratch=None):
+  """Runs 'cmd'; returns (status, seconds, peak rss MB, peak scratch MB)."""
+  peak = [0]
+  done = threading.Event()
+
+  def watch():
+    while not done.is_set():
+      peak[0] = max(peak[0], dir_size(scratch))
+      done.wait(0.05)
+
+  if scratch:
+    watcher = threading.Thread(target=watch)
+    watcher.start()
+  start = time.time()
+  # not subprocess: Popen has to reap the child itself, and wait4 is the
+  # only way to get the peak memory of this one child.
+  pid = spawn(cmd)
+  _, status, usage = os.wait4(pid, 0)
+  seconds = time.time() - start
+  if os.WIFEXITED(status):
+    status = os.WEXITSTATUS(status)
+  else:
+    status = -os.WTERMSIG(status)  # like Popen.returncode
+  if scratch:
+    done.set()
+    watcher.join()
+  # ru_maxrss is in kilobytes on Linux.
+  return status, seconds, usage.ru_maxrss / 1024.0, peak[0] / 1e6
+
+
+def numbers(s):
+  return [int(v) for v in s.split(",") if v]
+
+
+def main():
+  ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+  ap.add_argument("--uvfconvert", default=os.path.join(
+    ROOT, "CmdLineConverter", "Build", "uvfconvert"))
+  ap.add_argument("--uvf", default=os.path.join(ROOT, "UVFReader", "Build",
+                                                "uvf"))
+  ap.add_argument("--size", default="256,256,256",
+                  help="synthetic volume size (default %(default)s)")
+  ap.add_argument("--bits", type=int, choices=(8, 16), default=8)
+  ap.add_argument("--volume-type", type=int, default=0,
+                  help="uvf -t: 0 mandelbulb, 1 zeros, 2 random, 3 sphere")
+  ap.add_argument("--formats", default=",".join(
+                    sorted(VOLUME_FORMATS) + sorted(STACK_FORMATS)),
+                  help="input formats (default %(default)s)")
+  ap.add_argument("--bricksizes", default="64,256")
+  ap.add_argument("--codecs", default="1,3",
+                  help="uvfconvert -p values (default: zlib, lz4)")
+  ap.add_argument("--layouts", default="0", help="uvfconvert -l values")
+  ap.add_argument("--mesh", type=int, default=1000,
+                  help="mesh grid size, 0 to skip meshes")
+  ap.add_argument("--workdir", help="keep inputs and outputs here")
+  ap.add_argument("--baseline", help="compare against this baseline")
+  ap.add_argument("--save-baseline", help="store the results here")
+  ap.add_argument("--tolerance", type=float, default=0.15,
+                  help="allowed relative regression (default %(default)s)")
+  args = ap.parse_args()
+
+  size = tuple(numbers(args.size))
+  if len(size) != 3:
+    ap.error("--size needs three values")
+  for tool in (args.uvfconvert, args.uvf):
+    if not os.access(tool, os.X_OK):
+      ap.error("'%s' not found; build it or give its path" % tool)
+
+  work = args.workdir or tempfile.mkdtemp(prefix="convbench-")
+  if not os.path.isdir(work):
+    os.makedirs(work)
+  scratch = os.path.join(work, "scratch")
+  base = os.path.join(work, "synthetic")
+  results = {}
+  failures = 0
+  try:
+    print("generating %dx%dx%d %d bit volume" % (size + (args.bits,)))
+    gen = [args.uvf, "-c", "-f", base + ".uvf", "-x", str(size[0]),
+           "-y", str(size[1]), "-z", str(size[2]), "-b", str(args.bits),
+           "-t", str(args.volume_type)]
+    if run(gen)[0] != 0:
+      sys.exit("volume generation failed: %s" % " ".join(gen))
+    if run([args.uvfconvert, "-i", base + ".uvf", "-o", base + ".raw"])[0]:
+      sys.exit("export of the synthetic volume failed")
+    raw_mb = os.path.getsize(base + ".raw") / 1e6
+
+    jobs = []
+    for fmt in args.formats.split(","):
+      if fmt in VOLUME_FORMATS:
+        src, flag = VOLUME_FORMATS[fmt](base, size, args.bits), "-i"
+      elif fmt in STACK_FORMATS:
+        src, flag = STACK_FORMATS[fmt](base, size, args.bits), "-d"
+      else:
+        ap.error("unknown format '%s'" % fmt)
+      for bs in numbers(args.bricksizes):
+        for codec in numbers(args.codecs):
+          for layout in numbers(args.layouts):
+            key = "%s/b%d/p%d/l%d" % (fmt, bs, codec, layout)
+            jobs.append((key, raw_mb,
+                         [args.uvfconvert, flag, src,
+                          "-o", os.path.join(work, "out.uvf"),
+                          "-c", str(bs), "-p", str(codec), "-l", str(layout)],
+                         fmt in CHECKED_FORMATS))
+    if args.mesh > 0:
+      for fmt in sorted(GEOMETRY_FORMATS):
+        src = GEOMETRY_FORMATS[fmt](base + "-mesh", args.mesh)
+        for out in ("ply", "stl"):
+          jobs.append(("%s->%s" % (fmt, out),
+                       os.path.getsize(src) / 1e6,
+                       [args.uvfconvert, "-i", src,
+                        "-o", os.path.join(work, "out-mesh." + out)],
+                       False))
+
+    print("%-24s %9s %9s %9s" % ("run", "MB/s", "RSS MB", "temp MB"))
+    for key, mb, cmd, check in jobs:
+      if os.path.isdir(scratch):
+        shutil.rmtree(scratch)
+      os.makedirs(scratch)
+      status, seconds, rss, temp = run(cmd + ["-t", scratch], scratch)
+      if status != 0:
+        print("%-24s failed: %s" % (key, " ".join(cmd)))
+        results[key] = {"failed": True}
+        failures += 1
+        continue
+      if check:
+        out = os.path.join(work, "check.raw")
+        if (run([args.uvfconvert, "-i", os.path.join(work, "out.uvf"),
+                 "-o", out])[0] != 0 or
+            not filecmp.cmp(base + ".raw", out, shallow=False)):
+          print("%-24s output differs from the input" % key)
+          results[key] = {"failed": True}
+          failures += 1
+          continue
+      results[key] = {"mbps": mb / max(seconds, 1e-6), "rss_mb": rss,
+                      "temp_mb": temp, "seconds": seconds}
+      print("%-24s %9.1f %9.1f %9.1f" % (key, results[key]["mbps"], rss,
+                                         temp))
+  finally:
+    if not args.workdir:
+      shutil.rmtree(work, ignore_errors=True)
+
+  if args.save_baseline:
+    with open(args.save_baseline, "w") as f:
+      json.dump(results, f, indent=2, sort_keys=True)
+
+  regressions = 0
+  if args.baseline:
+    with open(args.baseline) as f:
+      baseline = json.load(f)
+    tol = args.tolerance
+    for key in sorted(results):
+      now, then = results[key], baseline.get(key)
+      if then is None or then.get("failed"):
+        continue
+      problems = []
+      if now.get("failed"):
+        problems.append("failed")
+      else:
+        if now["mbps"] < then["mbps"] * (1.0 - tol):
+          problems.append("%.1f MB/s, was %.1f" % (now["mbps"], then["mbps"]))
+        for what in ("rss_mb", "temp_mb"):
+          # a little slack so tiny values do not trip the relative check
+          if now[what] > then[what] * (1.0 + tol) + 1.0:
+            problems.append("%s %.1f, was %.1f" % (what, now[what],
+                                                   then[what]))
+      if problems:
+        regressions += 1
+        print("REGRESSION %s: %s" % (key, "; ".join(problems)))
+    print("%d regression(s) against %s" % (regressions, args.baseline))
+  sys.exit(1 if regressions or failures else 0)
+
+
+if __name__ == "__main__":
+  main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python
+"""Scaling benchmark for the batch renderer's worker mode.
+
+Generates a synthetic volume with the UVFReader tool ('uvf -c') and a
+BatchRenderer script which renders a camera path through it with
+renderFrames (LuaScripts/RenderFrames.lua).  The script is run with
+'BatchRenderer -w N' for every requested worker count, and the frame rate
+and the speedup over a single worker are reported:
+
+  fps         frames written per second of wall time
+  speedup     fps relative to the run with one worker
+  efficiency  speedup / workers
+
+Every process gets the same thread budget, the share of the cores the
+largest run gives each of its workers: OMP_NUM_THREADS and LP_NUM_THREADS
+are set to it and the frames are written by that many threads less one.
+The single worker of the baseline is limited the same way, so the speedup
+measures how the processes scale rather than how one process with all the
+cores compares to several with a part of them.  Runs with at most as many
+workers as there are cores should then scale roughly linearly; if the
+efficiency of such a run falls below --min-efficiency, or frames are
+missing, the script exits with status 1.  Everything runs on the
+local machine; without an X display the renderer falls back to EGL, and
+where that is missing too, give --renderer a BatchRenderer built with
+'qmake CONFIG+=osmesa', which renders offscreen through OSMesa.
+
+  python Scripts/renderbench.py --workers 1,2,4 --frames 240
+"""
+from __future__ import print_function
+
+import argparse
+import glob
+import json
+import multiprocessing
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SCRIPT = """
+dofile(%(renderframes)s)
+renderer = tuvok.renderer.new(tuvok.renderer.types.OpenGL_SBVR,
+                              false, false, false, false, false)
+renderer.loadDataset(%(dataset)s)
+renderer.addShaderPath(%(shaders)s)
+context = tuvok.createContext(%(width)d, %(height)d, 32, 24, 8, true, false)
+renderer.initialize(context)
+renderer.resize({%(width)d, %(height)d})
+frames = {}
+for i = 1, %(frames)d do
+  local t = 2 * math.pi * i / %(frames)d
+  frames[i] = {camera={eye={x=3*math.sin(t), y=0.5, z=3*math.cos(t)},
+                       ref={x=0, y=0, z=0}, vup={x=0, y=1, z=0}}}
+end
+renderFrames(renderer, frames, %(pattern)s, %(width)d, %(height)d, false)
+renderer.cleanup()
+deleteClass(renderer)
+"""
+
+
+def lua_string(s):
+  return json.dumps(s)  # same escapes as Lua for plain paths
+
+
+def numbers(s):
+  return [int(v) for v in s.split(",") if v]
+
+
+def main():
+  ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+  ap.add_argument("--renderer", default=os.path.join(
+    ROOT, "BatchRenderer", "Build", "BatchRenderer"))
+  ap.add_argument("--uvf", default=os.path.join(ROOT, "UVFReader", "Build",
+                                                "uvf"))
+  ap.add_argument("--size", type=int, default=128,
+                  help="edge length of the synthetic volume "
+                       "(default %(default)s)")
+  ap.add_argument("--frames", type=int, default=120)
+  ap.add_argument("--width", type=int, default=640)
+  ap.add_argument("--height", type=int, default=480)
+  ap.add_argument("--workers", default="1,2,4",
+                  help="worker counts to run (default %(default)s)")
+  ap.add_argument("--min-efficiency", type=float, default=0.7,
+                  help="required speedup per worker for runs with no more "
+                       "workers than cores (default %(default)s)")
+  ap.add_argument("--workdir", help="keep the data set and frames here")
+  args = ap.parse_args()
+
+  counts = sorted(set(numbers(args.workers)) | set([1]))
+  for tool in (args.renderer, args.uvf):
+    if not os.access(tool, os.X_OK):
+      ap.error("'%s' not found; build it or give its path" % tool)
+
+  work = args.workdir or tempfile.mkdtemp(prefix="renderbench-")
+  if not os.path.isdir(work):
+    os.makedirs(work)
+  dataset = os.path.join(work, "synthetic.uvf")
+  frames_dir = os.path.join(work, "frames")
+  script = os.path.join(work, "render.lua")
+  cores = multiprocessing.cpu_count()
+  threads = max(1, cores // max(counts))
+  env = dict(os.environ, OMP_NUM_THREADS=str(threads),
+             LP_NUM_THREADS=str(threads))
+  failures = 0
+  try:
+    gen = [args.uvf, "-c", "-f", dataset, "-x", str(args.size),
+           "-y", str(args.size), "-z", str(args.size), "-b", "8", "-t", "0"]
+    if subprocess.call(gen) != 0:
+      sys.exit("volume generation failed: %s" % " ".join(gen))
+    with open(script, "w") as f:
+      f.write(SCRIPT % {
+        "renderframes": lua_string(os.path.join(ROOT, "LuaScripts",
+                                                "RenderFrames.lua")),
+        "dataset": lua_string(dataset),
+        "shaders": lua_string(os.path.join(ROOT, "Tuvok", "Shaders")),
+        "pattern": lua_string(os.path.join(frames_dir, "frame%04d.png")),
+        "frames": args.frames, "width": args.width, "height": args.height})
+
+    print("%d frames of %dx%d, %d cores, %d threads per process" %
+          (args.frames, args.width, args.height, cores, threads))
+    print("%8s %9s %9s %10s" % ("workers", "fps", "speedup", "efficiency"))
+    base_fps = None
+    for n in counts:
+      if os.path.isdir(frames_dir):
+        shutil.rmtree(frames_dir)
+      os.makedirs(frames_dir)
+      start = time.time()
+      with open(os.path.join(work, "workers-%d.log" % n), "w") as log:
+        status = subprocess.call([args.renderer, "-f", script, "-w", str(n),
+                                  "--encoders", str(max(1, threads - 1))],
+                                 stdout=log, stderr=log, env=env)
+      seconds = time.time() - start
+      written = len(glob.glob(os.path.join(frames_dir, "frame*.png")))
+      if status != 0 or written != args.frames:
+        print("%8d failed: status %d, %d of %d frames" %
+              (n, status, written, args.frames))
+        failures += 1
+        continue
+      fps = written / max(seconds, 1e-6)
+      if n == 1:
+        base_fps = fps
+      speedup = fps / base_fps if base_fps else 0.0
+      print("%8d %9.2f %9.2f %10.2f" % (n, fps, speedup, speedup / n))
+      if base_fps and n <= cores and speedup / n < args.min_efficiency:
+        print("%8d scales poorly: efficiency %.2f < %.2f" %
+              (n, speedup / n, args.min_efficiency))
+        failures += 1
+  finally:
+    if not args.workdir:
+      shutil.rmtree(work, ignore_errors=True)
+  sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+  main()
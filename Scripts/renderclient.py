@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+"""Client for the batch renderer's server mode ('BatchRenderer -s').
+
+Sends a Lua request to the server socket and writes the reply to a file or
+stdout.  The request is either given with -e, read from a file, or built
+from the image options, which call render() of LuaScripts/RenderServer.lua:
+
+  python Scripts/renderclient.py /tmp/render.sock --dataset head.uvf \\
+      --width 128 --height 128 -o thumb.png
+  python Scripts/renderclient.py /tmp/render.sock -e 'return "hello"'
+  python Scripts/renderclient.py /tmp/render.sock -e 'tuvok.stopServer()'
+
+With --repeat N the request is sent N times and the round trip times are
+reported; the first request of a data set loads it, later ones reuse it.
+The exit status is 1 if the server answered with an error.
+"""
+from __future__ import print_function
+
+import argparse
+import json
+import socket
+import sys
+import time
+
+
+def lua_string(s):
+  return json.dumps(s)  # same escapes as Lua for plain paths
+
+
+def request(path, code):
+  s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+  try:
+    s.connect(path)
+    s.sendall(code.encode("utf-8"))
+    s.shutdown(socket.SHUT_WR)
+    chunks = []
+    while True:
+      data = s.recv(1 << 16)
+      if not data:
+        break
+      chunks.append(data)
+  finally:
+    s.close()
+  reply = b"".join(chunks)
+  header, _, body = reply.partition(b"\n")
+  status, _, size = header.decode("ascii", "replace").partition(" ")
+  if status not in ("OK", "ERROR") or not size.isdigit() or \
+     int(size) != len(body):
+    raise IOError("malformed reply from the server: %r" % reply[:80])
+  return status == "OK", body
+
+
+def main():
+  ap = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+  ap.add_argument("socket")
+  ap.add_argument("script", nargs="?", help="file with the Lua request")
+  ap.add_argument("-e", "--execute", help="Lua request")
+  ap.add_argument("--dataset", help="render this data set")
+  ap.add_argument("--width", type=int, default=256)
+  ap.add_argument("--height", type=int, default=256)
+  ap.add_argument("--format", default="png")
+  ap.add_argument("-o", "--output", help="write the reply here")
+  ap.add_argument("--repeat", type=int, default=1)
+  args = ap.parse_args()
+
+  if args.execute:
+    code = args.execute
+  elif args.script:
+    with open(args.script) as f:
+      code = f.read()
+  elif args.dataset:
+    code = "return render{dataset=%s, width=%d, height=%d, format=%s}" % (
+      lua_string(args.dataset), args.width, args.height,
+      lua_string(args.format))
+  else:
+    ap.error("give a request with -e, a script or --dataset")
+
+  times = []
+  for _ in range(max(1, args.repeat)):
+    start = time.time()
+    ok, body = request(args.socket, code)
+    times.append(time.time() - start)
+    if not ok:
+      print("error: %s" % body.decode("utf-8", "replace"), file=sys.stderr)
+      sys.exit(1)
+
+  if args.output:
+    with open(args.output, "wb") as f:
+      f.write(body)
+  elif body:
+    out = getattr(sys.stdout, "buffer", sys.stdout)
+    out.write(body)
+    if not body.endswith(b"\n") and sys.stdout.isatty():
+      out.write(b"\n")
+  if args.repeat > 1:
+    ms = sorted(t * 1000 for t in times)
+    print("%d requests: first %.1f ms, median %.1f ms, max %.1f ms" %
+          (len(ms), times[0] * 1000, ms[len(ms) // 2], ms[-1]),
+          file=sys.stderr)
+
+
+if __name__ == "__main__":
+  main()
@@ -19,6 +19,7 @@
   #endif
 #endif
 
+#include <cstdlib>
 #include <StdTuvokDefines.h>
 #include <tclap/CmdLine.h>
 #include "Renderer/GL/GLRenderer.h"
@@ -29,6 +30,18 @@
 
 #define SHADER_PATH "Shaders"
 
+// the system's temp directory; TMPDIR (TEMP on Windows) if set.
+static std::string DefaultTempDir()
+{
+#ifdef _WIN32
+  const char* dir = getenv("TEMP");
+  return (dir && *dir) ? dir : ".";
+#else
+  const char* dir = getenv("TMPDIR");
+  return (dir && *dir) ? dir : "/tmp";
+#endif
+}
+
 
 
 bool SaveFBOToDisk(const std::string& filename) 
@@ -67,13 +80,19 @@ int main(int argc, char * argv[])
 #endif
 
 	std::string filename;
+	std::string tmpdir;
 	try 
 	{
 		TCLAP::CmdLine cmd("rendering test program");
 		TCLAP::ValueArg<std::string> dset("d", "dataset", "Dataset to render.", true, "", "filename");
+		TCLAP::ValueArg<std::string> tempdir("t", "tempdir", "Scratch directory for converting the dataset.", false, DefaultTempDir(), "path");
 		cmd.add(dset);
+		cmd.add(tempdir);
 		cmd.parse(argc, argv);
 		filename = dset.getValue();
+		tmpdir = tempdir.getValue();
+		// the converter expects a trailing separator
+		if (tmpdir.empty() || (tmpdir[tmpdir.size()-1] != '/' && tmpdir[tmpdir.size()-1] != '\\')) tmpdir += "/";
 	} 
 	catch (const TCLAP::ArgException & e)
 	{
@@ -98,7 +117,6 @@ int main(int argc, char * argv[])
 		// Convert the data into a UVF if necessary 
     if ( SysTools::ToLowerCase(SysTools::GetExt(filename)) != "uvf" ) {
 		  std::string uvf_file = SysTools::RemoveExt(filename) + ".uvf";
-		  const std::string tmpdir = "/tmp/";
 		  const bool quantize8 = false;
 		  tuvok::Controller::Instance().IOMan()->ConvertDataset(filename, uvf_file, tmpdir, true, 256, 4, quantize8);
       filename = uvf_file;
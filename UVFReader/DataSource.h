@@ -1,6 +1,7 @@
 #ifndef DATASOURCE_H
 #define DATASOURCE_H
 
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <cmath>
@@ -15,6 +16,7 @@
 #include "../Tuvok/Basics/LargeRAWFile.h"
 #include "../Tuvok/Basics/SysTools.h"
 #include "../CmdLineConverter/DebugOut/HRConsoleOut.h"
+#include "../CmdLineConverter/IO/MemoryAccountant.h"
 
 #include "../Tuvok/IO/TuvokSizes.h"
 #include "../Tuvok/IO/UVF/UVF.h"
@@ -477,13 +479,19 @@ bool CreateUVFFile(const std::string& strUVFName, const UINT64VECTOR3& vSize,
     tocBlock->strBlockID = "Test TOC Volume 1";
     tocBlock->ulCompressionScheme = UVFTables::COS_NONE;
 
+    // the generated data and everything else the process already holds is
+    // not available to the bricking.
+    MemoryAccountant& memory = MemoryAccountant::Instance();
+    memory.SetBudget(uint64_t(iUVFMemory)*1024*1024*1024);
+    const uint64_t brickingMem = std::max<uint64_t>(memory.Available(),
+                                                    64*1024*1024);
     bool bResult = tocBlock->FlatDataToBrickedLOD(rawFilename,
       "./tempFile.tmp", iBitSize == 8 ? ExtendedOctree::CT_UINT8
                                       : ExtendedOctree::CT_UINT16,
       1, vSize, DOUBLEVECTOR3(1,1,1),
       UINT64VECTOR3(iBrickSize,iBrickSize,iBrickSize),
       DEFAULT_BRICKOVERLAP, false, false,
-      1024*1024*1024*iUVFMemory, MaxMinData,
+      brickingMem, MaxMinData,
       &tuvok::Controller::Debug::Out(),
       static_cast<COMPRESSION_TYPE>(iCompression),
       iCompressionLevel,
@@ -71,9 +71,11 @@ contains(QMAKE_PRL_CONFIG, shared) {
 
 # Input
 HEADERS += ../CmdLineConverter/DebugOut/HRConsoleOut.h \
+           ../CmdLineConverter/IO/MemoryAccountant.h \
            DataSource.h \
            BlockInfo.h
 
 
 SOURCES += ../CmdLineConverter/DebugOut/HRConsoleOut.cpp \
+           ../CmdLineConverter/IO/MemoryAccountant.cpp \
            main.cpp
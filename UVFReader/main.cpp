@@ -195,6 +195,7 @@ int main(int argc, char* argv[])
                        bUseToCBlock, bKeepRaw, iCompression, iMem, iBrickSize,
                        iBrickLayout, iCompressionLevel, bhierarchical))
       return EXIT_FAILURE;
+    MemoryAccountant::Instance().Report();
   } else {
     if (!DisplayUVFInfo(strUVFName, bVerify, bShowData, bShow1dhist, 
                         bShow2dhist))